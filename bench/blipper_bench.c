@@ -0,0 +1,156 @@
+/*
+ *   Copyright (C) 2026 by the gambatte-libretro contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License version 2 for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   version 2 along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/* Times the blipper push and read-out with the settings the
+ * libretro sink uses, and hashes the read-out. The same random
+ * deltas go through the per-channel calls and through the stereo
+ * calls, which must give the same samples. The Makefile also
+ * compares the hashes with a build without HAVE_SIMD_TILES. */
+
+#include "blipper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NATIVE_PER_FRAME 35112
+#define NATIVE_PER_RUN   2064
+#define DELTAS_PER_RUN   180
+#define BUFFER_SIZE      1536
+
+static double now(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static unsigned long long hash_samples(unsigned long long h,
+      const blipper_sample_t *samples, unsigned count)
+{
+   unsigned i;
+   for (i = 0; i < count; i++)
+   {
+      h ^= (unsigned short)samples[i];
+      h *= 1099511628211ull;
+   }
+   return h;
+}
+
+static int run(unsigned frames, int stereo, unsigned long long *hash)
+{
+   static blipper_sample_t out[2 * BUFFER_SIZE];
+   unsigned long long h = 1469598103934665603ull;
+   unsigned seed        = 1;
+   double push_time     = 0.0;
+   double read_time     = 0.0;
+   unsigned f;
+   blipper_t *left      = blipper_new(32, 0.85, 6.5, 64, BUFFER_SIZE, NULL);
+   blipper_t *right     = blipper_new(32, 0.85, 6.5, 64, BUFFER_SIZE, NULL);
+
+   if (!left || !right)
+   {
+      fprintf(stderr, "blipper_new failed\n");
+      return 0;
+   }
+
+   for (f = 0; f < frames; f++)
+   {
+      unsigned base = 0;
+      unsigned avail;
+      double t0, t1, t2;
+
+      t0 = now();
+      while (base < NATIVE_PER_FRAME)
+      {
+         unsigned k;
+         unsigned n = NATIVE_PER_RUN;
+         if (base + n > NATIVE_PER_FRAME)
+            n = NATIVE_PER_FRAME - base;
+
+         for (k = 0; k < DELTAS_PER_RUN; k++)
+         {
+            unsigned t;
+            int delta_l, delta_r;
+
+            seed    = seed * 1103515245 + 12345;
+            t       = (seed >> 8) % n;
+            delta_l = (int)((seed >> 16) % 15361) - 7680;
+            delta_r = (k & 3) ? delta_l : -delta_l;
+
+            /* Some deltas do not fit in a sample and take
+             * the scalar path */
+            if ((seed & 0xFF) == 7)
+               delta_l *= 5;
+
+            if (stereo)
+               blipper_push_delta_stereo_at(left, right, delta_l, delta_r, t + 1);
+            else
+            {
+               blipper_push_delta_at(left, delta_l, t + 1);
+               blipper_push_delta_at(right, delta_r, t + 1);
+            }
+         }
+
+         blipper_advance(left, n);
+         blipper_advance(right, n);
+         base += n;
+      }
+
+      t1    = now();
+      avail = blipper_read_avail(left);
+      if (stereo)
+         blipper_read_stereo(left, right, out, avail);
+      else
+      {
+         blipper_read(left, out, avail, 2);
+         blipper_read(right, out + 1, avail, 2);
+      }
+      t2 = now();
+
+      push_time += t1 - t0;
+      read_time += t2 - t1;
+      h = hash_samples(h, out, 2 * avail);
+   }
+
+   printf("blipper %-6s hash %016llx push %7.2f us/frame read %6.2f us/frame\n",
+         stereo ? "stereo" : "mono", h,
+         push_time / frames * 1e6, read_time / frames * 1e6);
+
+   blipper_free(left);
+   blipper_free(right);
+   *hash = h;
+   return 1;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned long long mono, stereo;
+   unsigned frames = argc > 1 ? (unsigned)atoi(argv[1]) : 2000;
+
+   if (!frames || !run(frames, 0, &mono) || !run(frames, 1, &stereo))
+      return 1;
+
+   if (mono != stereo)
+   {
+      fprintf(stderr, "blipper: stereo read-out differs from per-channel read-out\n");
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,101 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+// Times Memory::read and Memory::write on the areas without a direct rmem/wmem
+// pointer, which go through nontrivial_read and nontrivial_write: VRAM, cartridge
+// RAM, echo RAM, OAM and HRAM, and then the same with an IO register added. The
+// LCD is off and the cartridge is an MBC1 with RAM, built in memory.
+
+#include "gambatte-memory.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+using namespace gambatte;
+
+// Linked from libretro.cpp in the core.
+void cartridge_set_rumble(unsigned) {}
+
+namespace {
+
+double now() {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void bench(Memory &mem, char const *name, unsigned const *addrs, unsigned naddrs,
+		unsigned long rounds) {
+	unsigned long cc = 0;
+	unsigned sum = 0;
+	double best = 0;
+
+	for (unsigned run = 0; run < 3; ++run) {
+		double const t0 = now();
+		for (unsigned long n = 0; n < rounds; ++n) {
+			for (unsigned i = 0; i < naddrs; ++i) {
+				unsigned const v = mem.read(addrs[i] + (n & 7), cc);
+				mem.write(addrs[i] + (n & 7), v ^ 1, cc);
+				sum += v;
+			}
+
+			cc = (cc + 4) & 0xFFFF;
+		}
+
+		double const t = now() - t0;
+		if (run == 0 || t < best)
+			best = t;
+	}
+
+	std::printf("mem %-9s %.3f s for %lu rounds, %.2f ns per read+write (sum %u)\n",
+	            name, best, rounds, best / (rounds * naddrs) * 1e9, sum);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long const rounds = argc > 1 ? std::strtoul(argv[1], 0, 10) : 4000000;
+	if (!rounds)
+		return 1;
+
+	// MBC1 + RAM + battery, 32 KiB ROM, 8 KiB RAM.
+	std::vector<unsigned char> rom(0x8000);
+	rom[0x147] = 0x03;
+	rom[0x149] = 0x02;
+
+	unsigned short sp = 0xFFFE, pc = 0x100;
+	static Memory mem((Interrupter(sp, pc)));
+	if (mem.loadROM(&rom[0], rom.size(), 0, false)) {
+		std::fprintf(stderr, "loadROM failed\n");
+		return 1;
+	}
+
+	mem.setEndtime(0, 70224);
+	mem.write(0x0000, 0x0A, 0);
+	mem.ff_write(0x40, 0x00, 0);
+
+	static unsigned const areas[] = { 0x8123, 0x9456, 0xA123, 0xB001, 0xF123, 0xFE12, 0xFF90 };
+	// FF47-FF4E: the palettes, the window position and unused registers.
+	static unsigned const withIo[] = { 0x8123, 0x9456, 0xA123, 0xB001, 0xF123, 0xFE12, 0xFF90,
+	                                   0xFF47 };
+	bench(mem, "areas", areas, sizeof areas / sizeof areas[0], rounds);
+	bench(mem, "areas+io", withIo, sizeof withIo / sizeof withIo[0], rounds);
+	return 0;
+}
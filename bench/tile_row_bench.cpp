@@ -0,0 +1,164 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+// Times drawTileRow and convertIndexRow over frames of random tile rows and
+// palette indices, against plain lookup loops, and fails if any pixel differs
+// from the loop. The hashes of the frames are printed for the Makefile to
+// compare with a build without HAVE_SIMD_TILES.
+
+#include "tile_row.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+using gambatte::video_pixel_t;
+
+namespace {
+
+enum { lcd_hres = 160, lcd_vres = 144, tiles_per_line = lcd_hres / 8 };
+
+double now() {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+unsigned long long hashFrame(unsigned long long h, video_pixel_t const *frame) {
+	for (unsigned i = 0; i < lcd_hres * lcd_vres; ++i) {
+		h ^= frame[i];
+		h *= 1099511628211ull;
+	}
+
+	return h;
+}
+
+unsigned seed = 1;
+
+unsigned nextRandom() {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+video_pixel_t randomColor() {
+	return static_cast<video_pixel_t>(nextRandom() ^ nextRandom() << 16);
+}
+
+bool benchDrawTileRow(unsigned const frames) {
+	static unsigned short tilewords[lcd_vres][tiles_per_line];
+	static video_pixel_t colors[lcd_vres][4];
+	static video_pixel_t out[lcd_vres * lcd_hres];
+	static video_pixel_t ref[lcd_vres * lcd_hres];
+	unsigned long long h = 1469598103934665603ull;
+	double kernelTime = 0, refTime = 0;
+
+	for (unsigned f = 0; f < frames; ++f) {
+		for (unsigned ly = 0; ly < lcd_vres; ++ly) {
+			for (unsigned i = 0; i < 4; ++i)
+				colors[ly][i] = randomColor();
+			for (unsigned t = 0; t < tiles_per_line; ++t)
+				tilewords[ly][t] = nextRandom() & 0xFFFF;
+		}
+
+		// As in the PPU, the palette is set up once for a line of tiles.
+		double const t0 = now();
+		for (unsigned ly = 0; ly < lcd_vres; ++ly) {
+			gambatte::TileRowPalette<video_pixel_t> pal;
+			gambatte::setTileRowPalette(pal, colors[ly]);
+			for (unsigned t = 0; t < tiles_per_line; ++t)
+				gambatte::drawTileRow(out + ly * lcd_hres + t * 8, tilewords[ly][t], pal);
+		}
+
+		double const t1 = now();
+		for (unsigned ly = 0; ly < lcd_vres; ++ly) {
+			for (unsigned t = 0; t < tiles_per_line; ++t) {
+				for (unsigned x = 0; x < 8; ++x)
+					ref[ly * lcd_hres + t * 8 + x] = colors[ly][tilewords[ly][t] >> 2 * x & 3];
+			}
+		}
+
+		double const t2 = now();
+		kernelTime += t1 - t0;
+		refTime += t2 - t1;
+
+		if (std::memcmp(out, ref, sizeof out)) {
+			std::fprintf(stderr, "drawTileRow differs from the lookup loop in frame %u\n", f);
+			return false;
+		}
+
+		h = hashFrame(h, out);
+	}
+
+	std::printf("tile_row draw  hash %016llx kernel %6.2f us/frame loop %6.2f us/frame\n",
+	            h, kernelTime / frames * 1e6, refTime / frames * 1e6);
+	return true;
+}
+
+bool benchConvertIndexRow(unsigned const frames) {
+	static unsigned char indices[lcd_vres * lcd_hres];
+	static video_pixel_t colors[8 * 4 * 2];
+	static video_pixel_t out[lcd_vres * lcd_hres];
+	static video_pixel_t ref[lcd_vres * lcd_hres];
+	unsigned long long h = 1469598103934665603ull;
+	double kernelTime = 0, refTime = 0;
+
+	for (unsigned f = 0; f < frames; ++f) {
+		for (unsigned i = 0; i < 8 * 4 * 2; ++i)
+			colors[i] = randomColor();
+		for (unsigned i = 0; i < lcd_vres * lcd_hres; ++i)
+			indices[i] = nextRandom() % (8 * 4 * 2);
+
+		// As in PPU::convertIndexedFrame, with one palette for the frame.
+		double const t0 = now();
+		gambatte::IndexRowPalette pal;
+		gambatte::setIndexRowPalette(pal, colors);
+		for (unsigned ly = 0; ly < lcd_vres; ++ly)
+			gambatte::convertIndexRow(out + ly * lcd_hres, indices + ly * lcd_hres, lcd_hres, pal);
+
+		double const t1 = now();
+		for (unsigned i = 0; i < lcd_vres * lcd_hres; ++i)
+			ref[i] = colors[indices[i]];
+
+		double const t2 = now();
+		kernelTime += t1 - t0;
+		refTime += t2 - t1;
+
+		if (std::memcmp(out, ref, sizeof out)) {
+			std::fprintf(stderr, "convertIndexRow differs from the lookup loop in frame %u\n", f);
+			return false;
+		}
+
+		h = hashFrame(h, out);
+	}
+
+	std::printf("tile_row index hash %016llx kernel %6.2f us/frame loop %6.2f us/frame\n",
+	            h, kernelTime / frames * 1e6, refTime / frames * 1e6);
+	return true;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	unsigned const frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+	if (!frames || !benchDrawTileRow(frames) || !benchConvertIndexRow(frames))
+		return 1;
+
+	return 0;
+}
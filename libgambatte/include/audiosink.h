@@ -0,0 +1,37 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the gambatte-libretro contributors              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License version 2 as     *
+ *   published by the Free Software Foundation.                            *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License version 2 for more details.                *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   version 2 along with this program; if not, write to the               *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef GAMBATTE_AUDIOSINK_H
+#define GAMBATTE_AUDIOSINK_H
+
+namespace gambatte {
+class AudioSink {
+public:
+	virtual ~AudioSink() {};
+	
+	/** Called for each change of the sound output, in place of writing samples to the sound buffer.
+	  * The changes of one sample are not necessarily combined, and come in no particular order
+	  * of time within a runFor call, since each sound channel reports its own in turn.
+	  * @param time sample number of the change, counted from the start of the current runFor call
+	  * @param left change of the left sample
+	  * @param right change of the right sample
+	  */
+	virtual void delta(unsigned time, int left, int right) = 0;
+};
+}
+
+#endif
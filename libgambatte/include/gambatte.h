@@ -19,6 +19,7 @@
 #ifndef GAMBATTE_H
 #define GAMBATTE_H
 
+#include "audiosink.h"
 #include "inputgetter.h"
 #ifdef HAVE_NETWORK
 #include "serial_io.h"
@@ -66,7 +67,8 @@ public:
 	  * The return value indicates whether a new video frame has been drawn, and the
 	  * exact time (in number of samples) at which it was drawn.
 	  *
-	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0
+	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0. With 0 the video
+	  *                 timing is emulated as usual, but no tiles are fetched or pixels drawn.
 	  * @param pitch distance in number of pixels (not bytes) from the start of one line to the next in videoBuf.
 	  * @param soundBuf buffer with space >= samples + 2064
 	  * @param soundBufSize actual size of soundBuf buffer
@@ -75,6 +77,45 @@ public:
 	  */
 	long runFor(gambatte::video_pixel_t *videoBuf, int pitch,
 			gambatte::uint_least32_t *soundBuf, std::size_t soundBufSize, unsigned &samples);
+
+   /** Same as runFor above, but the sound is resampled to the rate set with setSampleRate,
+     * and written to soundBuf as interleaved 16-bit stereo. Each call writes at most
+     * soundBufSize samples, and at most 1024, so no buffer beyond those is needed.
+     * @param samples in: number of stereo samples to produce at the set rate,
+     *                out: actual number of samples written
+     * @return sample number at which the video frame was produced, rounded down. -1 means no frame was produced.
+     */
+   long runFor(gambatte::video_pixel_t *videoBuf, int pitch,
+         short *soundBuf, std::size_t soundBufSize, unsigned &samples);
+
+   /** Sets the sample rate in Hz of the sound written by the resampling runFor,
+     * 48000 by default. Rates are limited to 8000-192000. Clears sound not yet written out.
+     */
+   void setSampleRate(unsigned rate);
+   unsigned sampleRate() const;
+
+   /** Same as the first runFor, but writes one byte per pixel to indexBuf instead of colours:
+     * background palette n colour c as n * 4 + c and sprite palette n colour c as
+     * 32 + n * 4 + c (DMG: BGP is background palette 0, OBP0/OBP1 sprite palettes 0/1).
+     * linePalette() and convertIndexedFrame() give the colours of a finished frame,
+     * until the next call overwrites them.
+     * @param pitch distance in bytes from the start of one line to the next in indexBuf.
+     */
+   long runForIndexed(unsigned char *indexBuf, int pitch,
+         gambatte::uint_least32_t *soundBuf, std::size_t soundBufSize, unsigned &samples);
+
+   /** Returns the 64 colours that the indices of line ly (0-143) of the last indexed
+     * frame refer to. Palette changes made while a line is drawn are not reflected.
+     * Lines drawn with the same palettes return the same pointer.
+     */
+   const video_pixel_t * linePalette(unsigned ly) const;
+
+   /** Converts the last indexed frame, read from indexBuf, to colours in videoBuf.
+     * @param videoPitch distance in pixels from the start of one line to the next in videoBuf.
+     * @param indexPitch distance in bytes from the start of one line to the next in indexBuf.
+     */
+   void convertIndexedFrame(video_pixel_t *videoBuf, int videoPitch,
+         const unsigned char *indexBuf, int indexPitch) const;
 	
 	/** Reset to initial state.
 	  * Equivalent to reloading a ROM image, or turning a Game Boy Color off and on again.
@@ -88,6 +129,12 @@ public:
 
 	/** Sets the callback used for getting input state. */
 	void setInputGetter(InputGetter *getInput);
+
+	/** Sets the receiver of the sound output as changes, or 0 for writing samples to the
+	  * sound buffer of runFor (the default). While a sink is set, soundBuf is not written
+	  * and may be 0, though soundBufSize still bounds the samples run per call.
+	  */
+	void setAudioSink(AudioSink *sink);
    
    /** Sets the callback used for getting the bootloader data. */
    void setBootloaderGetter(bool (*getter)(void *userdata, bool isgbc, uint8_t *data, uint32_t buf_size));
@@ -111,10 +158,59 @@ public:
 	/** Returns true if a ROM image is loaded. */
 	bool isLoaded() const;
 	
-   void saveState(void *data);
-   void loadState(const void *data);
+   /** Saves the state to data, which must have room for stateSize() bytes.
+     * A fast state uses a fixed binary layout that is quicker to save and load,
+     * but can only be loaded by the same build (run-ahead, rewind).
+     */
+   void saveState(void *data, bool fast = false);
+
+   /**
+     * Loads a state saved by saveState, in either format. size may be less than
+     * stateSize() for states saved before fields were added to the format.
+     * @return false if the state is not valid or is cut short; nothing is loaded then.
+     */
+   bool loadState(const void *data, size_t size);
    size_t stateSize() const;
 
+   enum MemoryArea {
+      VRAM_AREA,     /**< Both VRAM banks on CGB, 8 KB otherwise. */
+      SRAM_AREA,     /**< All cartridge RAM banks. */
+      WRAM_AREA,     /**< All WRAM banks. */
+      OAM_HRAM_AREA  /**< 0xFE00-0xFFFF: OAM, then the I/O registers and HRAM. */
+   };
+
+   /** Returns a bitmap of the 256-byte pages of area written since the last
+     * clearDirtyPages(), while setDirtyTracking(true) is in effect. Page n is
+     * bit (n & 7) of byte n / 8. Loading a ROM or a state marks every page
+     * dirty. The page holding the I/O registers is always reported dirty,
+     * since they also change without being written.
+     * @param pages receives the number of pages in area
+     */
+   const unsigned char * dirtyPages(MemoryArea area, size_t &pages) const;
+   void clearDirtyPages();
+
+   /** Enables or disables recording of the pages written for dirtyPages().
+     * Off by default, so that memory writes do not pay for it. Enabling it
+     * marks every page dirty, since writes made while it was off are not known.
+     */
+   void setDirtyTracking(bool enable);
+
+   /** Sets the number of bytes kept for rewind history and clears the history.
+     * 0 disables rewinding and frees the buffer.
+     */
+   void setRewindBufferSize(size_t size);
+   size_t rewindBufferSize() const;
+
+   /** Records the current state as the newest rewind snapshot, dropping the
+     * oldest ones if the buffer is full. Meant to be called once per frame.
+     */
+   void rewindPush();
+
+   /** Loads the newest rewind snapshot and drops it from the history.
+     * @return false if the history is empty, in which case the state is unchanged.
+     */
+   bool rewindPop();
+
    void setColorCorrection(bool enable);
    void setColorCorrectionMode(unsigned colorCorrectionMode);
    void setColorCorrectionBrightness(float colorCorrectionBrightness);
@@ -135,6 +231,8 @@ public:
    
 #ifdef __LIBRETRO__
    void *vram_ptr() const;
+   /** Call after writing VRAM through vram_ptr(), so the renderer picks up the new tiles. */
+   void syncVram();
    void *rambank0_ptr() const;
    void *rambank1_ptr() const;
    void *rambank2_ptr() const;
@@ -66,6 +66,105 @@ struct blipper
    int owns_filter;
 };
 
+/* HAVE_SIMD_TILES selects NEON (with HAVE_SIMD_NEON) or SSE2
+ * versions of the filter accumulation and of the stereo
+ * integrator, which produce the same output as the scalar
+ * loops. The accumulation takes 8 taps at a time, of deltas
+ * that fit in a sample. */
+#if BLIPPER_FIXED_POINT && defined(HAVE_SIMD_TILES) && defined(HAVE_SIMD_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define BLIPPER_NEON
+#include <arm_neon.h>
+#elif BLIPPER_FIXED_POINT && defined(HAVE_SIMD_TILES) && (defined(__SSE2__) || defined(_M_X64) \
+      || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BLIPPER_SSE2
+#include <emmintrin.h>
+#endif
+
+static void blipper_accumulate(blipper_long_sample_t *target,
+      const blipper_sample_t *response, unsigned taps, blipper_long_sample_t delta)
+{
+   unsigned i = 0;
+
+#if defined(BLIPPER_NEON)
+   if ((blipper_sample_t)delta == delta)
+   {
+      for (; i + 8 <= taps; i += 8)
+      {
+         int16x8_t r  = vld1q_s16((const int16_t*)response + i);
+         int32_t *t   = (int32_t*)target + i;
+         vst1q_s32(t,     vmlal_n_s16(vld1q_s32(t),     vget_low_s16(r),  (int16_t)delta));
+         vst1q_s32(t + 4, vmlal_n_s16(vld1q_s32(t + 4), vget_high_s16(r), (int16_t)delta));
+      }
+   }
+#elif defined(BLIPPER_SSE2)
+   if ((blipper_sample_t)delta == delta)
+   {
+      const __m128i d = _mm_set1_epi16((short)delta);
+
+      for (; i + 8 <= taps; i += 8)
+      {
+         /* The low and high halves of the 16 x 16 bit
+          * products interleave into 32 bit products */
+         __m128i r  = _mm_loadu_si128((const __m128i*)(response + i));
+         __m128i lo = _mm_mullo_epi16(r, d);
+         __m128i hi = _mm_mulhi_epi16(r, d);
+         __m128i *t = (__m128i*)(target + i);
+         _mm_storeu_si128(t,     _mm_add_epi32(_mm_loadu_si128(t),     _mm_unpacklo_epi16(lo, hi)));
+         _mm_storeu_si128(t + 1, _mm_add_epi32(_mm_loadu_si128(t + 1), _mm_unpackhi_epi16(lo, hi)));
+      }
+   }
+#endif
+
+   for (; i < taps; i++)
+      target[i] += delta * response[i];
+}
+
+static void blipper_accumulate_stereo(blipper_long_sample_t *target_l,
+      blipper_long_sample_t *target_r, const blipper_sample_t *response,
+      unsigned taps, blipper_long_sample_t delta_l, blipper_long_sample_t delta_r)
+{
+#if defined(BLIPPER_NEON) || defined(BLIPPER_SSE2)
+   if ((blipper_sample_t)delta_l == delta_l && (blipper_sample_t)delta_r == delta_r && !(taps & 7))
+   {
+      unsigned i;
+#if defined(BLIPPER_NEON)
+      for (i = 0; i < taps; i += 8)
+      {
+         int16x8_t r  = vld1q_s16((const int16_t*)response + i);
+         int32_t *tl  = (int32_t*)target_l + i;
+         int32_t *tr  = (int32_t*)target_r + i;
+         vst1q_s32(tl,     vmlal_n_s16(vld1q_s32(tl),     vget_low_s16(r),  (int16_t)delta_l));
+         vst1q_s32(tl + 4, vmlal_n_s16(vld1q_s32(tl + 4), vget_high_s16(r), (int16_t)delta_l));
+         vst1q_s32(tr,     vmlal_n_s16(vld1q_s32(tr),     vget_low_s16(r),  (int16_t)delta_r));
+         vst1q_s32(tr + 4, vmlal_n_s16(vld1q_s32(tr + 4), vget_high_s16(r), (int16_t)delta_r));
+      }
+#else
+      const __m128i dl = _mm_set1_epi16((short)delta_l);
+      const __m128i dr = _mm_set1_epi16((short)delta_r);
+
+      for (i = 0; i < taps; i += 8)
+      {
+         __m128i r   = _mm_loadu_si128((const __m128i*)(response + i));
+         __m128i llo = _mm_mullo_epi16(r, dl);
+         __m128i lhi = _mm_mulhi_epi16(r, dl);
+         __m128i rlo = _mm_mullo_epi16(r, dr);
+         __m128i rhi = _mm_mulhi_epi16(r, dr);
+         __m128i *tl = (__m128i*)(target_l + i);
+         __m128i *tr = (__m128i*)(target_r + i);
+         _mm_storeu_si128(tl,     _mm_add_epi32(_mm_loadu_si128(tl),     _mm_unpacklo_epi16(llo, lhi)));
+         _mm_storeu_si128(tl + 1, _mm_add_epi32(_mm_loadu_si128(tl + 1), _mm_unpackhi_epi16(llo, lhi)));
+         _mm_storeu_si128(tr,     _mm_add_epi32(_mm_loadu_si128(tr),     _mm_unpacklo_epi16(rlo, rhi)));
+         _mm_storeu_si128(tr + 1, _mm_add_epi32(_mm_loadu_si128(tr + 1), _mm_unpackhi_epi16(rlo, rhi)));
+      }
+#endif
+      return;
+   }
+#endif
+
+   blipper_accumulate(target_l, response, taps, delta_l);
+   blipper_accumulate(target_r, response, taps, delta_r);
+}
+
 void blipper_free(blipper_t *blip)
 {
    if (blip)
@@ -358,9 +457,8 @@ error:
 
 void blipper_push_delta(blipper_t *blip, blipper_long_sample_t delta, unsigned clocks_step)
 {
-   unsigned target_output, filter_phase, taps, i;
+   unsigned target_output, filter_phase;
    const blipper_sample_t *response;
-   blipper_long_sample_t *target;
 
    blip->phase += clocks_step;
 
@@ -369,15 +467,50 @@ void blipper_push_delta(blipper_t *blip, blipper_long_sample_t delta, unsigned c
    filter_phase = (target_output << blip->phases_log2) - blip->phase;
    response = blip->filter_bank + blip->taps * filter_phase;
 
-   target = blip->output_buffer + target_output;
-   taps = blip->taps;
-
-   for (i = 0; i < taps; i++)
-      target[i] += delta * response[i];
+   blipper_accumulate(blip->output_buffer + target_output, response, blip->taps, delta);
 
    blip->output_avail = target_output;
 }
 
+void blipper_push_delta_at(blipper_t *blip, blipper_long_sample_t delta, unsigned clocks)
+{
+   unsigned phase, target_output, filter_phase;
+   const blipper_sample_t *response;
+
+   phase = blip->phase + clocks;
+
+   target_output = (phase + blip->phases - 1) >> blip->phases_log2;
+
+   filter_phase = (target_output << blip->phases_log2) - phase;
+   response = blip->filter_bank + blip->taps * filter_phase;
+
+   blipper_accumulate(blip->output_buffer + target_output, response, blip->taps, delta);
+}
+
+void blipper_push_delta_stereo_at(blipper_t *left, blipper_t *right,
+      blipper_long_sample_t delta_left, blipper_long_sample_t delta_right, unsigned clocks)
+{
+   unsigned phase, target_output, filter_phase;
+   const blipper_sample_t *response;
+
+   phase = left->phase + clocks;
+
+   target_output = (phase + left->phases - 1) >> left->phases_log2;
+
+   filter_phase = (target_output << left->phases_log2) - phase;
+   response = left->filter_bank + left->taps * filter_phase;
+
+   blipper_accumulate_stereo(left->output_buffer + target_output,
+         right->output_buffer + target_output, response, left->taps,
+         delta_left, delta_right);
+}
+
+void blipper_advance(blipper_t *blip, unsigned clocks)
+{
+   blip->phase += clocks;
+   blip->output_avail = (blip->phase + blip->phases - 1) >> blip->phases_log2;
+}
+
 void blipper_push_samples(blipper_t *blip, const blipper_sample_t *data,
       unsigned samples, unsigned stride)
 {
@@ -412,6 +545,20 @@ void blipper_push_samples(blipper_t *blip, const blipper_sample_t *data,
 #endif
 }
 
+/* Drops the samples read out and keeps the integrator sum. */
+static void blipper_consume(blipper_t *blip, unsigned samples, blipper_long_sample_t sum)
+{
+   /* Don't bother with ring buffering.
+    * The entire buffer should be read out ideally anyways. */
+   memmove(blip->output_buffer, blip->output_buffer + samples,
+         (blip->output_avail + blip->taps - samples) * sizeof(*blip->output_buffer));
+   memset(blip->output_buffer + blip->taps, 0, samples * sizeof(*blip->output_buffer));
+   blip->output_avail -= samples;
+   blip->phase -= samples << blip->phases_log2;
+
+   blip->integrator = sum;
+}
+
 unsigned blipper_read_avail(blipper_t *blip)
 {
    return blip->output_avail;
@@ -460,18 +607,80 @@ void blipper_read(blipper_t *blip, blipper_sample_t *output, unsigned samples,
    }
 #endif
 
-   /* Don't bother with ring buffering.
-    * The entire buffer should be read out ideally anyways. */
-   memmove(blip->output_buffer, blip->output_buffer + samples,
-         (blip->output_avail + blip->taps - samples) * sizeof(*out));
-   memset(blip->output_buffer + blip->taps, 0, samples * sizeof(*out));
-   blip->output_avail -= samples;
-   blip->phase -= samples << blip->phases_log2;
-
-   blip->integrator = sum;
+   blipper_consume(blip, samples, sum);
 
 #if BLIPPER_LOG_PERFORMANCE
    blip->integrator_time += get_time() - t0;
 #endif
 }
 
+void blipper_read_stereo(blipper_t *left, blipper_t *right,
+      blipper_sample_t *output, unsigned samples)
+{
+#if defined(BLIPPER_NEON) || defined(BLIPPER_SSE2)
+   /* The integrator runs sample by sample, so the two
+    * channels make up the lanes. The same clamping as in
+    * blipper_read() is a saturating narrow, with the sum
+    * reset in the lanes that it changed. */
+   unsigned s;
+   const blipper_long_sample_t *out_l = left->output_buffer;
+   const blipper_long_sample_t *out_r = right->output_buffer;
+#if defined(BLIPPER_NEON)
+   int32_t init[2];
+   int32x2_t sum;
+
+   init[0] = left->integrator;
+   init[1] = right->integrator;
+   sum     = vld1_s32(init);
+
+   for (s = 0; s < samples; s++, output += 2)
+   {
+      int32x2_t in, quant, clamped;
+      int16x4_t narrow;
+      int32_t pair;
+
+      in      = vset_lane_s32(out_r[s], vdup_n_s32(out_l[s]), 1);
+      sum     = vadd_s32(sum, vsub_s32(vshr_n_s32(in, 1), vshr_n_s32(sum, 9)));
+      quant   = vshr_n_s32(vadd_s32(sum, vdup_n_s32(0x4000)), 15);
+      narrow  = vqmovn_s32(vcombine_s32(quant, quant));
+      clamped = vget_low_s32(vmovl_s16(narrow));
+      sum     = vbsl_s32(vceq_s32(clamped, quant), sum, vshl_n_s32(clamped, 15));
+
+      pair = vget_lane_s32(vreinterpret_s32_s16(narrow), 0);
+      memcpy(output, &pair, sizeof(pair));
+   }
+
+   vst1_s32(init, sum);
+#else
+   int init[4];
+   __m128i sum = _mm_setr_epi32(left->integrator, right->integrator, 0, 0);
+
+   for (s = 0; s < samples; s++, output += 2)
+   {
+      __m128i in, quant, narrow, clamped, same;
+      int pair;
+
+      in      = _mm_setr_epi32(out_l[s], out_r[s], 0, 0);
+      sum     = _mm_add_epi32(sum, _mm_sub_epi32(_mm_srai_epi32(in, 1), _mm_srai_epi32(sum, 9)));
+      quant   = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(0x4000)), 15);
+      narrow  = _mm_packs_epi32(quant, quant);
+      clamped = _mm_srai_epi32(_mm_unpacklo_epi16(narrow, narrow), 16);
+      same    = _mm_cmpeq_epi32(clamped, quant);
+      sum     = _mm_or_si128(_mm_and_si128(same, sum),
+            _mm_andnot_si128(same, _mm_slli_epi32(clamped, 15)));
+
+      pair = _mm_cvtsi128_si32(narrow);
+      memcpy(output, &pair, sizeof(pair));
+   }
+
+   _mm_storeu_si128((__m128i*)init, sum);
+#endif
+
+   blipper_consume(left, samples, init[0]);
+   blipper_consume(right, samples, init[1]);
+#else
+   blipper_read(left, output, samples, 2);
+   blipper_read(right, output + 1, samples, 2);
+#endif
+}
+
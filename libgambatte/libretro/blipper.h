@@ -138,6 +138,28 @@ void blipper_free(blipper_t *blip);
 #define blipper_push_delta BLIPPER_MANGLE(blipper_push_delta)
 void blipper_push_delta(blipper_t *blip, blipper_long_sample_t delta, unsigned clocks_step);
 
+/* Push a single delta, which occurs clocks input samples after the
+ * current time, without advancing the time. Unlike blipper_push_delta(),
+ * deltas can be pushed in any order of time, which suits sources that
+ * produce several independent streams of deltas over the same period.
+ * blipper_advance() must follow once all deltas of the period are pushed.
+ */
+#define blipper_push_delta_at BLIPPER_MANGLE(blipper_push_delta_at)
+void blipper_push_delta_at(blipper_t *blip, blipper_long_sample_t delta, unsigned clocks);
+
+/* Same as blipper_push_delta_at(), for a left and a right blipper of
+ * the same configuration and time, in one pass over the filter.
+ */
+#define blipper_push_delta_stereo_at BLIPPER_MANGLE(blipper_push_delta_stereo_at)
+void blipper_push_delta_stereo_at(blipper_t *left, blipper_t *right,
+      blipper_long_sample_t delta_left, blipper_long_sample_t delta_right, unsigned clocks);
+
+/* Advances the current time by clocks input samples, making the output
+ * up to it available for reading.
+ */
+#define blipper_advance BLIPPER_MANGLE(blipper_advance)
+void blipper_advance(blipper_t *blip, unsigned clocks);
+
 /* Push raw samples. blipper will find the deltas themself and push them.
  * stride is the number of samples between each sample to be used.
  * This can be used to push interleaved stereo data to two independent
@@ -163,6 +185,13 @@ unsigned blipper_read_avail(blipper_t *blip);
 void blipper_read(blipper_t *blip, blipper_sample_t *output, unsigned samples,
       unsigned stride);
 
+/* Same as blipper_read() on a left and a right blipper kept in step,
+ * writing interleaved stereo samples to output in one pass.
+ */
+#define blipper_read_stereo BLIPPER_MANGLE(blipper_read_stereo)
+void blipper_read_stereo(blipper_t *left, blipper_t *right,
+      blipper_sample_t *output, unsigned samples);
+
 #ifdef __cplusplus
 }
 #endif
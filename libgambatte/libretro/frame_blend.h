@@ -0,0 +1,408 @@
+#ifndef FRAME_BLEND_H
+#define FRAME_BLEND_H
+
+#include "gambatte.h"
+
+/* Interframe blending kernels. Each call blends one line
+ * of n pixels (a multiple of 8) into out, using only
+ * integer maths: colour channels are weighted in 16 bit
+ * fixed point, with FRAME_BLEND_FRAC fractional bits.
+ * HAVE_SIMD_TILES selects NEON (with HAVE_SIMD_NEON) or
+ * SSE2 versions, which produce the same output as the
+ * scalar loops */
+#if defined(HAVE_SIMD_TILES) && defined(HAVE_SIMD_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define FRAME_BLEND_NEON
+#include <arm_neon.h>
+#elif defined(HAVE_SIMD_TILES) && (defined(__SSE2__) || defined(_M_X64) \
+      || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FRAME_BLEND_SSE2
+#include <emmintrin.h>
+#endif
+
+/* 16 bit pixels are blended as three 5 bit channels (the
+ * low bit of RGB565 green is dropped, as in the palettes).
+ * 32 bit pixels are blended byte by byte */
+#ifdef VIDEO_RGB565
+#define FRAME_BLEND_CHANNELS 3
+#define FRAME_BLEND_SHIFT_0  11
+#define FRAME_BLEND_SHIFT_1  6
+#define FRAME_BLEND_SHIFT_2  0
+#define FRAME_BLEND_MASK     0x1F
+#define FRAME_BLEND_LSBS     0x0821
+#define FRAME_BLEND_FRAC     11
+#elif defined(VIDEO_ABGR1555)
+#define FRAME_BLEND_CHANNELS 3
+#define FRAME_BLEND_SHIFT_0  0
+#define FRAME_BLEND_SHIFT_1  5
+#define FRAME_BLEND_SHIFT_2  10
+#define FRAME_BLEND_MASK     0x1F
+#define FRAME_BLEND_LSBS     0x8421
+#define FRAME_BLEND_FRAC     11
+#else
+#define FRAME_BLEND_CHANNELS 4
+#define FRAME_BLEND_MASK     0xFF
+#define FRAME_BLEND_LSBS     0x01010101
+#define FRAME_BLEND_FRAC     8
+#endif
+
+/* Fixed point 1.0. A channel times a weight of at most
+ * this (plus rounding) always fits in 16 bits */
+#define FRAME_BLEND_ONE      (1 << FRAME_BLEND_FRAC)
+#define FRAME_BLEND_HALF     (1 << (FRAME_BLEND_FRAC - 1))
+
+/* Number of previous frames used by blend_line_lcd_ghost() */
+#define FRAME_BLEND_GHOST_FRAMES 4
+
+typedef gambatte::video_pixel_t frame_blend_pixel_t;
+
+static inline unsigned frame_blend_channel(frame_blend_pixel_t rgb, unsigned c)
+{
+#if FRAME_BLEND_CHANNELS == 3
+   static const unsigned shift[3] = { FRAME_BLEND_SHIFT_0, FRAME_BLEND_SHIFT_1, FRAME_BLEND_SHIFT_2 };
+   return rgb >> shift[c] & FRAME_BLEND_MASK;
+#else
+   return rgb >> (8 * c) & FRAME_BLEND_MASK;
+#endif
+}
+
+static inline frame_blend_pixel_t frame_blend_repack(unsigned value, unsigned c)
+{
+#if FRAME_BLEND_CHANNELS == 3
+   static const unsigned shift[3] = { FRAME_BLEND_SHIFT_0, FRAME_BLEND_SHIFT_1, FRAME_BLEND_SHIFT_2 };
+   return static_cast<frame_blend_pixel_t>(value << shift[c]);
+#else
+   return static_cast<frame_blend_pixel_t>(value << (8 * c));
+#endif
+}
+
+/* Accumulator layout for blend_line_lcd_ghost_fast(): one
+ * 16 bit value per channel, FRAME_BLEND_CHANNELS * n per
+ * line. Channels are stored in planes for 16 bit pixels
+ * and interleaved for 32 bit ones, as the vector code
+ * unpacks them */
+static inline unsigned frame_blend_acc_index(unsigned x, unsigned c, unsigned n)
+{
+#if FRAME_BLEND_CHANNELS == 3
+   return c * n + x;
+#else
+   (void)n;
+   return x * 4 + c;
+#endif
+}
+
+#ifdef FRAME_BLEND_NEON
+#if FRAME_BLEND_CHANNELS == 3
+static inline uint16x8_t frame_blend_extract(uint16x8_t px, int shift)
+{
+   return vandq_u16(vshlq_u16(px, vdupq_n_s16(-shift)), vdupq_n_u16(FRAME_BLEND_MASK));
+}
+
+static inline uint16x8_t frame_blend_insert(uint16x8_t value, int shift)
+{
+   return vshlq_u16(value, vdupq_n_s16(shift));
+}
+#endif
+#elif defined(FRAME_BLEND_SSE2)
+#if FRAME_BLEND_CHANNELS == 3
+static inline __m128i frame_blend_extract(__m128i px, int shift)
+{
+   return _mm_and_si128(_mm_srli_epi16(px, shift), _mm_set1_epi16(FRAME_BLEND_MASK));
+}
+#endif
+#endif
+
+/* 50:50 mix of curr and prev, rounding up. Channel low
+ * bits are masked off before halving the difference, so
+ * nothing carries between channels */
+static void blend_line_mix(frame_blend_pixel_t *out,
+      const frame_blend_pixel_t *curr, const frame_blend_pixel_t *prev, unsigned n)
+{
+   unsigned x = 0;
+
+#ifdef FRAME_BLEND_NEON
+#if FRAME_BLEND_CHANNELS == 3
+   const uint16x8_t lsbs = vdupq_n_u16(FRAME_BLEND_LSBS);
+
+   for (; x < n; x += 8)
+   {
+      uint16x8_t a = vld1q_u16(curr + x);
+      uint16x8_t b = vld1q_u16(prev + x);
+      vst1q_u16(out + x, vsubq_u16(vorrq_u16(a, b),
+            vshrq_n_u16(vbicq_u16(veorq_u16(a, b), lsbs), 1)));
+   }
+#else
+   const uint32x4_t lsbs = vdupq_n_u32(FRAME_BLEND_LSBS);
+
+   for (; x < n; x += 4)
+   {
+      uint32x4_t a = vld1q_u32(curr + x);
+      uint32x4_t b = vld1q_u32(prev + x);
+      vst1q_u32(out + x, vsubq_u32(vorrq_u32(a, b),
+            vshrq_n_u32(vbicq_u32(veorq_u32(a, b), lsbs), 1)));
+   }
+#endif
+#elif defined(FRAME_BLEND_SSE2)
+#if FRAME_BLEND_CHANNELS == 3
+   const __m128i lsbs = _mm_set1_epi16(static_cast<short>(FRAME_BLEND_LSBS));
+
+   for (; x < n; x += 8)
+   {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(curr + x));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_sub_epi16(_mm_or_si128(a, b),
+            _mm_srli_epi16(_mm_andnot_si128(lsbs, _mm_xor_si128(a, b)), 1)));
+   }
+#else
+   const __m128i lsbs = _mm_set1_epi32(FRAME_BLEND_LSBS);
+
+   for (; x < n; x += 4)
+   {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(curr + x));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_sub_epi32(_mm_or_si128(a, b),
+            _mm_srli_epi32(_mm_andnot_si128(lsbs, _mm_xor_si128(a, b)), 1)));
+   }
+#endif
+#endif
+
+   for (; x < n; x++)
+   {
+      frame_blend_pixel_t a = curr[x];
+      frame_blend_pixel_t b = prev[x];
+      out[x] = (a | b) - (((a ^ b) & ~static_cast<frame_blend_pixel_t>(FRAME_BLEND_LSBS)) >> 1);
+   }
+}
+
+/* Weighted sum of the current line (frames[0]) and the
+ * same line of the FRAME_BLEND_GHOST_FRAMES previous
+ * frames. The weights must add up to FRAME_BLEND_ONE */
+static void blend_line_lcd_ghost(frame_blend_pixel_t *out,
+      const frame_blend_pixel_t *const *frames, const unsigned short *weights, unsigned n)
+{
+   const frame_blend_pixel_t *f0 = frames[0];
+   const frame_blend_pixel_t *f1 = frames[1];
+   const frame_blend_pixel_t *f2 = frames[2];
+   const frame_blend_pixel_t *f3 = frames[3];
+   const frame_blend_pixel_t *f4 = frames[4];
+   unsigned x = 0;
+
+#ifdef FRAME_BLEND_NEON
+#if FRAME_BLEND_CHANNELS == 3
+   for (; x < n; x += 8)
+   {
+      static const int shift[3] = { FRAME_BLEND_SHIFT_0, FRAME_BLEND_SHIFT_1, FRAME_BLEND_SHIFT_2 };
+      uint16x8_t p0 = vld1q_u16(f0 + x);
+      uint16x8_t p1 = vld1q_u16(f1 + x);
+      uint16x8_t p2 = vld1q_u16(f2 + x);
+      uint16x8_t p3 = vld1q_u16(f3 + x);
+      uint16x8_t p4 = vld1q_u16(f4 + x);
+      uint16x8_t rgb = vdupq_n_u16(0);
+
+      for (unsigned c = 0; c < 3; c++)
+      {
+         uint16x8_t sum = vmulq_n_u16(frame_blend_extract(p0, shift[c]), weights[0]);
+         sum = vmlaq_n_u16(sum, frame_blend_extract(p1, shift[c]), weights[1]);
+         sum = vmlaq_n_u16(sum, frame_blend_extract(p2, shift[c]), weights[2]);
+         sum = vmlaq_n_u16(sum, frame_blend_extract(p3, shift[c]), weights[3]);
+         sum = vmlaq_n_u16(sum, frame_blend_extract(p4, shift[c]), weights[4]);
+         rgb = vorrq_u16(rgb, frame_blend_insert(vrshrq_n_u16(sum, FRAME_BLEND_FRAC), shift[c]));
+      }
+
+      vst1q_u16(out + x, rgb);
+   }
+#else
+   for (; x < n; x += 4)
+   {
+      uint8x16_t p0 = vld1q_u8(reinterpret_cast<const uint8_t *>(f0 + x));
+      uint8x16_t p1 = vld1q_u8(reinterpret_cast<const uint8_t *>(f1 + x));
+      uint8x16_t p2 = vld1q_u8(reinterpret_cast<const uint8_t *>(f2 + x));
+      uint8x16_t p3 = vld1q_u8(reinterpret_cast<const uint8_t *>(f3 + x));
+      uint8x16_t p4 = vld1q_u8(reinterpret_cast<const uint8_t *>(f4 + x));
+      uint16x8_t lo = vmulq_n_u16(vmovl_u8(vget_low_u8(p0)), weights[0]);
+      uint16x8_t hi = vmulq_n_u16(vmovl_u8(vget_high_u8(p0)), weights[0]);
+      lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(p1)), weights[1]);
+      hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(p1)), weights[1]);
+      lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(p2)), weights[2]);
+      hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(p2)), weights[2]);
+      lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(p3)), weights[3]);
+      hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(p3)), weights[3]);
+      lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(p4)), weights[4]);
+      hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(p4)), weights[4]);
+      vst1q_u8(reinterpret_cast<uint8_t *>(out + x), vcombine_u8(
+            vmovn_u16(vrshrq_n_u16(lo, FRAME_BLEND_FRAC)),
+            vmovn_u16(vrshrq_n_u16(hi, FRAME_BLEND_FRAC))));
+   }
+#endif
+#elif defined(FRAME_BLEND_SSE2)
+   const __m128i w0   = _mm_set1_epi16(weights[0]);
+   const __m128i w1   = _mm_set1_epi16(weights[1]);
+   const __m128i w2   = _mm_set1_epi16(weights[2]);
+   const __m128i w3   = _mm_set1_epi16(weights[3]);
+   const __m128i w4   = _mm_set1_epi16(weights[4]);
+   const __m128i half = _mm_set1_epi16(FRAME_BLEND_HALF);
+#if FRAME_BLEND_CHANNELS == 3
+   for (; x < n; x += 8)
+   {
+      static const int shift[3] = { FRAME_BLEND_SHIFT_0, FRAME_BLEND_SHIFT_1, FRAME_BLEND_SHIFT_2 };
+      __m128i p0  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f0 + x));
+      __m128i p1  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f1 + x));
+      __m128i p2  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f2 + x));
+      __m128i p3  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f3 + x));
+      __m128i p4  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f4 + x));
+      __m128i rgb = _mm_setzero_si128();
+
+      for (unsigned c = 0; c < 3; c++)
+      {
+         __m128i sum = _mm_mullo_epi16(frame_blend_extract(p0, shift[c]), w0);
+         sum = _mm_add_epi16(sum, _mm_mullo_epi16(frame_blend_extract(p1, shift[c]), w1));
+         sum = _mm_add_epi16(sum, _mm_mullo_epi16(frame_blend_extract(p2, shift[c]), w2));
+         sum = _mm_add_epi16(sum, _mm_mullo_epi16(frame_blend_extract(p3, shift[c]), w3));
+         sum = _mm_add_epi16(sum, _mm_mullo_epi16(frame_blend_extract(p4, shift[c]), w4));
+         sum = _mm_srli_epi16(_mm_add_epi16(sum, half), FRAME_BLEND_FRAC);
+         rgb = _mm_or_si128(rgb, _mm_slli_epi16(sum, shift[c]));
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), rgb);
+   }
+#else
+   const __m128i zero = _mm_setzero_si128();
+
+   for (; x < n; x += 4)
+   {
+      __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f0 + x));
+      __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f1 + x));
+      __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f2 + x));
+      __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f3 + x));
+      __m128i p4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f4 + x));
+      __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(p0, zero), w0);
+      __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(p0, zero), w0);
+      lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(p1, zero), w1));
+      hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(p1, zero), w1));
+      lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(p2, zero), w2));
+      hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(p2, zero), w2));
+      lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(p3, zero), w3));
+      hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(p3, zero), w3));
+      lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(p4, zero), w4));
+      hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(p4, zero), w4));
+      lo = _mm_srli_epi16(_mm_add_epi16(lo, half), FRAME_BLEND_FRAC);
+      hi = _mm_srli_epi16(_mm_add_epi16(hi, half), FRAME_BLEND_FRAC);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(lo, hi));
+   }
+#endif
+#endif
+
+   for (; x < n; x++)
+   {
+      frame_blend_pixel_t rgb = 0;
+
+      for (unsigned c = 0; c < FRAME_BLEND_CHANNELS; c++)
+      {
+         unsigned sum =   weights[0] * frame_blend_channel(f0[x], c)
+                        + weights[1] * frame_blend_channel(f1[x], c)
+                        + weights[2] * frame_blend_channel(f2[x], c)
+                        + weights[3] * frame_blend_channel(f3[x], c)
+                        + weights[4] * frame_blend_channel(f4[x], c);
+         rgb |= frame_blend_repack((sum + FRAME_BLEND_HALF) >> FRAME_BLEND_FRAC, c);
+      }
+
+      out[x] = rgb;
+   }
+}
+
+/* Blends curr 50:50 into a running average kept in acc
+ * with FRAME_BLEND_FRAC fractional bits, and outputs the
+ * rounded average */
+static void blend_line_lcd_ghost_fast(frame_blend_pixel_t *out,
+      const frame_blend_pixel_t *curr, unsigned short *acc, unsigned n)
+{
+   unsigned x = 0;
+
+#ifdef FRAME_BLEND_NEON
+#if FRAME_BLEND_CHANNELS == 3
+   for (; x < n; x += 8)
+   {
+      static const int shift[3] = { FRAME_BLEND_SHIFT_0, FRAME_BLEND_SHIFT_1, FRAME_BLEND_SHIFT_2 };
+      uint16x8_t px  = vld1q_u16(curr + x);
+      uint16x8_t rgb = vdupq_n_u16(0);
+
+      for (unsigned c = 0; c < 3; c++)
+      {
+         uint16_t *a  = acc + c * n + x;
+         uint16x8_t v = vrhaddq_u16(vshlq_n_u16(frame_blend_extract(px, shift[c]), FRAME_BLEND_FRAC),
+               vld1q_u16(a));
+         vst1q_u16(a, v);
+         rgb = vorrq_u16(rgb, frame_blend_insert(vrshrq_n_u16(v, FRAME_BLEND_FRAC), shift[c]));
+      }
+
+      vst1q_u16(out + x, rgb);
+   }
+#else
+   for (; x < n; x += 4)
+   {
+      uint8x16_t px = vld1q_u8(reinterpret_cast<const uint8_t *>(curr + x));
+      uint16x8_t lo = vrhaddq_u16(vshll_n_u8(vget_low_u8(px), 8), vld1q_u16(acc + x * 4));
+      uint16x8_t hi = vrhaddq_u16(vshll_n_u8(vget_high_u8(px), 8), vld1q_u16(acc + x * 4 + 8));
+      vst1q_u16(acc + x * 4, lo);
+      vst1q_u16(acc + x * 4 + 8, hi);
+      vst1q_u8(reinterpret_cast<uint8_t *>(out + x), vcombine_u8(
+            vmovn_u16(vrshrq_n_u16(lo, FRAME_BLEND_FRAC)),
+            vmovn_u16(vrshrq_n_u16(hi, FRAME_BLEND_FRAC))));
+   }
+#endif
+#elif defined(FRAME_BLEND_SSE2)
+   const __m128i half = _mm_set1_epi16(FRAME_BLEND_HALF);
+#if FRAME_BLEND_CHANNELS == 3
+   for (; x < n; x += 8)
+   {
+      static const int shift[3] = { FRAME_BLEND_SHIFT_0, FRAME_BLEND_SHIFT_1, FRAME_BLEND_SHIFT_2 };
+      __m128i px  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(curr + x));
+      __m128i rgb = _mm_setzero_si128();
+
+      for (unsigned c = 0; c < 3; c++)
+      {
+         __m128i *a = reinterpret_cast<__m128i *>(acc + c * n + x);
+         __m128i v  = _mm_avg_epu16(_mm_slli_epi16(frame_blend_extract(px, shift[c]), FRAME_BLEND_FRAC),
+               _mm_loadu_si128(a));
+         _mm_storeu_si128(a, v);
+         v   = _mm_srli_epi16(_mm_add_epi16(v, half), FRAME_BLEND_FRAC);
+         rgb = _mm_or_si128(rgb, _mm_slli_epi16(v, shift[c]));
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), rgb);
+   }
+#else
+   const __m128i zero = _mm_setzero_si128();
+
+   for (; x < n; x += 4)
+   {
+      __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(curr + x));
+      __m128i *a = reinterpret_cast<__m128i *>(acc + x * 4);
+      /* Unpacking into the high bytes shifts left by 8 */
+      __m128i lo = _mm_avg_epu16(_mm_unpacklo_epi8(zero, px), _mm_loadu_si128(a));
+      __m128i hi = _mm_avg_epu16(_mm_unpackhi_epi8(zero, px), _mm_loadu_si128(a + 1));
+      _mm_storeu_si128(a, lo);
+      _mm_storeu_si128(a + 1, hi);
+      lo = _mm_srli_epi16(_mm_add_epi16(lo, half), FRAME_BLEND_FRAC);
+      hi = _mm_srli_epi16(_mm_add_epi16(hi, half), FRAME_BLEND_FRAC);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(lo, hi));
+   }
+#endif
+#endif
+
+   for (; x < n; x++)
+   {
+      frame_blend_pixel_t rgb = 0;
+
+      for (unsigned c = 0; c < FRAME_BLEND_CHANNELS; c++)
+      {
+         unsigned short *a = acc + frame_blend_acc_index(x, c, n);
+         unsigned v = ((frame_blend_channel(curr[x], c) << FRAME_BLEND_FRAC) + *a + 1) >> 1;
+         *a   = static_cast<unsigned short>(v);
+         rgb |= frame_blend_repack((v + FRAME_BLEND_HALF) >> FRAME_BLEND_FRAC, c);
+      }
+
+      out[x] = rgb;
+   }
+}
+
+#endif
@@ -5,12 +5,17 @@
 #include "gambatte_log.h"
 #include "blipper.h"
 #include "cc_resampler.h"
+#include "frame_blend.h"
 #include "gambatte.h"
 #include "gbcpalettes.h"
 #include "bootloader.h"
 #ifdef HAVE_NETWORK
 #include "net_serial.h"
 #endif
+#ifdef HAVE_BLEND_THREAD
+#include <pthread.h>
+#include <semaphore.h>
+#endif
 
 #if defined(__DJGPP__) && defined(__STRICT_ANSI__)
 /* keep this above libretro-common includes */
@@ -76,6 +81,8 @@ static unsigned turbo_period         = TURBO_PERIOD_MIN;
 static unsigned turbo_pulse_width    = TURBO_PULSE_WIDTH_MIN;
 static unsigned turbo_a_counter      = 0;
 static unsigned turbo_b_counter      = 0;
+static bool rewind_enabled           = false;
+static bool rewind_requested         = false;
 
 static bool rom_loaded = false;
 
@@ -91,6 +98,48 @@ static gambatte::GB gb2;
 #define NUM_GAMEBOYS 1
 #endif
 
+//Run-ahead keeps a second GB loaded with the same ROM. Each frame it is
+//resynced to the main one and run a few frames further with the same input,
+//and only its last frame is shown. Its sound is thrown away, it has no
+//serial link, and it never drives rumble.
+static gambatte::GB gb_ahead;
+static unsigned runahead_frames    = 0;
+static bool runahead_loaded        = false;
+static bool runahead_running       = false;
+static unsigned char *runahead_state = NULL;
+
+//Video settings live in the LCD rather than in savestates,
+//so they have to be applied to both instances.
+static void set_dmg_palette_color(unsigned palnum, unsigned colornum, unsigned rgb32)
+{
+   gb.setDmgPaletteColor(palnum, colornum, rgb32);
+   gb_ahead.setDmgPaletteColor(palnum, colornum, rgb32);
+}
+
+static void set_color_correction(bool enable)
+{
+   gb.setColorCorrection(enable);
+   gb_ahead.setColorCorrection(enable);
+}
+
+static void set_color_correction_mode(unsigned mode)
+{
+   gb.setColorCorrectionMode(mode);
+   gb_ahead.setColorCorrectionMode(mode);
+}
+
+static void set_color_correction_brightness(float brightness)
+{
+   gb.setColorCorrectionBrightness(brightness);
+   gb_ahead.setColorCorrectionBrightness(brightness);
+}
+
+static void set_dark_filter_level(unsigned level)
+{
+   gb.setDarkFilterLevel(level);
+   gb_ahead.setDarkFilterLevel(level);
+}
+
 bool use_official_bootloader = false;
 
 #define GB_SCREEN_WIDTH 160
@@ -115,6 +164,10 @@ bool use_official_bootloader = false;
 
 #define SOUND_SAMPLE_RATE_CC      (SOUND_SAMPLE_RATE_NATIVE / CC_DECIMATION_RATE) /* ~64k */
 #define SOUND_SAMPLE_RATE_BLIPPER (SOUND_SAMPLE_RATE_NATIVE / 64) /* ~32k */
+/* With the 'core' resampler, libgambatte writes the sound at
+ * this rate itself, in runs of up to CORE_SOUND_SAMPLES_PER_RUN */
+#define SOUND_SAMPLE_RATE_CORE    48000
+#define CORE_SOUND_SAMPLES_PER_RUN 1024
 
 /* GB::runFor() nominally generates up to
  * (SOUND_SAMPLES_PER_RUN + 2064) samples, which
@@ -137,6 +190,7 @@ static blipper_t *resampler_l = NULL;
 static blipper_t *resampler_r = NULL;
 
 static bool use_cc_resampler = false;
+static bool use_core_resampler = false;
 
 static int16_t *audio_out_buffer     = NULL;
 static size_t audio_out_buffer_size  = 0;
@@ -145,8 +199,8 @@ static size_t audio_batch_frames_max = (1 << 16);
 
 static void audio_out_buffer_init(void)
 {
-   float sample_rate       = use_cc_resampler ?
-         SOUND_SAMPLE_RATE_CC : SOUND_SAMPLE_RATE_BLIPPER;
+   float sample_rate       = use_core_resampler ? SOUND_SAMPLE_RATE_CORE :
+         use_cc_resampler ? SOUND_SAMPLE_RATE_CC : SOUND_SAMPLE_RATE_BLIPPER;
    float samples_per_frame = sample_rate / VIDEO_REFRESH_RATE;
    size_t buffer_size      = ((size_t)samples_per_frame + 1) << 1;
 
@@ -214,8 +268,8 @@ static void audio_out_buffer_read_blipper(size_t num_samples)
    audio_out_buffer_resize(num_samples);
    audio_out_buffer_ptr = audio_out_buffer + audio_out_buffer_pos;
 
-   blipper_read(resampler_l, audio_out_buffer_ptr    , num_samples, 2);
-   blipper_read(resampler_r, audio_out_buffer_ptr + 1, num_samples, 2);
+   blipper_read_stereo(resampler_l, resampler_r,
+         audio_out_buffer_ptr, num_samples);
 
    audio_out_buffer_pos += num_samples << 1;
 }
@@ -245,13 +299,30 @@ static void audio_upload_samples(void)
    audio_out_buffer_pos = 0;
 }
 
-static void blipper_renderaudio(const int16_t *samples, unsigned frames)
+/* With the sinc resampler, the core passes the changes of
+ * its output straight to blipper, and never writes out the
+ * native-rate samples that blipper would only turn back into
+ * deltas. A delta at sample n is n + 1 clocks ahead, as with
+ * blipper_push_samples() */
+class blipper_audio_sink : public gambatte::AudioSink
+{
+public:
+   virtual void delta(unsigned time, int left, int right)
+   {
+      blipper_push_delta_stereo_at(resampler_l, resampler_r,
+            left, right, time + 1);
+   }
+};
+
+static blipper_audio_sink blipper_sink;
+
+static void blipper_renderaudio(unsigned frames)
 {
    if (!frames)
       return;
 
-   blipper_push_samples(resampler_l, samples + 0, frames, 2);
-   blipper_push_samples(resampler_r, samples + 1, frames, 2);
+   blipper_advance(resampler_l, frames);
+   blipper_advance(resampler_r, frames);
 }
 
 static void audio_resampler_deinit(void)
@@ -264,13 +335,16 @@ static void audio_resampler_deinit(void)
 
    resampler_l = NULL;
    resampler_r = NULL;
+   gb.setAudioSink(NULL);
 
    audio_out_buffer_deinit();
 }
 
 static void audio_resampler_init(bool startup)
 {
-   if (use_cc_resampler)
+   if (use_core_resampler)
+      gb.setSampleRate(SOUND_SAMPLE_RATE_CORE);
+   else if (use_cc_resampler)
       CC_init();
    else
    {
@@ -326,6 +400,8 @@ static void audio_resampler_init(bool startup)
             environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &av_info);
          }
       }
+      else
+         gb.setAudioSink(&blipper_sink);
    }
 
    audio_out_buffer_init();
@@ -654,12 +730,6 @@ static void palette_switch_set_index(size_t palette_index)
 /*****************************/
 
 #define LCD_RESPONSE_TIME 0.333f
-/* > 'LCD Ghosting (Fast)' method does not
- *   correctly interpret the set response time,
- *   leading to an artificially subdued blur effect.
- *   We have to compensate for this by increasing
- *   the response time, hence this 'fake' value */
-#define LCD_RESPONSE_TIME_FAKE 0.5f
 
 enum frame_blend_method
 {
@@ -669,330 +739,350 @@ enum frame_blend_method
    FRAME_BLEND_LCD_GHOSTING_FAST
 };
 
-static enum frame_blend_method frame_blend_type  = FRAME_BLEND_NONE;
-static gambatte::video_pixel_t* video_buf_prev_1 = NULL;
-static gambatte::video_pixel_t* video_buf_prev_2 = NULL;
-static gambatte::video_pixel_t* video_buf_prev_3 = NULL;
-static gambatte::video_pixel_t* video_buf_prev_4 = NULL;
-static float* video_buf_acc_r                    = NULL;
-static float* video_buf_acc_g                    = NULL;
-static float* video_buf_acc_b                    = NULL;
-static float frame_blend_response[4]             = {0.0f};
-static bool frame_blend_response_set             = false;
-static void (*blend_frames)(void)                = NULL;
-
-/* > Note: The individual frame blending functions
- *   are somewhat WET (Write Everything Twice), in that
- *   we duplicate the entire nested for loop.
- *   This code is performance-critical, so we want to
- *   minimise logic in the inner loops where possible  */
-static void blend_frames_mix(void)
-{
-   gambatte::video_pixel_t *curr = video_buf;
-   gambatte::video_pixel_t *prev = video_buf_prev_1;
-   size_t x, y;
+#define FRAME_BLEND_HISTORY (FRAME_BLEND_GHOST_FRAMES + 1)
+/* Threaded blending needs one more slot than the blend
+ * reads, for the core to draw the next frame into */
+#define FRAME_BLEND_SLOTS   (FRAME_BLEND_HISTORY + 1)
+
+/* While blending, the core draws each frame into the next
+ * slot of a ring of history buffers, and the blend writes
+ * the output to video_buf. Frames then age by moving the
+ * ring position rather than by being copied. Without
+ * blending (or with 'fast' LCD ghosting, which blends in
+ * place) video_draw_buf is video_buf itself */
+static enum frame_blend_method frame_blend_type                   = FRAME_BLEND_NONE;
+static gambatte::video_pixel_t* video_draw_buf                    = NULL;
+static gambatte::video_pixel_t* video_buf_history[FRAME_BLEND_SLOTS] = {NULL};
+static unsigned video_buf_history_size                            = 0;
+static unsigned video_buf_history_pos                             = 0;
+static unsigned short* video_buf_acc                              = NULL;
+static unsigned short frame_blend_weights[FRAME_BLEND_HISTORY]    = {0};
+static unsigned frame_blend_frames                                = 0;
+static void (*blend_frames)(gambatte::video_pixel_t *out,
+      const gambatte::video_pixel_t *const *frames)               = NULL;
+
+/* Blending functions take the current frame in frames[0],
+ * followed by the frame_blend_frames - 1 before it */
+static void blend_frames_mix(gambatte::video_pixel_t *out,
+      const gambatte::video_pixel_t *const *frames)
+{
+   const gambatte::video_pixel_t *curr = frames[0];
+   const gambatte::video_pixel_t *prev = frames[1];
+   size_t y;
 
    for (y = 0; y < VIDEO_HEIGHT; y++)
    {
-      for (x = 0; x < VIDEO_WIDTH; x++)
-      {
-         /* Get colours from current + previous frames */
-         gambatte::video_pixel_t rgb_curr = *(curr + x);
-         gambatte::video_pixel_t rgb_prev = *(prev + x);
-
-         /* Store colours for next frame */
-         *(prev + x) = rgb_curr;
-
-         /* Mix colours
-          * > "Mixing Packed RGB Pixels Efficiently"
-          *   http://blargg.8bitalley.com/info/rgb_mixing.html */
-#ifdef VIDEO_RGB565
-         *(curr + x) = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x821)) >> 1;
-#elif defined(VIDEO_ABGR1555)
-         *(curr + x) = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x521)) >> 1;
-#else
-         *(curr + x) = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x10101)) >> 1;
-#endif
-      }
+      blend_line_mix(out, curr, prev, VIDEO_WIDTH);
 
+      out  += VIDEO_PITCH;
       curr += VIDEO_PITCH;
       prev += VIDEO_PITCH;
    }
 }
 
-static void blend_frames_lcd_ghost(void)
+static void blend_frames_lcd_ghost(gambatte::video_pixel_t *out,
+      const gambatte::video_pixel_t *const *frames)
 {
-   gambatte::video_pixel_t *curr   = video_buf;
-   gambatte::video_pixel_t *prev_1 = video_buf_prev_1;
-   gambatte::video_pixel_t *prev_2 = video_buf_prev_2;
-   gambatte::video_pixel_t *prev_3 = video_buf_prev_3;
-   gambatte::video_pixel_t *prev_4 = video_buf_prev_4;
-   float *response                 = frame_blend_response;
-   size_t x, y;
+   const gambatte::video_pixel_t *lines[FRAME_BLEND_HISTORY];
+   size_t i, y;
+
+   for (i = 0; i < FRAME_BLEND_HISTORY; i++)
+      lines[i] = frames[i];
 
    for (y = 0; y < VIDEO_HEIGHT; y++)
    {
-      for (x = 0; x < VIDEO_WIDTH; x++)
-      {
-         /* Get colours from current + previous frames */
-         gambatte::video_pixel_t rgb_curr   = *(curr + x);
-         gambatte::video_pixel_t rgb_prev_1 = *(prev_1 + x);
-         gambatte::video_pixel_t rgb_prev_2 = *(prev_2 + x);
-         gambatte::video_pixel_t rgb_prev_3 = *(prev_3 + x);
-         gambatte::video_pixel_t rgb_prev_4 = *(prev_4 + x);
-
-         /* Store colours for next frame */
-         *(prev_1 + x) = rgb_curr;
-         *(prev_2 + x) = rgb_prev_1;
-         *(prev_3 + x) = rgb_prev_2;
-         *(prev_4 + x) = rgb_prev_3;
-
-         /* Unpack colours and convert to float */
-#ifdef VIDEO_RGB565
-         float r_curr = static_cast<float>(rgb_curr >> 11 & 0x1F);
-         float g_curr = static_cast<float>(rgb_curr >>  6 & 0x1F);
-         float b_curr = static_cast<float>(rgb_curr       & 0x1F);
+      blend_line_lcd_ghost(out, lines, frame_blend_weights, VIDEO_WIDTH);
 
-         float r_prev_1 = static_cast<float>(rgb_prev_1 >> 11 & 0x1F);
-         float g_prev_1 = static_cast<float>(rgb_prev_1 >>  6 & 0x1F);
-         float b_prev_1 = static_cast<float>(rgb_prev_1       & 0x1F);
+      out += VIDEO_PITCH;
+      for (i = 0; i < FRAME_BLEND_HISTORY; i++)
+         lines[i] += VIDEO_PITCH;
+   }
+}
 
-         float r_prev_2 = static_cast<float>(rgb_prev_2 >> 11 & 0x1F);
-         float g_prev_2 = static_cast<float>(rgb_prev_2 >>  6 & 0x1F);
-         float b_prev_2 = static_cast<float>(rgb_prev_2       & 0x1F);
+static void blend_frames_lcd_ghost_fast(gambatte::video_pixel_t *out,
+      const gambatte::video_pixel_t *const *frames)
+{
+   const gambatte::video_pixel_t *curr = frames[0];
+   unsigned short *acc                 = video_buf_acc;
+   size_t y;
 
-         float r_prev_3 = static_cast<float>(rgb_prev_3 >> 11 & 0x1F);
-         float g_prev_3 = static_cast<float>(rgb_prev_3 >>  6 & 0x1F);
-         float b_prev_3 = static_cast<float>(rgb_prev_3       & 0x1F);
+   for (y = 0; y < VIDEO_HEIGHT; y++)
+   {
+      blend_line_lcd_ghost_fast(out, curr, acc, VIDEO_WIDTH);
 
-         float r_prev_4 = static_cast<float>(rgb_prev_4 >> 11 & 0x1F);
-         float g_prev_4 = static_cast<float>(rgb_prev_4 >>  6 & 0x1F);
-         float b_prev_4 = static_cast<float>(rgb_prev_4       & 0x1F);
-#elif defined(VIDEO_ABGR1555)
-         float r_curr = static_cast<float>(rgb_curr       & 0x1F);
-         float g_curr = static_cast<float>(rgb_curr >>  5 & 0x1F);
-         float b_curr = static_cast<float>(rgb_curr >> 10 & 0x1F);
+      out  += VIDEO_PITCH;
+      curr += VIDEO_PITCH;
+      acc  += VIDEO_WIDTH * FRAME_BLEND_CHANNELS;
+   }
+}
 
-         float r_prev_1 = static_cast<float>(rgb_prev_1       & 0x1F);
-         float g_prev_1 = static_cast<float>(rgb_prev_1 >>  5 & 0x1F);
-         float b_prev_1 = static_cast<float>(rgb_prev_1 >> 10 & 0x1F);
+/* Fills frames with the frames blend_frames() reads, then
+ * moves the core on to the next (oldest) history slot */
+static void take_blend_frames(const gambatte::video_pixel_t **frames)
+{
+   unsigned i;
 
-         float r_prev_2 = static_cast<float>(rgb_prev_2       & 0x1F);
-         float g_prev_2 = static_cast<float>(rgb_prev_2 >>  5 & 0x1F);
-         float b_prev_2 = static_cast<float>(rgb_prev_2 >> 10 & 0x1F);
+   if (!video_buf_history_size)
+   {
+      frames[0] = video_draw_buf;
+      return;
+   }
 
-         float r_prev_3 = static_cast<float>(rgb_prev_3       & 0x1F);
-         float g_prev_3 = static_cast<float>(rgb_prev_3 >>  5 & 0x1F);
-         float b_prev_3 = static_cast<float>(rgb_prev_3 >> 10 & 0x1F);
+   for (i = 0; i < frame_blend_frames; i++)
+      frames[i] = video_buf_history[(video_buf_history_pos + video_buf_history_size - i) %
+            video_buf_history_size];
 
-         float r_prev_4 = static_cast<float>(rgb_prev_4       & 0x1F);
-         float g_prev_4 = static_cast<float>(rgb_prev_4 >>  5 & 0x1F);
-         float b_prev_4 = static_cast<float>(rgb_prev_4 >> 10 & 0x1F);
-#else
-         float r_curr = static_cast<float>(rgb_curr >> 16 & 0x1F);
-         float g_curr = static_cast<float>(rgb_curr >>  8 & 0x1F);
-         float b_curr = static_cast<float>(rgb_curr       & 0x1F);
+   video_buf_history_pos = (video_buf_history_pos + 1) % video_buf_history_size;
+   video_draw_buf        = video_buf_history[video_buf_history_pos];
+}
 
-         float r_prev_1 = static_cast<float>(rgb_prev_1 >> 16 & 0x1F);
-         float g_prev_1 = static_cast<float>(rgb_prev_1 >>  8 & 0x1F);
-         float b_prev_1 = static_cast<float>(rgb_prev_1       & 0x1F);
+#ifdef HAVE_BLEND_THREAD
+/* Threaded blending: frame N is blended on a worker thread
+ * while retro_run() emulates frame N + 1, and is shown at
+ * the end of that call (one frame later than otherwise).
+ * The worker alternates between two output buffers, so the
+ * one shown is never the one being written. The job and
+ * the buffers change hands through the two semaphores
+ * only; neither thread takes a lock */
+struct blend_job
+{
+   void (*blend)(gambatte::video_pixel_t *out,
+         const gambatte::video_pixel_t *const *frames);
+   gambatte::video_pixel_t *out;
+   const gambatte::video_pixel_t *frames[FRAME_BLEND_HISTORY];
+};
 
-         float r_prev_2 = static_cast<float>(rgb_prev_2 >> 16 & 0x1F);
-         float g_prev_2 = static_cast<float>(rgb_prev_2 >>  8 & 0x1F);
-         float b_prev_2 = static_cast<float>(rgb_prev_2       & 0x1F);
+static bool frame_blend_threaded                  = false;
+static bool blend_thread_running                  = false;
+static pthread_t blend_thread;
+static sem_t blend_job_sem;
+static sem_t blend_done_sem;
+static struct blend_job blend_thread_job;
+static bool blend_job_pending                     = false;
+static bool blend_output_ready                    = false;
+static gambatte::video_pixel_t* video_out_buf[2]  = {NULL};
+static unsigned video_out_index                   = 0;
+
+static void *blend_thread_main(void *)
+{
+   for (;;)
+   {
+      while (sem_wait(&blend_job_sem))
+         continue;
 
-         float r_prev_3 = static_cast<float>(rgb_prev_3 >> 16 & 0x1F);
-         float g_prev_3 = static_cast<float>(rgb_prev_3 >>  8 & 0x1F);
-         float b_prev_3 = static_cast<float>(rgb_prev_3       & 0x1F);
+      /* A job without a blend function asks us to quit */
+      if (!blend_thread_job.blend)
+         return NULL;
 
-         float r_prev_4 = static_cast<float>(rgb_prev_4 >> 16 & 0x1F);
-         float g_prev_4 = static_cast<float>(rgb_prev_4 >>  8 & 0x1F);
-         float b_prev_4 = static_cast<float>(rgb_prev_4       & 0x1F);
-#endif
-         /* Mix colours for current frame and convert back to video_pixel_t
-          * > Response time effect implemented via an exponential
-          *   drop-off algorithm, taken from the 'Gameboy Classic Shader'
-          *   by Harlequin:
-          *      https://github.com/libretro/glsl-shaders/blob/master/handheld/shaders/gameboy/shader-files/gb-pass0.glsl */
-         r_curr += (r_prev_1 - r_curr) * *response;
-         r_curr += (r_prev_2 - r_curr) * *(response + 1);
-         r_curr += (r_prev_3 - r_curr) * *(response + 2);
-         r_curr += (r_prev_4 - r_curr) * *(response + 3);
-         gambatte::video_pixel_t r_mix = static_cast<gambatte::video_pixel_t>(r_curr + 0.5f) & 0x1F;
-
-         g_curr += (g_prev_1 - g_curr) * *response;
-         g_curr += (g_prev_2 - g_curr) * *(response + 1);
-         g_curr += (g_prev_3 - g_curr) * *(response + 2);
-         g_curr += (g_prev_4 - g_curr) * *(response + 3);
-         gambatte::video_pixel_t g_mix = static_cast<gambatte::video_pixel_t>(g_curr + 0.5f) & 0x1F;
-
-         b_curr += (b_prev_1 - b_curr) * *response;
-         b_curr += (b_prev_2 - b_curr) * *(response + 1);
-         b_curr += (b_prev_3 - b_curr) * *(response + 2);
-         b_curr += (b_prev_4 - b_curr) * *(response + 3);
-         gambatte::video_pixel_t b_mix = static_cast<gambatte::video_pixel_t>(b_curr + 0.5f) & 0x1F;
-
-         /* Repack colours for current frame */
-#ifdef VIDEO_RGB565
-         *(curr + x) = r_mix << 11 | g_mix << 6 | b_mix;
-#elif defined(VIDEO_ABGR1555)
-         *(curr + x) = b_mix << 10 | g_mix << 5 | b_mix;
-#else
-         *(curr + x) = r_mix << 16 | g_mix << 8 | b_mix;
-#endif
-      }
-
-      curr   += VIDEO_PITCH;
-      prev_1 += VIDEO_PITCH;
-      prev_2 += VIDEO_PITCH;
-      prev_3 += VIDEO_PITCH;
-      prev_4 += VIDEO_PITCH;
+      blend_thread_job.blend(blend_thread_job.out, blend_thread_job.frames);
+      sem_post(&blend_done_sem);
    }
 }
 
-static void blend_frames_lcd_ghost_fast(void)
+static void wait_blend_thread(void)
 {
-   gambatte::video_pixel_t *curr = video_buf;
-   float *prev_r                 = video_buf_acc_r;
-   float *prev_g                 = video_buf_acc_g;
-   float *prev_b                 = video_buf_acc_b;
-   size_t x, y;
+   if (!blend_job_pending)
+      return;
 
-   for (y = 0; y < VIDEO_HEIGHT; y++)
+   while (sem_wait(&blend_done_sem))
+      continue;
+
+   blend_job_pending = false;
+}
+
+static bool start_blend_thread(void)
+{
+   if (!video_out_buf[1])
    {
-      for (x = 0; x < VIDEO_WIDTH; x++)
-      {
-         /* Get colours from current + previous frames */
-         gambatte::video_pixel_t rgb_curr   = *(curr + x);
-         float r_prev                       = *(prev_r + x);
-         float g_prev                       = *(prev_g + x);
-         float b_prev                       = *(prev_b + x);
+      video_out_buf[1] = (gambatte::video_pixel_t*)malloc(VIDEO_BUFF_SIZE);
+      if (!video_out_buf[1])
+         return false;
+   }
 
-         /* Unpack current colours and convert to float */
-#ifdef VIDEO_RGB565
-         float r_curr = static_cast<float>(rgb_curr >> 11 & 0x1F);
-         float g_curr = static_cast<float>(rgb_curr >>  6 & 0x1F);
-         float b_curr = static_cast<float>(rgb_curr       & 0x1F);
-#elif defined(VIDEO_ABGR1555)
-         float r_curr = static_cast<float>(rgb_curr       & 0x1F);
-         float g_curr = static_cast<float>(rgb_curr >>  5 & 0x1F);
-         float b_curr = static_cast<float>(rgb_curr >> 10 & 0x1F);
-#else
-         float r_curr = static_cast<float>(rgb_curr >> 16 & 0x1F);
-         float g_curr = static_cast<float>(rgb_curr >>  8 & 0x1F);
-         float b_curr = static_cast<float>(rgb_curr       & 0x1F);
+   video_out_buf[0] = video_buf;
+
+   if (sem_init(&blend_job_sem, 0, 0))
+      return false;
+
+   if (sem_init(&blend_done_sem, 0, 0))
+   {
+      sem_destroy(&blend_job_sem);
+      return false;
+   }
+
+   if (pthread_create(&blend_thread, NULL, blend_thread_main, NULL))
+   {
+      sem_destroy(&blend_done_sem);
+      sem_destroy(&blend_job_sem);
+      return false;
+   }
+
+   blend_thread_running = true;
+   blend_output_ready   = false;
+   return true;
+}
+
+static void stop_blend_thread(void)
+{
+   if (!blend_thread_running)
+      return;
+
+   wait_blend_thread();
+   blend_thread_job.blend = NULL;
+   sem_post(&blend_job_sem);
+   pthread_join(blend_thread, NULL);
+
+   sem_destroy(&blend_done_sem);
+   sem_destroy(&blend_job_sem);
+   blend_thread_running = false;
+}
 #endif
-         /* Mix colours for current frame */
-         float r_mix = (r_curr * (1.0f - LCD_RESPONSE_TIME_FAKE)) + (LCD_RESPONSE_TIME_FAKE * r_prev);
-         float g_mix = (g_curr * (1.0f - LCD_RESPONSE_TIME_FAKE)) + (LCD_RESPONSE_TIME_FAKE * g_prev);
-         float b_mix = (b_curr * (1.0f - LCD_RESPONSE_TIME_FAKE)) + (LCD_RESPONSE_TIME_FAKE * b_prev);
 
-         /* Store colours for next frame */
-         *(prev_r + x) = r_mix;
-         *(prev_g + x) = g_mix;
-         *(prev_b + x) = b_mix;
+/* Passes the frame just drawn on to the frontend,
+ * blending it first if required */
+static void output_video_frame(void)
+{
+   const gambatte::video_pixel_t *frames[FRAME_BLEND_HISTORY];
 
-         /* Convert, repack and assign colours for current frame */
-#ifdef VIDEO_RGB565
-         *(curr + x) =   (static_cast<gambatte::video_pixel_t>(r_mix + 0.5f) & 0x1F) << 11
-                       | (static_cast<gambatte::video_pixel_t>(g_mix + 0.5f) & 0x1F) << 6
-                       | (static_cast<gambatte::video_pixel_t>(b_mix + 0.5f) & 0x1F);
-#elif defined(ABGR1555)
-         *(curr + x) =   (static_cast<gambatte::video_pixel_t>(r_mix + 0.5f) & 0x1F)
-                       | (static_cast<gambatte::video_pixel_t>(g_mix + 0.5f) & 0x1F) << 5
-                       | (static_cast<gambatte::video_pixel_t>(b_mix + 0.5f) & 0x1F) << 10;
-#else
-         *(curr + x) =   (static_cast<gambatte::video_pixel_t>(r_mix + 0.5f) & 0x1F) << 16
-                       | (static_cast<gambatte::video_pixel_t>(g_mix + 0.5f) & 0x1F) << 8
-                       | (static_cast<gambatte::video_pixel_t>(b_mix + 0.5f) & 0x1F);
+#ifdef HAVE_BLEND_THREAD
+   if (blend_thread_running && blend_frames)
+   {
+      gambatte::video_pixel_t *done;
+
+      wait_blend_thread();
+      done = blend_output_ready ? video_out_buf[video_out_index] : NULL;
+
+      video_out_index ^= 1;
+      take_blend_frames(blend_thread_job.frames);
+      blend_thread_job.blend = blend_frames;
+      blend_thread_job.out   = video_out_buf[video_out_index];
+      blend_job_pending      = true;
+      blend_output_ready     = true;
+      sem_post(&blend_job_sem);
+
+      /* Nothing has been blended yet on the first frame
+       * after starting, so the last one is repeated */
+      video_cb(done, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_PITCH * sizeof(gambatte::video_pixel_t));
+      return;
+   }
 #endif
-      }
 
-      curr   += VIDEO_PITCH;
-      prev_r += VIDEO_PITCH;
-      prev_g += VIDEO_PITCH;
-      prev_b += VIDEO_PITCH;
+   /* Perform interframe blending, if required */
+   if (blend_frames)
+   {
+      take_blend_frames(frames);
+      blend_frames(video_buf, frames);
    }
+
+   video_cb(video_buf, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_PITCH * sizeof(gambatte::video_pixel_t));
 }
 
-static bool allocate_video_buf_prev(gambatte::video_pixel_t** buf)
+static bool allocate_video_buf_history(unsigned size)
 {
-   if (!*buf)
+   unsigned i;
+
+   for (i = 0; i < size; i++)
    {
-      *buf = (gambatte::video_pixel_t*)malloc(VIDEO_BUFF_SIZE);
-      if (!*buf)
-         return false;
+      if (!video_buf_history[i])
+      {
+         video_buf_history[i] = (gambatte::video_pixel_t*)malloc(VIDEO_BUFF_SIZE);
+         if (!video_buf_history[i])
+            return false;
+      }
+      memset(video_buf_history[i], 0, VIDEO_BUFF_SIZE);
    }
-   memset(*buf, 0, VIDEO_BUFF_SIZE);
+
+   video_buf_history_size = size;
+   video_buf_history_pos  = 0;
+   video_draw_buf         = size ? video_buf_history[0] : video_buf;
    return true;
 }
 
 static bool allocate_video_buf_acc(void)
 {
-   size_t i;
-   size_t buf_size = 256 * NUM_GAMEBOYS * VIDEO_HEIGHT * sizeof(float);
+   size_t buf_size = VIDEO_WIDTH * FRAME_BLEND_CHANNELS * VIDEO_HEIGHT * sizeof(unsigned short);
 
-   if (!video_buf_acc_r)
+   if (!video_buf_acc)
    {
-      video_buf_acc_r = (float*)malloc(buf_size);
-      if (!video_buf_acc_r)
+      video_buf_acc = (unsigned short*)malloc(buf_size);
+      if (!video_buf_acc)
          return false;
    }
 
-   if (!video_buf_acc_g)
-   {
-      video_buf_acc_g = (float*)malloc(buf_size);
-      if (!video_buf_acc_g)
-         return false;
-   }
+   memset(video_buf_acc, 0, buf_size);
+   return true;
+}
 
-   if (!video_buf_acc_b)
-   {
-      video_buf_acc_b = (float*)malloc(buf_size);
-      if (!video_buf_acc_b)
-         return false;
-   }
+/* Response time effect implemented via an exponential
+ * drop-off algorithm, taken from the 'Gameboy Classic Shader'
+ * by Harlequin:
+ *    https://github.com/libretro/glsl-shaders/blob/master/handheld/shaders/gameboy/shader-files/gb-pass0.glsl
+ * Each previous frame n (1-4) is mixed into the current
+ * colour in turn with a factor of pow(LCD_RESPONSE_TIME, n).
+ * As this is linear, it amounts to fixed weights for the
+ * five frames, which are precomputed here */
+static void init_frame_blend_weights(void)
+{
+   /* For the default response time of 0.333,
+    * only four previous samples are required
+    * since the response factor for the fifth
+    * is:
+    *    pow(LCD_RESPONSE_TIME, 5.0f) -> 0.00409
+    * ...which is less than half a percent, and
+    * therefore irrelevant.
+    * If the response time were significantly
+    * increased, we may need to rethink this
+    * (but more samples == greater performance
+    * overheads) */
+   float remaining = 1.0f;
+   unsigned total  = 0;
+   unsigned i;
 
-   /* Cannot use memset() on arrays of floats... */
-   for (i = 0; i < (256 * NUM_GAMEBOYS * VIDEO_HEIGHT); i++)
+   for (i = FRAME_BLEND_GHOST_FRAMES; i > 0; i--)
    {
-      video_buf_acc_r[i] = 0.0f;
-      video_buf_acc_g[i] = 0.0f;
-      video_buf_acc_b[i] = 0.0f;
+      float response = std::pow(LCD_RESPONSE_TIME, static_cast<float>(i));
+      frame_blend_weights[i] = static_cast<unsigned short>(
+            response * remaining * FRAME_BLEND_ONE + 0.5f);
+      total     += frame_blend_weights[i];
+      remaining *= 1.0f - response;
    }
-   return true;
+
+   frame_blend_weights[0] = static_cast<unsigned short>(FRAME_BLEND_ONE - total);
 }
 
 static void init_frame_blending(void)
 {
-   blend_frames = NULL;
+   bool threaded = false;
+   unsigned slots;
 
-   /* Allocate interframe blending buffers, as required
-    * NOTE: In all cases, any used buffers are 'reset'
-    * to avoid drawing garbage on the next frame */
+   blend_frames           = NULL;
+   video_draw_buf         = video_buf;
+   video_buf_history_size = 0;
+
+#ifdef HAVE_BLEND_THREAD
+   /* The worker may still be reading the old buffers */
+   stop_blend_thread();
+   threaded = frame_blend_threaded;
+#endif
+
+   /* Number of frames read by each blend */
    switch (frame_blend_type)
    {
       case FRAME_BLEND_MIX:
-         /* Simple 50:50 blending requires a single buffer */
-         if (!allocate_video_buf_prev(&video_buf_prev_1))
-            return;
+         /* Simple 50:50 blending requires the current
+          * and previous frame */
+         frame_blend_frames = 2;
          break;
       case FRAME_BLEND_LCD_GHOSTING:
-         /* 'Accurate' LCD ghosting requires four buffers */
-         if (!allocate_video_buf_prev(&video_buf_prev_1))
-            return;
-         if (!allocate_video_buf_prev(&video_buf_prev_2))
-            return;
-         if (!allocate_video_buf_prev(&video_buf_prev_3))
-            return;
-         if (!allocate_video_buf_prev(&video_buf_prev_4))
-            return;
+         /* 'Accurate' LCD ghosting requires four
+          * previous frames */
+         frame_blend_frames = FRAME_BLEND_HISTORY;
+         init_frame_blend_weights();
          break;
       case FRAME_BLEND_LCD_GHOSTING_FAST:
-         /* 'Fast' LCD ghosting requires three (RGB)
-          * 'accumulator' buffers */
-         if (!allocate_video_buf_acc())
-            return;
+         /* 'Fast' LCD ghosting keeps a single (RGB)
+          * 'accumulator' buffer instead */
+         frame_blend_frames = 1;
          break;
       case FRAME_BLEND_NONE:
       default:
@@ -1001,102 +1091,86 @@ static void init_frame_blending(void)
          return;
    }
 
-   /* Set LCD ghosting response time factors,
-    * if required */
-   if ((frame_blend_type == FRAME_BLEND_LCD_GHOSTING) &&
-       !frame_blend_response_set)
-   {
-      /* For the default response time of 0.333,
-       * only four previous samples are required
-       * since the response factor for the fifth
-       * is:
-       *    pow(LCD_RESPONSE_TIME, 5.0f) -> 0.00409
-       * ...which is less than half a percent, and
-       * therefore irrelevant.
-       * If the response time were significantly
-       * increased, we may need to rethink this
-       * (but more samples == greater performance
-       * overheads) */
-      frame_blend_response[0] = LCD_RESPONSE_TIME;
-      frame_blend_response[1] = std::pow(LCD_RESPONSE_TIME, 2.0f);
-      frame_blend_response[2] = std::pow(LCD_RESPONSE_TIME, 3.0f);
-      frame_blend_response[3] = std::pow(LCD_RESPONSE_TIME, 4.0f);
+   /* Allocate interframe blending buffers, as required
+    * NOTE: In all cases, any used buffers are 'reset'
+    * to avoid drawing garbage on the next frame */
+   slots = threaded ? frame_blend_frames + 1 : frame_blend_frames;
+   if (!threaded && frame_blend_type == FRAME_BLEND_LCD_GHOSTING_FAST)
+      slots = 0;
 
-      frame_blend_response_set = true;
-   }
+   if (!allocate_video_buf_history(slots))
+      return;
+
+   if ((frame_blend_type == FRAME_BLEND_LCD_GHOSTING_FAST) &&
+       !allocate_video_buf_acc())
+      return;
 
    /* Assign frame blending function */
    switch (frame_blend_type)
    {
       case FRAME_BLEND_MIX:
          blend_frames = blend_frames_mix;
-         return;
+         break;
       case FRAME_BLEND_LCD_GHOSTING:
          blend_frames = blend_frames_lcd_ghost;
-         return;
+         break;
       case FRAME_BLEND_LCD_GHOSTING_FAST:
          blend_frames = blend_frames_lcd_ghost_fast;
-         return;
+         break;
       case FRAME_BLEND_NONE:
       default:
          /* Error condition - cannot happen
           * > Just leave blend_frames() function set to NULL */
          return;
    }
+
+#ifdef HAVE_BLEND_THREAD
+   /* If the thread cannot be started, blend on the
+    * emulation thread (the extra slot does no harm) */
+   if (threaded)
+      start_blend_thread();
+#endif
 }
 
 static void deinit_frame_blending(void)
 {
-   if (video_buf_prev_1)
-   {
-      free(video_buf_prev_1);
-      video_buf_prev_1 = NULL;
-   }
-
-   if (video_buf_prev_2)
-   {
-      free(video_buf_prev_2);
-      video_buf_prev_2 = NULL;
-   }
-
-   if (video_buf_prev_3)
-   {
-      free(video_buf_prev_3);
-      video_buf_prev_3 = NULL;
-   }
+   unsigned i;
 
-   if (video_buf_prev_4)
-   {
-      free(video_buf_prev_4);
-      video_buf_prev_4 = NULL;
-   }
+#ifdef HAVE_BLEND_THREAD
+   stop_blend_thread();
 
-   if (video_buf_acc_r)
+   if (video_out_buf[1])
    {
-      free(video_buf_acc_r);
-      video_buf_acc_r = NULL;
+      free(video_out_buf[1]);
+      video_out_buf[1] = NULL;
    }
+#endif
 
-   if (video_buf_acc_g)
+   for (i = 0; i < FRAME_BLEND_SLOTS; i++)
    {
-      free(video_buf_acc_g);
-      video_buf_acc_g = NULL;
+      if (video_buf_history[i])
+      {
+         free(video_buf_history[i]);
+         video_buf_history[i] = NULL;
+      }
    }
 
-   if (video_buf_acc_b)
+   if (video_buf_acc)
    {
-      free(video_buf_acc_b);
-      video_buf_acc_b = NULL;
+      free(video_buf_acc);
+      video_buf_acc = NULL;
    }
 
-   frame_blend_type         = FRAME_BLEND_NONE;
-   frame_blend_response_set = false;
+   video_buf_history_size = 0;
+   video_draw_buf         = video_buf;
+   frame_blend_type       = FRAME_BLEND_NONE;
 }
 
 static void check_frame_blend_variable(void)
 {
    struct retro_variable var;
    enum frame_blend_method old_frame_blend_type = frame_blend_type;
+   bool frame_blend_changed;
 
    frame_blend_type = FRAME_BLEND_NONE;
 
@@ -1113,9 +1187,34 @@ static void check_frame_blend_variable(void)
          frame_blend_type = FRAME_BLEND_LCD_GHOSTING_FAST;
    }
 
+   frame_blend_changed = frame_blend_type != old_frame_blend_type;
+
+#ifdef HAVE_BLEND_THREAD
+   {
+      bool old_frame_blend_threaded = frame_blend_threaded;
+
+      frame_blend_threaded = false;
+
+      var.key = "gambatte_mix_frames_threaded";
+      var.value = 0;
+
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+         frame_blend_threaded = !strcmp(var.value, "enabled");
+
+      if (frame_blend_threaded != old_frame_blend_threaded)
+         frame_blend_changed = true;
+   }
+#endif
+
    if (frame_blend_type == FRAME_BLEND_NONE)
-      blend_frames = NULL;
-   else if (frame_blend_type != old_frame_blend_type)
+   {
+#ifdef HAVE_BLEND_THREAD
+      stop_blend_thread();
+#endif
+      blend_frames   = NULL;
+      video_draw_buf = video_buf;
+   }
+   else if (frame_blend_changed)
       init_frame_blending();
 }
 
@@ -1137,7 +1236,8 @@ static bool rumble_active                   = false;
 void cartridge_set_rumble(unsigned active)
 {
    if (!rumble.set_rumble_state ||
-       !rumble_level)
+       !rumble_level ||
+       runahead_running)
       return;
 
    if (active)
@@ -1401,6 +1501,9 @@ static void update_input_state(void)
       turbo_a = (ret & (1 << RETRO_DEVICE_ID_JOYPAD_X));
       turbo_b = (ret & (1 << RETRO_DEVICE_ID_JOYPAD_Y));
 
+      rewind_requested = rewind_enabled &&
+            (ret & (1 << RETRO_DEVICE_ID_JOYPAD_L2));
+
       if (palette_switch_enabled)
       {
          palette_prev = (bool)(ret & (1 << RETRO_DEVICE_ID_JOYPAD_L));
@@ -1418,6 +1521,9 @@ static void update_input_state(void)
       turbo_a = input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_X);
       turbo_b = input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_Y);
 
+      rewind_requested = rewind_enabled &&
+            input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2);
+
       if (palette_switch_enabled)
       {
          palette_prev = input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L);
@@ -1554,8 +1660,8 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
    info->geometry.aspect_ratio = (float)GB_SCREEN_WIDTH / (float)VIDEO_HEIGHT;
 
    info->timing.fps            = VIDEO_REFRESH_RATE;
-   info->timing.sample_rate    = use_cc_resampler ?
-         SOUND_SAMPLE_RATE_CC : SOUND_SAMPLE_RATE_BLIPPER;
+   info->timing.sample_rate    = use_core_resampler ? SOUND_SAMPLE_RATE_CORE :
+         use_cc_resampler ? SOUND_SAMPLE_RATE_CC : SOUND_SAMPLE_RATE_BLIPPER;
 }
 
 static void check_system_specs(void)
@@ -1576,6 +1682,7 @@ void retro_init(void)
    // Using uint_least32_t in an audio interface expecting you to cast to short*? :( Weird stuff.
    assert(sizeof(gambatte::uint_least32_t) == sizeof(uint32_t));
    gb.setInputGetter(&gb_input);
+   gb_ahead.setInputGetter(&gb_input);
 #ifdef DUAL_MODE
    gb2.setInputGetter(&gb_input);
 #endif
@@ -1585,11 +1692,13 @@ void retro_init(void)
 #else
    video_buf = (gambatte::video_pixel_t*)malloc(VIDEO_BUFF_SIZE);
 #endif
+   video_draw_buf = video_buf;
 
    check_system_specs();
    
    //gb/gbc bootloader support
    gb.setBootloaderGetter(get_bootloader_from_file);
+   gb_ahead.setBootloaderGetter(get_bootloader_from_file);
 #ifdef DUAL_MODE
    gb2.setBootloaderGetter(get_bootloader_from_file);
 #endif
@@ -1624,13 +1733,15 @@ void retro_init(void)
 
 void retro_deinit(void)
 {
+   /* Stops the blending thread before its buffers go */
+   deinit_frame_blending();
 #ifdef _3DS
    linearFree(video_buf);
 #else
    free(video_buf);
 #endif
-   video_buf = NULL;
-   deinit_frame_blending();
+   video_buf      = NULL;
+   video_draw_buf = NULL;
    audio_resampler_deinit();
 
    freePaletteMaps();
@@ -1756,6 +1867,19 @@ size_t retro_serialize_size(void)
    return gb.stateSize();
 }
 
+/* Run-ahead and rewind snapshots are only read back by this same
+ * build, so they can use the fixed-layout state format. */
+static bool fast_savestate_requested(void)
+{
+   int context = RETRO_SAVESTATE_CONTEXT_NORMAL;
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &context))
+      return false;
+
+   return context == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE ||
+          context == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_BINARY;
+}
+
 bool retro_serialize(void *data, size_t size)
 {
    serialize_size = retro_serialize_size();
@@ -1763,7 +1887,7 @@ bool retro_serialize(void *data, size_t size)
    if (size != serialize_size)
       return false;
 
-   gb.saveState(data);
+   gb.saveState(data, fast_savestate_requested());
    return true;
 }
 
@@ -1771,16 +1895,19 @@ bool retro_unserialize(const void *data, size_t size)
 {
    serialize_size = retro_serialize_size();
 
-   if (size != serialize_size)
+   /* States saved before the blittim and blnklcd entries were
+    * added (8 byte label, 24 bit size and 4 or 1 byte value each)
+    * are that much smaller, and load with defaults for them. */
+   if (size != serialize_size && size != serialize_size - 27)
       return false;
 
-   gb.loadState(data);
-   return true;
+   return gb.loadState(data, size);
 }
 
 void retro_cheat_reset()
 {
    gb.clearCheats();
+   gb_ahead.clearCheats();
 }
 
 void retro_cheat_set(unsigned index, bool enabled, const char *code)
@@ -1791,8 +1918,10 @@ void retro_cheat_set(unsigned index, bool enabled, const char *code)
 
    if (code_str.find("-") != std::string::npos) {
       gb.setGameGenie(code_str);
+      gb_ahead.setGameGenie(code_str);
    } else {
       gb.setGameShark(code_str);
+      gb_ahead.setGameShark(code_str);
    }
 }
 
@@ -1952,29 +2081,29 @@ static void load_custom_palette(void)
 #endif
 
       if (     string_starts_with(line, "Background0="))
-         gb.setDmgPaletteColor(0, 0, rgb32);
+         set_dmg_palette_color(0, 0, rgb32);
       else if (string_starts_with(line, "Background1="))
-         gb.setDmgPaletteColor(0, 1, rgb32);
+         set_dmg_palette_color(0, 1, rgb32);
       else if (string_starts_with(line, "Background2="))
-         gb.setDmgPaletteColor(0, 2, rgb32);       
+         set_dmg_palette_color(0, 2, rgb32);       
       else if (string_starts_with(line, "Background3="))
-         gb.setDmgPaletteColor(0, 3, rgb32);
+         set_dmg_palette_color(0, 3, rgb32);
       else if (string_starts_with(line, "Sprite%2010="))
-         gb.setDmgPaletteColor(1, 0, rgb32);
+         set_dmg_palette_color(1, 0, rgb32);
       else if (string_starts_with(line, "Sprite%2011="))
-         gb.setDmgPaletteColor(1, 1, rgb32);
+         set_dmg_palette_color(1, 1, rgb32);
       else if (string_starts_with(line, "Sprite%2012="))
-         gb.setDmgPaletteColor(1, 2, rgb32);
+         set_dmg_palette_color(1, 2, rgb32);
       else if (string_starts_with(line, "Sprite%2013="))
-         gb.setDmgPaletteColor(1, 3, rgb32);
+         set_dmg_palette_color(1, 3, rgb32);
       else if (string_starts_with(line, "Sprite%2020="))
-         gb.setDmgPaletteColor(2, 0, rgb32);
+         set_dmg_palette_color(2, 0, rgb32);
       else if (string_starts_with(line, "Sprite%2021="))
-         gb.setDmgPaletteColor(2, 1, rgb32);
+         set_dmg_palette_color(2, 1, rgb32);
       else if (string_starts_with(line, "Sprite%2022="))
-         gb.setDmgPaletteColor(2, 2, rgb32);  
+         set_dmg_palette_color(2, 2, rgb32);  
       else if (string_starts_with(line, "Sprite%2023="))
-         gb.setDmgPaletteColor(2, 3, rgb32);
+         set_dmg_palette_color(2, 3, rgb32);
       else
          gambatte_log(RETRO_LOG_WARN,
                "Error in %s, line %u (color left as default)\n",
@@ -2133,7 +2262,7 @@ static void check_variables(bool startup)
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && !strcmp(var.value, "fast")) {
       colorCorrectionMode = 1;
    }
-   gb.setColorCorrectionMode(colorCorrectionMode);
+   set_color_correction_mode(colorCorrectionMode);
    
    float colorCorrectionBrightness = 0.5f; /* central */
    var.key   = "gambatte_gbc_frontlight_position";
@@ -2145,7 +2274,7 @@ static void check_variables(bool startup)
       else if (!strcmp(var.value, "below screen"))
          colorCorrectionBrightness = 0.0f;
    }
-   gb.setColorCorrectionBrightness(colorCorrectionBrightness);
+   set_color_correction_brightness(colorCorrectionBrightness);
    
    unsigned darkFilterLevel = 0;
    var.key   = "gambatte_dark_filter_level";
@@ -2154,17 +2283,24 @@ static void check_variables(bool startup)
    {
       darkFilterLevel = static_cast<unsigned>(atoi(var.value));
    }
-   gb.setDarkFilterLevel(darkFilterLevel);
+   set_dark_filter_level(darkFilterLevel);
 
-   bool old_use_cc_resampler = use_cc_resampler;
-   use_cc_resampler          = false;
-   var.key                   = "gambatte_audio_resampler";
-   var.value                 = NULL;
-   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) &&
-       var.value && !strcmp(var.value, "cc"))
-      use_cc_resampler = true;
+   bool old_use_cc_resampler   = use_cc_resampler;
+   bool old_use_core_resampler = use_core_resampler;
+   use_cc_resampler            = false;
+   use_core_resampler          = false;
+   var.key                     = "gambatte_audio_resampler";
+   var.value                   = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "cc"))
+         use_cc_resampler = true;
+      else if (!strcmp(var.value, "core"))
+         use_core_resampler = true;
+   }
 
-   if (!startup && (use_cc_resampler != old_use_cc_resampler))
+   if (!startup && (use_cc_resampler != old_use_cc_resampler ||
+                    use_core_resampler != old_use_core_resampler))
    {
       struct retro_system_av_info av_info;
       audio_resampler_deinit();
@@ -2218,6 +2354,21 @@ static void check_variables(bool startup)
    if (rumble_level == 0)
       deactivate_rumble();
 
+   size_t rewind_buffer_size = 0;
+   var.key                   = "gambatte_rewind_buffer_size";
+   var.value                 = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      rewind_buffer_size = strtoul(var.value, NULL, 10) << 20;
+   if (rewind_buffer_size != gb.rewindBufferSize())
+      gb.setRewindBufferSize(rewind_buffer_size);
+   rewind_enabled = rewind_buffer_size != 0;
+
+   runahead_frames = 0;
+   var.key         = "gambatte_run_ahead";
+   var.value       = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      runahead_frames = strtoul(var.value, NULL, 10);
+
    /* Interframe blending option has its own handler */
    check_frame_blend_variable();
 
@@ -2327,12 +2478,12 @@ static void check_variables(bool startup)
       // but don't want to have to change the indentation of all the
       // following code... (makes it too difficult to see the changes in
       // a git diff...)
-      gb.setColorCorrection(gb.isCgb() && (colorCorrection != 0));
+      set_color_correction(gb.isCgb() && (colorCorrection != 0));
       return;
    }
    
    if (gb.isCgb()) {
-      gb.setColorCorrection(colorCorrection != 0);
+      set_color_correction(colorCorrection != 0);
       return;
    }
 
@@ -2434,7 +2585,7 @@ static void check_variables(bool startup)
    }
    
    // Enable colour correction, if required
-   gb.setColorCorrection((colorCorrection == 2) || ((colorCorrection == 1) && isGbcPalette));
+   set_color_correction((colorCorrection == 2) || ((colorCorrection == 1) && isGbcPalette));
    
    // If gambatte is using custom colourisation
    // then we have already loaded the palette.
@@ -2447,7 +2598,7 @@ static void check_variables(bool startup)
          for (unsigned colornum = 0; colornum < 4; ++colornum)
          {
             rgb32 = gb.gbcToRgb32(gbc_bios_palette[palnum * 4 + colornum]);
-            gb.setDmgPaletteColor(palnum, colornum, rgb32);
+            set_dmg_palette_color(palnum, colornum, rgb32);
          }
       }
    }
@@ -2490,6 +2641,7 @@ bool retro_load_game(const struct retro_game_info *info)
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_X,      "Turbo A" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_SELECT, "Select" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_START,  "Start" },
+      { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2,     "Rewind" },
       { 0 },
    };
 
@@ -2505,6 +2657,7 @@ bool retro_load_game(const struct retro_game_info *info)
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_SELECT, "Select" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_START,  "Start" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R2,     "Fast Forward" },
+      { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2,     "Rewind" },
       { 0 },
    };
 
@@ -2521,6 +2674,7 @@ bool retro_load_game(const struct retro_game_info *info)
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_START,  "Start" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L,      "Prev. Internal Palette" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R,      "Next Internal Palette" },
+      { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2,     "Rewind" },
       { 0 },
    };
 
@@ -2538,6 +2692,7 @@ bool retro_load_game(const struct retro_game_info *info)
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L,      "Prev. Internal Palette" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R,      "Next Internal Palette" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R2,     "Fast Forward" },
+      { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2,     "Rewind" },
       { 0 },
    };
 
@@ -2614,6 +2769,16 @@ bool retro_load_game(const struct retro_game_info *info)
    check_variables(true);
    audio_resampler_init(true);
 
+   /* The ROM data is only valid during this call, so the
+    * run-ahead instance can only be set up here */
+   runahead_loaded = runahead_frames &&
+         gb_ahead.load(info->data, info->size, flags) == 0;
+   if (runahead_loaded)
+   {
+      runahead_state  = (unsigned char*)malloc(gb.stateSize());
+      runahead_loaded = runahead_state != NULL;
+   }
+
    unsigned sramlen       = gb.savedata_size();
    const uint64_t rom     = RETRO_MEMDESC_CONST;
    const uint64_t mainram = RETRO_MEMDESC_SYSTEM_RAM;
@@ -2669,7 +2834,10 @@ bool retro_load_game_special(unsigned, const struct retro_game_info*, size_t) {
 
 void retro_unload_game()
 {
-   rom_loaded = false;
+   rom_loaded      = false;
+   runahead_loaded = false;
+   free(runahead_state);
+   runahead_state  = NULL;
 }
 
 unsigned retro_get_region() { return RETRO_REGION_NTSC; }
@@ -2715,6 +2883,59 @@ size_t retro_get_memory_size(unsigned id)
    return 0;
 }
 
+/* Copies the main instance into the run-ahead one and runs that
+ * runahead_frames frames further. Only the last frame is drawn
+ * into video_draw_buf, and the sound is thrown away. */
+static void run_ahead_frames(void)
+{
+   static gambatte::uint_least32_t sound_buf[SOUND_BUFF_SIZE];
+
+   gb.saveState(runahead_state, true);
+   gb_ahead.loadState(runahead_state, gb.stateSize());
+
+   runahead_running = true;
+
+   for (unsigned i = 1; i <= runahead_frames; ++i)
+   {
+      gambatte::video_pixel_t *buf = (i == runahead_frames) ? video_draw_buf : NULL;
+      unsigned samples = SOUND_SAMPLES_PER_RUN;
+
+      while (gb_ahead.runFor(buf, VIDEO_PITCH, sound_buf, SOUND_BUFF_SIZE, samples) == -1)
+         samples = SOUND_SAMPLES_PER_RUN;
+   }
+
+   runahead_running = false;
+}
+
+/* Runs the main instance until it draws a frame, with the core
+ * resampling the sound straight into the output buffer. Returns
+ * the number of native samples run, for detecting frame dupes */
+static unsigned run_frame_core_resampled(gambatte::video_pixel_t *video_buf_ptr)
+{
+   static unsigned long rate_remainder = 0;
+   unsigned native_samples = 0;
+   long frame_time;
+
+   do
+   {
+      unsigned samples = CORE_SOUND_SAMPLES_PER_RUN;
+      uint64_t scaled;
+
+      audio_out_buffer_resize(samples);
+      frame_time = gb.runFor(video_buf_ptr, VIDEO_PITCH,
+            audio_out_buffer + audio_out_buffer_pos, samples, samples);
+      audio_out_buffer_pos += samples << 1;
+
+      /* The native rate is 2^21 Hz, so this adds up
+       * to the native samples run without drifting */
+      scaled          = ((uint64_t)samples << 21) + rate_remainder;
+      native_samples += scaled / SOUND_SAMPLE_RATE_CORE;
+      rate_remainder  = scaled % SOUND_SAMPLE_RATE_CORE;
+   } while (frame_time == -1);
+
+   return native_samples;
+}
+
 void retro_run()
 {
    static uint64_t samples_count = 0;
@@ -2731,6 +2952,18 @@ void retro_run()
       return;
    }
 
+   /* Rewinding replaces the state with the one saved a frame
+    * earlier and runs that frame again, so the video and
+    * audio output stay live while stepping backwards. */
+   if (rewind_requested)
+      gb.rewindPop();
+   else if (rewind_enabled)
+      gb.rewindPush();
+
+   /* The frontend may have written VRAM through the memory
+    * map since the last frame */
+   gb.syncVram();
+
    union
    {
       gambatte::uint_least32_t u32[SOUND_BUFF_SIZE];
@@ -2738,13 +2971,29 @@ void retro_run()
    } static sound_buf;
    unsigned samples = SOUND_SAMPLES_PER_RUN;
 
-   while (gb.runFor(video_buf, VIDEO_PITCH, sound_buf.u32, SOUND_BUFF_SIZE, samples) == -1)
+   /* Frames the frontend discards (frameskip, fast-forward,
+    * its own run-ahead) are emulated without being drawn */
+   int av_enable = 3;
+   bool video_enabled = !environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &av_enable) ||
+         (av_enable & 1);
+
+   /* With run-ahead the main instance only supplies the
+    * sound, so it need not render its own frames */
+   bool run_ahead = runahead_loaded && runahead_frames && video_enabled;
+   gambatte::video_pixel_t *main_video_buf = (run_ahead || !video_enabled) ? NULL : video_draw_buf;
+
+   if (use_core_resampler)
+   {
+      samples_count += run_frame_core_resampled(main_video_buf);
+      samples        = 0;
+   }
+   else while (gb.runFor(main_video_buf, VIDEO_PITCH, sound_buf.u32, SOUND_BUFF_SIZE, samples) == -1)
    {
       if (use_cc_resampler)
          CC_renderaudio((audio_frame_t*)sound_buf.u32, samples);
       else
       {
-         blipper_renderaudio(sound_buf.i16, samples);
+         blipper_renderaudio(samples);
 
          unsigned read_avail = blipper_read_avail(resampler_l);
          if (read_avail >= (BLIP_BUFFER_SIZE >> 1))
@@ -2755,20 +3004,22 @@ void retro_run()
       samples = SOUND_SAMPLES_PER_RUN;
    }
 #ifdef DUAL_MODE
-   while (gb2.runFor(video_buf + GB_SCREEN_WIDTH, VIDEO_PITCH, sound_buf.u32, samples) == -1) {}
+   while (gb2.runFor(video_draw_buf + GB_SCREEN_WIDTH, VIDEO_PITCH, sound_buf.u32, samples) == -1) {}
 #endif
 
-   /* Perform interframe blending, if required */
-   if (blend_frames)
-      blend_frames();
+   if (run_ahead)
+      run_ahead_frames();
 
-   video_cb(video_buf, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_PITCH * sizeof(gambatte::video_pixel_t));
+   if (video_enabled)
+      output_video_frame();
+   else
+      video_cb(NULL, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_PITCH * sizeof(gambatte::video_pixel_t));
 
    if (use_cc_resampler)
       CC_renderaudio((audio_frame_t*)sound_buf.u32, samples);
-   else
+   else if (!use_core_resampler)
    {
-      blipper_renderaudio(sound_buf.i16, samples);
+      blipper_renderaudio(samples);
 
       unsigned read_avail = blipper_read_avail(resampler_l);
       audio_out_buffer_read_blipper(read_avail);
@@ -620,16 +620,33 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+#ifdef HAVE_BLEND_THREAD
+   {
+      "gambatte_mix_frames_threaded",
+      "Interframe Blending on Second Core",
+      NULL,
+      "Performs interframe blending on a separate thread while the next frame is emulated, to make use of a second CPU core. Delays video output by one frame.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+#endif
    {
       "gambatte_audio_resampler",
       "Audio Resampler",
       NULL,
-      "Specify which algorithm to use when resampling generated audio (the Game Boy audio rate is limited only by its CPU write speed, such that 'native' frequencies are impractical on modern sound devices and must be downsampled). 'Sinc' produces the highest quality. 'Cosine' improves performance on low-end hardware.",
+      "Specify which algorithm to use when resampling generated audio (the Game Boy audio rate is limited only by its CPU write speed, such that 'native' frequencies are impractical on modern sound devices and must be downsampled). 'Sinc' produces the highest quality. 'Cosine' improves performance on low-end hardware. 'Band-Limited (48 kHz)' lets the emulated sound hardware output at 48 kHz directly.",
       NULL,
       NULL,
       {
          { "sinc", "Sinc" },
          { "cc",   "Cosine" },
+         { "core", "Band-Limited (48 kHz)" },
          { NULL, NULL },
       },
 #if (defined(PS2) || defined(PSP) || defined(VITA) || defined(_3DS) || defined(DINGUX))
@@ -811,6 +828,40 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "4"
    },
+   {
+      "gambatte_rewind_buffer_size",
+      "Rewind Buffer Size",
+      NULL,
+      "Keeps a history of recent frames in memory so that holding L2 steps the game backwards. Larger buffers reach further back. Each frame is stored as its difference to the next one, so a few MB usually hold several minutes.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "4",        "4 MB" },
+         { "8",        "8 MB" },
+         { "16",       "16 MB" },
+         { "32",       "32 MB" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "gambatte_run_ahead",
+      "Run-Ahead",
+      NULL,
+      "Reduces input latency by running a copy of the game the chosen number of frames ahead and showing its output. Each frame costs roughly one extra frame of emulation. Enabling it takes effect after restarting the content.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "1",        "1 Frame" },
+         { "2",        "2 Frames" },
+         { "3",        "3 Frames" },
+         { "4",        "4 Frames" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       "gambatte_rumble_level",
       "Controller Rumble Strength",
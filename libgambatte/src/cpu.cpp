@@ -19,6 +19,7 @@
 #include "cpu.h"
 #include "gambatte-memory.h"
 #include "savestate.h"
+#include <algorithm>
 
 namespace gambatte {
 
@@ -121,6 +122,166 @@ void CPU::loadState(SaveState const &state) {
 	skip_ = state.cpu.skip;
 }
 
+static bool isIdleLoopCodeArea(unsigned p) {
+	return p < 0x8000 || p - 0xC000u < 0x3E00 || p - 0xFF80u < 0x7F;
+}
+
+// Checks that the loop starting at pc consists solely of instructions that modify
+// nothing but A and the flags, read from memory at fixed addresses and end in the jr
+// back to pc. The read addresses and the cycle count of one pass are stored in
+// idleLoop_.
+bool CPU::decodeIdleLoop(unsigned const pc, unsigned long const cc) {
+	unsigned char code[IdleLoop::max_size + 2];
+	unsigned cycles = 0;
+	unsigned numReads = 0;
+
+	for (unsigned i = 0; i < sizeof code; ++i) {
+		unsigned const p = (pc + i) & 0xFFFF;
+		if (!isIdleLoopCodeArea(p) || mem_.stableReadEnd(p, cc) != disabled_time)
+			return false;
+
+		code[i] = mem_.read(p, cc);
+	}
+
+	for (unsigned i = 0; i < IdleLoop::max_size;) {
+		unsigned const op = code[i];
+		unsigned readAddr = IdleLoop::none;
+		unsigned len = 1, opCycles = 4;
+
+		if (op >= 0x40 && op < 0xC0) {
+			// ld a,r; alu a,r. ld r,r' other than to A and halt change more than A:
+			if (op < 0x80 && (op & 0x38) != 0x38)
+				return false;
+
+			if ((op & 7) == 6) {
+				readAddr = h << 8 | l;
+				opCycles = 8;
+			}
+		} else switch (op) {
+		case 0x00:
+		case 0x07:
+		case 0x0F:
+		case 0x17:
+		case 0x1F:
+		case 0x2F:
+		case 0x37:
+		case 0x3C:
+		case 0x3D:
+		case 0x3F:
+			break;
+		case 0x0A:
+			readAddr = b << 8 | c;
+			opCycles = 8;
+			break;
+		case 0x1A:
+			readAddr = d << 8 | e;
+			opCycles = 8;
+			break;
+		case 0x3E:
+		case 0xC6:
+		case 0xCE:
+		case 0xD6:
+		case 0xDE:
+		case 0xE6:
+		case 0xEE:
+		case 0xF6:
+		case 0xFE:
+			len = 2;
+			opCycles = 8;
+			break;
+		case 0xCB:
+			len = 2;
+			opCycles = 8;
+
+			if ((code[i + 1] & 7) == 6) {
+				// Only bit n,(hl) leaves (hl) alone:
+				if ((code[i + 1] & 0xC0) != 0x40)
+					return false;
+
+				readAddr = h << 8 | l;
+				opCycles = 12;
+			} else if ((code[i + 1] & 7) != 7 && (code[i + 1] & 0xC0) != 0x40)
+				return false;
+
+			break;
+		case 0xF0:
+			readAddr = 0xFF00 | code[i + 1];
+			len = 2;
+			opCycles = 12;
+			break;
+		case 0xF2:
+			readAddr = 0xFF00 | c;
+			opCycles = 8;
+			break;
+		case 0xFA:
+			readAddr = code[i + 2] << 8 | code[i + 1];
+			len = 3;
+			opCycles = 16;
+			break;
+		case 0x18:
+		case 0x20:
+		case 0x28:
+		case 0x30:
+		case 0x38:
+			if (((code[i + 1] ^ 0x80) - 0x80u + i + 2) & 0xFFFF)
+				return false;
+
+			idleLoop_.cycles = cycles + 12;
+			idleLoop_.numReads = numReads;
+			return true;
+		default:
+			return false;
+		}
+
+		if (readAddr != IdleLoop::none) {
+			if (numReads == IdleLoop::max_reads)
+				return false;
+
+			idleLoop_.reads[numReads++] = readAddr;
+		}
+
+		i += len;
+		cycles += opCycles;
+	}
+
+	return false;
+}
+
+// Called on taken short backward jrs. A loop pass that only reads memory and reproduces
+// the register state it started with is repeated unchanged for as long as the values it
+// reads stay the same, so once two consecutive passes end in the same state, the cycle
+// counter is advanced by as many whole passes as fit before the next memory event and
+// before any of the read values can change. Leaving the loop through a jr that is not
+// taken, or processing an event, drops the loop.
+unsigned long CPU::skipIdleLoop(unsigned const pc, unsigned long cc, unsigned const a) {
+	if (pc != idleLoop_.pc) {
+		if (!decodeIdleLoop(pc, cc)) {
+			idleLoop_.rejectedPc = pc;
+			return cc;
+		}
+
+		idleLoop_.pc = pc;
+	} else if (cc - idleLoop_.cycle == idleLoop_.cycles
+			&& a == idleLoop_.a && hf1 == idleLoop_.hf1 && hf2 == idleLoop_.hf2
+			&& zf == idleLoop_.zf && cf == idleLoop_.cf) {
+		unsigned long end = std::min(mem_.nextEventTime(), mem_.stableReadEnd(pc, idleLoop_.cycle));
+
+		for (unsigned i = 0; i < idleLoop_.numReads; ++i)
+			end = std::min(end, mem_.stableReadEnd(idleLoop_.reads[i], idleLoop_.cycle));
+
+		if (end > cc)
+			cc += (end - cc) / idleLoop_.cycles * idleLoop_.cycles;
+	}
+
+	idleLoop_.cycle = cc;
+	idleLoop_.a = a;
+	idleLoop_.hf1 = hf1;
+	idleLoop_.hf2 = hf2;
+	idleLoop_.zf = zf;
+	idleLoop_.cf = cf;
+	return cc;
+}
+
 // The main reasons for the use of macros is to more conveniently be able to tweak
 // which variables are local and which are not, combined with the fact that at the
 // time they were written GCC had a tendency to not be able to keep hot variables
@@ -454,12 +615,21 @@ void CPU::loadState(SaveState const &state) {
 } while (0)
 
 // jr disp (12 cycles):
-// Jump to value of next (signed) byte in memory+current address:
+// Jump to value of next (signed) byte in memory+current address. Short backward jumps
+// may close an idle loop:
 #define jr_disp() do { \
 	unsigned disp; \
 	PC_READ(disp); \
 	disp = (disp ^ 0x80) - 0x80; \
 	PC_MOD((pc + disp) & 0xFFFF); \
+	if (-disp - 2 <= IdleLoop::max_size - 2u && pc != idleLoop_.rejectedPc) \
+		cycleCounter = skipIdleLoop(pc, cycleCounter, a); \
+} while (0)
+
+// jr cc,disp not taken (8 cycles):
+#define jr_skip() do { \
+	idleLoop_.pc = IdleLoop::none; \
+	PC_MOD((pc + 1) & 0xFFFF); \
 } while (0)
 
 // CALLS, RESTARTS AND RETURNS:
@@ -486,7 +656,71 @@ void CPU::loadState(SaveState const &state) {
 	PC_MOD(high << 8 | low); \
 } while (0)
 
+// Fetch the next opcode, undoing the pc increment if the previous instruction
+// was a halt that triggered the DMG halt bug:
+#define FETCH_OPCODE(opcode) do { \
+	PC_READ(opcode); \
+\
+	if (skip_) { \
+		pc = (pc - 1) & 0xFFFF; \
+		skip_ = false; \
+	} \
+} while (0)
+
+// Opcode dispatch. With HAVE_COMPUTED_GOTO on compilers supporting labels as
+// values, every handler fetches the next opcode itself and jumps through a
+// handler table (threaded code), which gives the indirect branch at the end of
+// each handler its own branch predictor history. Otherwise this degenerates to
+// the plain switch statement.
+#if defined(HAVE_COMPUTED_GOTO) && defined(__GNUC__)
+#define GAMBATTE_THREADED_DISPATCH
+
+#define OPCODE(n) op_##n
+#define CB_OPCODE(n) cb_##n
+#define DISPATCH_OPCODE(opcode) goto *opcodeTable[opcode];
+#define DISPATCH_CB_OPCODE(opcode) goto *cbOpcodeTable[opcode];
+
+#define NEXT_OPCODE \
+	if (cycleCounter >= mem_.nextEventTime()) \
+		break; \
+	else do { \
+		FETCH_OPCODE(opcode); \
+		goto *opcodeTable[opcode]; \
+	} while (0)
+
+#define NEXT_CB_OPCODE NEXT_OPCODE
+
+#define OPCODE_TABLE_ROW(prefix, hi) \
+	&&prefix##hi##0, &&prefix##hi##1, &&prefix##hi##2, &&prefix##hi##3, \
+	&&prefix##hi##4, &&prefix##hi##5, &&prefix##hi##6, &&prefix##hi##7, \
+	&&prefix##hi##8, &&prefix##hi##9, &&prefix##hi##A, &&prefix##hi##B, \
+	&&prefix##hi##C, &&prefix##hi##D, &&prefix##hi##E, &&prefix##hi##F
+
+#define OPCODE_TABLE(prefix) { \
+	OPCODE_TABLE_ROW(prefix, 0), OPCODE_TABLE_ROW(prefix, 1), \
+	OPCODE_TABLE_ROW(prefix, 2), OPCODE_TABLE_ROW(prefix, 3), \
+	OPCODE_TABLE_ROW(prefix, 4), OPCODE_TABLE_ROW(prefix, 5), \
+	OPCODE_TABLE_ROW(prefix, 6), OPCODE_TABLE_ROW(prefix, 7), \
+	OPCODE_TABLE_ROW(prefix, 8), OPCODE_TABLE_ROW(prefix, 9), \
+	OPCODE_TABLE_ROW(prefix, A), OPCODE_TABLE_ROW(prefix, B), \
+	OPCODE_TABLE_ROW(prefix, C), OPCODE_TABLE_ROW(prefix, D), \
+	OPCODE_TABLE_ROW(prefix, E), OPCODE_TABLE_ROW(prefix, F) \
+}
+#else
+#define OPCODE(n) case n
+#define CB_OPCODE(n) case n
+#define DISPATCH_OPCODE(opcode) switch (opcode)
+#define DISPATCH_CB_OPCODE(opcode) switch (opcode)
+#define NEXT_OPCODE break
+#define NEXT_CB_OPCODE break
+#endif
+
 void CPU::process(unsigned long const cycles) {
+#ifdef GAMBATTE_THREADED_DISPATCH
+	static void const *const opcodeTable[0x100] = OPCODE_TABLE(op_0x);
+	static void const *const cbOpcodeTable[0x100] = OPCODE_TABLE(cb_0x);
+#endif
+
 	mem_.setEndtime(cycleCounter_, cycles);
 	mem_.updateInput();
 
@@ -508,47 +742,42 @@ void CPU::process(unsigned long const cycles) {
 		} else while (cycleCounter < mem_.nextEventTime()) {
 			unsigned char opcode;
 
-			PC_READ(opcode);
-
-			if (skip_) {
-				pc = (pc - 1) & 0xFFFF;
-				skip_ = false;
-			}
+			FETCH_OPCODE(opcode);
 
-			switch (opcode) {
-			case 0x00:
-				break;
-			case 0x01:
+			DISPATCH_OPCODE(opcode) {
+			OPCODE(0x00):
+				NEXT_OPCODE;
+			OPCODE(0x01):
 				ld_rr_nn(b, c);
-				break;
-			case 0x02:
+				NEXT_OPCODE;
+			OPCODE(0x02):
 				WRITE(bc(), a);
-				break;
-			case 0x03:
+				NEXT_OPCODE;
+			OPCODE(0x03):
 				inc_rr(b, c);
-				break;
-			case 0x04:
+				NEXT_OPCODE;
+			OPCODE(0x04):
 				inc_r(b);
-				break;
-			case 0x05:
+				NEXT_OPCODE;
+			OPCODE(0x05):
 				dec_r(b); 
-				break;
-			case 0x06:
+				NEXT_OPCODE;
+			OPCODE(0x06):
 				PC_READ(b);
-				break;
+				NEXT_OPCODE;
 
 				// rlca (4 cycles):
 				// Rotate 8-bit register A left, store old bit7 in CF. Reset SF, HCF, ZF:
-			case 0x07:
+			OPCODE(0x07):
 				cf = a << 1;
 				a = (cf | cf >> 8) & 0xFF;
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OPCODE;
 
 				// ld (nn),SP (20 cycles):
 				// Put value of SP into address given by next 2 bytes in memory:
-			case 0x08:
+			OPCODE(0x08):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -559,39 +788,39 @@ void CPU::process(unsigned long const cycles) {
 					WRITE((addr + 1) & 0xFFFF, sp >> 8);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x09:
+			OPCODE(0x09):
 				add_hl_rr(b, c);
-				break;
-			case 0x0A:
+				NEXT_OPCODE;
+			OPCODE(0x0A):
 				READ(a, bc());
-				break;
-			case 0x0B:
+				NEXT_OPCODE;
+			OPCODE(0x0B):
 				dec_rr(b, c);
-				break;
-			case 0x0C:
+				NEXT_OPCODE;
+			OPCODE(0x0C):
 				inc_r(c);
-				break;
-			case 0x0D:
+				NEXT_OPCODE;
+			OPCODE(0x0D):
 				dec_r(c);
-				break;
-			case 0x0E:
+				NEXT_OPCODE;
+			OPCODE(0x0E):
 				PC_READ(c);
-				break;
+				NEXT_OPCODE;
 
 				// rrca (4 cycles):
 				// Rotate 8-bit register A right, store old bit0 in CF. Reset SF, HCF, ZF:
-			case 0x0F:
+			OPCODE(0x0F):
 				cf = a << 8 | a;
 				a = cf >> 1 & 0xFF;
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OPCODE;
 
 				// stop (4 cycles):
 				// Halt CPU and LCD display until button pressed:
-			case 0x10:
+			OPCODE(0x10):
 				pc = (pc + 1) & 0xFFFF;
 
 				cycleCounter = mem_.stop(cycleCounter);
@@ -601,31 +830,31 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += cycles + (-cycles & 3);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x11:
+			OPCODE(0x11):
 				ld_rr_nn(d, e);
-				break;
-			case 0x12:
+				NEXT_OPCODE;
+			OPCODE(0x12):
 				WRITE(de(), a);
-				break;
-			case 0x13:
+				NEXT_OPCODE;
+			OPCODE(0x13):
 				inc_rr(d, e);
-				break;
-			case 0x14:
+				NEXT_OPCODE;
+			OPCODE(0x14):
 				inc_r(d);
-				break;
-			case 0x15:
+				NEXT_OPCODE;
+			OPCODE(0x15):
 				dec_r(d);
-				break;
-			case 0x16:
+				NEXT_OPCODE;
+			OPCODE(0x16):
 				PC_READ(d);
-				break;
+				NEXT_OPCODE;
 
 				// rla (4 cycles):
 				// Rotate 8-bit register A left through CF, store old bit7 in CF,
 				// old CF value becomes bit0. Reset SF, HCF, ZF:
-			case 0x17:
+			OPCODE(0x17):
 				{
 					unsigned oldcf = cf >> 8 & 1;
 					cf = a << 1;
@@ -634,34 +863,34 @@ void CPU::process(unsigned long const cycles) {
 
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OPCODE;
 
-			case 0x18:
+			OPCODE(0x18):
 				jr_disp();
-				break;
-			case 0x19:
+				NEXT_OPCODE;
+			OPCODE(0x19):
 				add_hl_rr(d, e);
-				break;
-			case 0x1A:
+				NEXT_OPCODE;
+			OPCODE(0x1A):
 				READ(a, de());
-				break;
-			case 0x1B:
+				NEXT_OPCODE;
+			OPCODE(0x1B):
 				dec_rr(d, e);
-				break;
-			case 0x1C:
+				NEXT_OPCODE;
+			OPCODE(0x1C):
 				inc_r(e);
-				break;
-			case 0x1D:
+				NEXT_OPCODE;
+			OPCODE(0x1D):
 				dec_r(e);
-				break;
-			case 0x1E:
+				NEXT_OPCODE;
+			OPCODE(0x1E):
 				PC_READ(e);
-				break;
+				NEXT_OPCODE;
 
 				// rra (4 cycles):
 				// Rotate 8-bit register A right through CF, store old bit0 in CF,
 				// old CF value becomes bit7. Reset SF, HCF, ZF:
-			case 0x1F:
+			OPCODE(0x1F):
 				{
 					unsigned oldcf = cf & 0x100;
 					cf = a << 8;
@@ -670,24 +899,24 @@ void CPU::process(unsigned long const cycles) {
 
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OPCODE;
 
 				// jr nz,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if ZF is unset:
-			case 0x20:
+			OPCODE(0x20):
 				if (zf & 0xFF) {
 					jr_disp();
 				} else {
-					PC_MOD((pc + 1) & 0xFFFF);
+					jr_skip();
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x21: ld_rr_nn(h, l); break;
+			OPCODE(0x21): ld_rr_nn(h, l); NEXT_OPCODE;
 
 				// ldi (hl),a (8 cycles):
 				// Put A into memory address in hl. Increment HL:
-			case 0x22:
+			OPCODE(0x22):
 				{
 					unsigned addr = hl();
 					WRITE(addr, a);
@@ -697,24 +926,24 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x23:
+			OPCODE(0x23):
 				inc_rr(h, l);
-				break;
-			case 0x24:
+				NEXT_OPCODE;
+			OPCODE(0x24):
 				inc_r(h);
-				break;
-			case 0x25:
+				NEXT_OPCODE;
+			OPCODE(0x25):
 				dec_r(h);
-				break;
-			case 0x26:
+				NEXT_OPCODE;
+			OPCODE(0x26):
 				PC_READ(h);
-				break;
+				NEXT_OPCODE;
 
 				// daa (4 cycles):
 				// Adjust register A to correctly represent a BCD. Check ZF, HF and CF:
-			case 0x27:
+			OPCODE(0x27):
 				hf2 = updateHf2FromHf1(hf1, hf2);
 
 				{
@@ -738,26 +967,26 @@ void CPU::process(unsigned long const cycles) {
 					a &= 0xFF;
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// jr z,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if ZF is set:
-			case 0x28:
+			OPCODE(0x28):
 				if (zf & 0xFF) {
-					PC_MOD((pc + 1) & 0xFFFF);
+					jr_skip();
 				} else {
 					jr_disp();
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x29:
+			OPCODE(0x29):
 				add_hl_rr(h, l);
-				break;
+				NEXT_OPCODE;
 
 				// ldi a,(hl) (8 cycles):
 				// Put value at address in hl into A. Increment HL:
-			case 0x2A:
+			OPCODE(0x2A):
 				{
 					unsigned addr = hl();
 					READ(a, addr);
@@ -767,42 +996,42 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x2B:
+			OPCODE(0x2B):
 				dec_rr(h, l);
-				break;
-			case 0x2C:
+				NEXT_OPCODE;
+			OPCODE(0x2C):
 				inc_r(l);
-				break;
-			case 0x2D:
+				NEXT_OPCODE;
+			OPCODE(0x2D):
 				dec_r(l);
-				break;
-			case 0x2E:
+				NEXT_OPCODE;
+			OPCODE(0x2E):
 				PC_READ(l);
-				break;
+				NEXT_OPCODE;
 
 				// cpl (4 cycles):
 				// Complement register A. (Flip all bits), set SF and HCF:
-			case 0x2F:
+			OPCODE(0x2F):
 				hf2 = hf2_subf | hf2_hcf;
 				a ^= 0xFF;
-				break;
+				NEXT_OPCODE;
 
 				// jr nc,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if CF is unset:
-			case 0x30:
+			OPCODE(0x30):
 				if (cf & 0x100) {
-					PC_MOD((pc + 1) & 0xFFFF);
+					jr_skip();
 				} else {
 					jr_disp();
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// ld sp,nn (12 cycles)
 				// set sp to 16-bit value of next 2 bytes in memory
-			case 0x31:
+			OPCODE(0x31):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -811,11 +1040,11 @@ void CPU::process(unsigned long const cycles) {
 					sp = immh << 8 | imml;
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// ldd (hl),a (8 cycles):
 				// Put A into memory address in hl. Decrement HL:
-			case 0x32:
+			OPCODE(0x32):
 				{
 					unsigned addr = hl();
 					WRITE(addr, a);
@@ -825,16 +1054,16 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x33:
+			OPCODE(0x33):
 				sp = (sp + 1) & 0xFFFF;
 				cycleCounter += 4;
-				break;
+				NEXT_OPCODE;
 
 				// inc (hl) (12 cycles):
 				// Increment value at address in hl, check flags except CF:
-			case 0x34:
+			OPCODE(0x34):
 				{
 					unsigned const addr = hl();
 					READ(hf2, addr);
@@ -843,11 +1072,11 @@ void CPU::process(unsigned long const cycles) {
 					hf2 |= hf2_incf;
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// dec (hl) (12 cycles):
 				// Decrement value at address in hl, check flags except CF:
-			case 0x35:
+			OPCODE(0x35):
 				{
 					unsigned const addr = hl();
 					READ(hf2, addr);
@@ -856,40 +1085,40 @@ void CPU::process(unsigned long const cycles) {
 					hf2 |= hf2_incf | hf2_subf;
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// ld (hl),n (12 cycles):
 				// set memory at address in hl to value of next byte in memory:
-			case 0x36:
+			OPCODE(0x36):
 				{
 					unsigned imm;
 					PC_READ(imm);
 					WRITE(hl(), imm);
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// scf (4 cycles):
 				// Set CF. Unset SF and HCF:
-			case 0x37:
+			OPCODE(0x37):
 				cf = 0x100;
 				hf2 = 0;
-				break;
+				NEXT_OPCODE;
 
 				// jr c,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if CF is set:
-			case 0x38:
+			OPCODE(0x38):
 				if (cf & 0x100) {
 					jr_disp();
 				} else {
-					PC_MOD((pc + 1) & 0xFFFF);
+					jr_skip();
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// add hl,sp (8 cycles):
 				// add SP to HL, check flags except ZF:
-			case 0x39:
+			OPCODE(0x39):
 				cf = l + sp;
 				l = cf & 0xFF;
 				hf1 = h;
@@ -898,11 +1127,11 @@ void CPU::process(unsigned long const cycles) {
 				cf += h;
 				h = cf & 0xFF;
 				cycleCounter += 4;
-				break;
+				NEXT_OPCODE;
 
 				// ldd a,(hl) (8 cycles):
 				// Put value at address in hl into A. Decrement HL:
-			case 0x3A:
+			OPCODE(0x3A):
 				{
 					unsigned addr = hl();
 					a = mem_.read(addr, cycleCounter);
@@ -913,93 +1142,93 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0x3B:
+			OPCODE(0x3B):
 				sp = (sp - 1) & 0xFFFF;
 				cycleCounter += 4;
-				break;
+				NEXT_OPCODE;
 
-			case 0x3C:
+			OPCODE(0x3C):
 				inc_r(a);
-				break;
-			case 0x3D:
+				NEXT_OPCODE;
+			OPCODE(0x3D):
 				dec_r(a);
-				break;
-			case 0x3E:
+				NEXT_OPCODE;
+			OPCODE(0x3E):
 				PC_READ(a);
-				break;
+				NEXT_OPCODE;
 
 				// ccf (4 cycles):
 				// Complement CF (unset if set vv.) Unset SF and HCF.
-			case 0x3F:
+			OPCODE(0x3F):
 				cf ^= 0x100;
 				hf2 = 0;
-				break;
-
-			case 0x40: /*b = b;*/ break;
-			case 0x41: b = c; break;
-			case 0x42: b = d; break;
-			case 0x43: b = e; break;
-			case 0x44: b = h; break;
-			case 0x45: b = l; break;
-			case 0x46: READ(b, hl()); break;
-			case 0x47: b = a; break;
-
-			case 0x48: c = b; break;
-			case 0x49: /*c = c;*/ break;
-			case 0x4A: c = d; break;
-			case 0x4B: c = e; break;
-			case 0x4C: c = h; break;
-			case 0x4D: c = l; break;
-			case 0x4E: READ(c, hl()); break;
-			case 0x4F: c = a; break;
-
-			case 0x50: d = b; break;
-			case 0x51: d = c; break;
-			case 0x52: /*d = d;*/ break;
-			case 0x53: d = e; break;
-			case 0x54: d = h; break;
-			case 0x55: d = l; break;
-			case 0x56: READ(d, hl()); break;
-			case 0x57: d = a; break;
-
-			case 0x58: e = b; break;
-			case 0x59: e = c; break;
-			case 0x5A: e = d; break;
-			case 0x5B: /*e = e;*/ break;
-			case 0x5C: e = h; break;
-			case 0x5D: e = l; break;
-			case 0x5E: READ(e, hl()); break;
-			case 0x5F: e = a; break;
-
-			case 0x60: h = b; break;
-			case 0x61: h = c; break;
-			case 0x62: h = d; break;
-			case 0x63: h = e; break;
-			case 0x64: /*h = h;*/ break;
-			case 0x65: h = l; break;
-			case 0x66: READ(h, hl()); break;
-			case 0x67: h = a; break;
-
-			case 0x68: l = b; break;
-			case 0x69: l = c; break;
-			case 0x6A: l = d; break;
-			case 0x6B: l = e; break;
-			case 0x6C: l = h; break;
-			case 0x6D: /*l = l;*/ break;
-			case 0x6E: READ(l, hl()); break;
-			case 0x6F: l = a; break;
-
-			case 0x70: WRITE(hl(), b); break;
-			case 0x71: WRITE(hl(), c); break;
-			case 0x72: WRITE(hl(), d); break;
-			case 0x73: WRITE(hl(), e); break;
-			case 0x74: WRITE(hl(), h); break;
-			case 0x75: WRITE(hl(), l); break;
+				NEXT_OPCODE;
+
+			OPCODE(0x40): /*b = b;*/ NEXT_OPCODE;
+			OPCODE(0x41): b = c; NEXT_OPCODE;
+			OPCODE(0x42): b = d; NEXT_OPCODE;
+			OPCODE(0x43): b = e; NEXT_OPCODE;
+			OPCODE(0x44): b = h; NEXT_OPCODE;
+			OPCODE(0x45): b = l; NEXT_OPCODE;
+			OPCODE(0x46): READ(b, hl()); NEXT_OPCODE;
+			OPCODE(0x47): b = a; NEXT_OPCODE;
+
+			OPCODE(0x48): c = b; NEXT_OPCODE;
+			OPCODE(0x49): /*c = c;*/ NEXT_OPCODE;
+			OPCODE(0x4A): c = d; NEXT_OPCODE;
+			OPCODE(0x4B): c = e; NEXT_OPCODE;
+			OPCODE(0x4C): c = h; NEXT_OPCODE;
+			OPCODE(0x4D): c = l; NEXT_OPCODE;
+			OPCODE(0x4E): READ(c, hl()); NEXT_OPCODE;
+			OPCODE(0x4F): c = a; NEXT_OPCODE;
+
+			OPCODE(0x50): d = b; NEXT_OPCODE;
+			OPCODE(0x51): d = c; NEXT_OPCODE;
+			OPCODE(0x52): /*d = d;*/ NEXT_OPCODE;
+			OPCODE(0x53): d = e; NEXT_OPCODE;
+			OPCODE(0x54): d = h; NEXT_OPCODE;
+			OPCODE(0x55): d = l; NEXT_OPCODE;
+			OPCODE(0x56): READ(d, hl()); NEXT_OPCODE;
+			OPCODE(0x57): d = a; NEXT_OPCODE;
+
+			OPCODE(0x58): e = b; NEXT_OPCODE;
+			OPCODE(0x59): e = c; NEXT_OPCODE;
+			OPCODE(0x5A): e = d; NEXT_OPCODE;
+			OPCODE(0x5B): /*e = e;*/ NEXT_OPCODE;
+			OPCODE(0x5C): e = h; NEXT_OPCODE;
+			OPCODE(0x5D): e = l; NEXT_OPCODE;
+			OPCODE(0x5E): READ(e, hl()); NEXT_OPCODE;
+			OPCODE(0x5F): e = a; NEXT_OPCODE;
+
+			OPCODE(0x60): h = b; NEXT_OPCODE;
+			OPCODE(0x61): h = c; NEXT_OPCODE;
+			OPCODE(0x62): h = d; NEXT_OPCODE;
+			OPCODE(0x63): h = e; NEXT_OPCODE;
+			OPCODE(0x64): /*h = h;*/ NEXT_OPCODE;
+			OPCODE(0x65): h = l; NEXT_OPCODE;
+			OPCODE(0x66): READ(h, hl()); NEXT_OPCODE;
+			OPCODE(0x67): h = a; NEXT_OPCODE;
+
+			OPCODE(0x68): l = b; NEXT_OPCODE;
+			OPCODE(0x69): l = c; NEXT_OPCODE;
+			OPCODE(0x6A): l = d; NEXT_OPCODE;
+			OPCODE(0x6B): l = e; NEXT_OPCODE;
+			OPCODE(0x6C): l = h; NEXT_OPCODE;
+			OPCODE(0x6D): /*l = l;*/ NEXT_OPCODE;
+			OPCODE(0x6E): READ(l, hl()); NEXT_OPCODE;
+			OPCODE(0x6F): l = a; NEXT_OPCODE;
+
+			OPCODE(0x70): WRITE(hl(), b); NEXT_OPCODE;
+			OPCODE(0x71): WRITE(hl(), c); NEXT_OPCODE;
+			OPCODE(0x72): WRITE(hl(), d); NEXT_OPCODE;
+			OPCODE(0x73): WRITE(hl(), e); NEXT_OPCODE;
+			OPCODE(0x74): WRITE(hl(), h); NEXT_OPCODE;
+			OPCODE(0x75): WRITE(hl(), l); NEXT_OPCODE;
 
 				// halt (4 cycles):
-			case 0x76:
+			OPCODE(0x76):
 				if (!mem_.ime()
 					&& (   mem_.ff_read(0x0F, cycleCounter)
 					     & mem_.ff_read(0xFF, cycleCounter) & 0x1F)) {
@@ -1016,130 +1245,130 @@ void CPU::process(unsigned long const cycles) {
 					}
 				}
 
-				break;
-
-			case 0x77: WRITE(hl(), a); break;
-			case 0x78: a = b; break;
-			case 0x79: a = c; break;
-			case 0x7A: a = d; break;
-			case 0x7B: a = e; break;
-			case 0x7C: a = h; break;
-			case 0x7D: a = l; break;
-			case 0x7E: READ(a, hl()); break;
-			case 0x7F: /*a = a;*/ break;
-
-			case 0x80: add_a_u8(b); break;
-			case 0x81: add_a_u8(c); break;
-			case 0x82: add_a_u8(d); break;
-			case 0x83: add_a_u8(e); break;
-			case 0x84: add_a_u8(h); break;
-			case 0x85: add_a_u8(l); break;
-			case 0x86: { unsigned data; READ(data, hl()); add_a_u8(data); } break;
-			case 0x87: add_a_u8(a); break;
-
-			case 0x88: adc_a_u8(b); break;
-			case 0x89: adc_a_u8(c); break;
-			case 0x8A: adc_a_u8(d); break;
-			case 0x8B: adc_a_u8(e); break;
-			case 0x8C: adc_a_u8(h); break;
-			case 0x8D: adc_a_u8(l); break;
-			case 0x8E: { unsigned data; READ(data, hl()); adc_a_u8(data); } break;
-			case 0x8F: adc_a_u8(a); break;
-
-			case 0x90: sub_a_u8(b); break;
-			case 0x91: sub_a_u8(c); break;
-			case 0x92: sub_a_u8(d); break;
-			case 0x93: sub_a_u8(e); break;
-			case 0x94: sub_a_u8(h); break;
-			case 0x95: sub_a_u8(l); break;
-			case 0x96: { unsigned data; READ(data, hl()); sub_a_u8(data); } break;
+				NEXT_OPCODE;
+
+			OPCODE(0x77): WRITE(hl(), a); NEXT_OPCODE;
+			OPCODE(0x78): a = b; NEXT_OPCODE;
+			OPCODE(0x79): a = c; NEXT_OPCODE;
+			OPCODE(0x7A): a = d; NEXT_OPCODE;
+			OPCODE(0x7B): a = e; NEXT_OPCODE;
+			OPCODE(0x7C): a = h; NEXT_OPCODE;
+			OPCODE(0x7D): a = l; NEXT_OPCODE;
+			OPCODE(0x7E): READ(a, hl()); NEXT_OPCODE;
+			OPCODE(0x7F): /*a = a;*/ NEXT_OPCODE;
+
+			OPCODE(0x80): add_a_u8(b); NEXT_OPCODE;
+			OPCODE(0x81): add_a_u8(c); NEXT_OPCODE;
+			OPCODE(0x82): add_a_u8(d); NEXT_OPCODE;
+			OPCODE(0x83): add_a_u8(e); NEXT_OPCODE;
+			OPCODE(0x84): add_a_u8(h); NEXT_OPCODE;
+			OPCODE(0x85): add_a_u8(l); NEXT_OPCODE;
+			OPCODE(0x86): { unsigned data; READ(data, hl()); add_a_u8(data); } NEXT_OPCODE;
+			OPCODE(0x87): add_a_u8(a); NEXT_OPCODE;
+
+			OPCODE(0x88): adc_a_u8(b); NEXT_OPCODE;
+			OPCODE(0x89): adc_a_u8(c); NEXT_OPCODE;
+			OPCODE(0x8A): adc_a_u8(d); NEXT_OPCODE;
+			OPCODE(0x8B): adc_a_u8(e); NEXT_OPCODE;
+			OPCODE(0x8C): adc_a_u8(h); NEXT_OPCODE;
+			OPCODE(0x8D): adc_a_u8(l); NEXT_OPCODE;
+			OPCODE(0x8E): { unsigned data; READ(data, hl()); adc_a_u8(data); } NEXT_OPCODE;
+			OPCODE(0x8F): adc_a_u8(a); NEXT_OPCODE;
+
+			OPCODE(0x90): sub_a_u8(b); NEXT_OPCODE;
+			OPCODE(0x91): sub_a_u8(c); NEXT_OPCODE;
+			OPCODE(0x92): sub_a_u8(d); NEXT_OPCODE;
+			OPCODE(0x93): sub_a_u8(e); NEXT_OPCODE;
+			OPCODE(0x94): sub_a_u8(h); NEXT_OPCODE;
+			OPCODE(0x95): sub_a_u8(l); NEXT_OPCODE;
+			OPCODE(0x96): { unsigned data; READ(data, hl()); sub_a_u8(data); } NEXT_OPCODE;
 
 				// A-A is always 0:
-			case 0x97:
+			OPCODE(0x97):
 				hf2 = hf2_subf;
 				cf = zf = a = 0;
-				break;
-
-			case 0x98: sbc_a_u8(b); break;
-			case 0x99: sbc_a_u8(c); break;
-			case 0x9A: sbc_a_u8(d); break;
-			case 0x9B: sbc_a_u8(e); break;
-			case 0x9C: sbc_a_u8(h); break;
-			case 0x9D: sbc_a_u8(l); break;
-			case 0x9E: { unsigned data; READ(data, hl()); sbc_a_u8(data); } break;
-			case 0x9F: sbc_a_u8(a); break;
-
-			case 0xA0: and_a_u8(b); break;
-			case 0xA1: and_a_u8(c); break;
-			case 0xA2: and_a_u8(d); break;
-			case 0xA3: and_a_u8(e); break;
-			case 0xA4: and_a_u8(h); break;
-			case 0xA5: and_a_u8(l); break;
-			case 0xA6: { unsigned data; READ(data, hl()); and_a_u8(data); } break;
+				NEXT_OPCODE;
+
+			OPCODE(0x98): sbc_a_u8(b); NEXT_OPCODE;
+			OPCODE(0x99): sbc_a_u8(c); NEXT_OPCODE;
+			OPCODE(0x9A): sbc_a_u8(d); NEXT_OPCODE;
+			OPCODE(0x9B): sbc_a_u8(e); NEXT_OPCODE;
+			OPCODE(0x9C): sbc_a_u8(h); NEXT_OPCODE;
+			OPCODE(0x9D): sbc_a_u8(l); NEXT_OPCODE;
+			OPCODE(0x9E): { unsigned data; READ(data, hl()); sbc_a_u8(data); } NEXT_OPCODE;
+			OPCODE(0x9F): sbc_a_u8(a); NEXT_OPCODE;
+
+			OPCODE(0xA0): and_a_u8(b); NEXT_OPCODE;
+			OPCODE(0xA1): and_a_u8(c); NEXT_OPCODE;
+			OPCODE(0xA2): and_a_u8(d); NEXT_OPCODE;
+			OPCODE(0xA3): and_a_u8(e); NEXT_OPCODE;
+			OPCODE(0xA4): and_a_u8(h); NEXT_OPCODE;
+			OPCODE(0xA5): and_a_u8(l); NEXT_OPCODE;
+			OPCODE(0xA6): { unsigned data; READ(data, hl()); and_a_u8(data); } NEXT_OPCODE;
 
 				// A&A will always be A:
-			case 0xA7:
+			OPCODE(0xA7):
 				zf = a;
 				cf = 0;
 				hf2 = hf2_hcf;
-				break;
+				NEXT_OPCODE;
 
-			case 0xA8: xor_a_u8(b); break;
-			case 0xA9: xor_a_u8(c); break;
-			case 0xAA: xor_a_u8(d); break;
-			case 0xAB: xor_a_u8(e); break;
-			case 0xAC: xor_a_u8(h); break;
-			case 0xAD: xor_a_u8(l); break;
-			case 0xAE: { unsigned data; READ(data, hl()); xor_a_u8(data); } break;
+			OPCODE(0xA8): xor_a_u8(b); NEXT_OPCODE;
+			OPCODE(0xA9): xor_a_u8(c); NEXT_OPCODE;
+			OPCODE(0xAA): xor_a_u8(d); NEXT_OPCODE;
+			OPCODE(0xAB): xor_a_u8(e); NEXT_OPCODE;
+			OPCODE(0xAC): xor_a_u8(h); NEXT_OPCODE;
+			OPCODE(0xAD): xor_a_u8(l); NEXT_OPCODE;
+			OPCODE(0xAE): { unsigned data; READ(data, hl()); xor_a_u8(data); } NEXT_OPCODE;
 
 				// A^A will always be 0:
-			case 0xAF: cf = hf2 = zf = a = 0; break;
+			OPCODE(0xAF): cf = hf2 = zf = a = 0; NEXT_OPCODE;
 
-			case 0xB0: or_a_u8(b); break;
-			case 0xB1: or_a_u8(c); break;
-			case 0xB2: or_a_u8(d); break;
-			case 0xB3: or_a_u8(e); break;
-			case 0xB4: or_a_u8(h); break;
-			case 0xB5: or_a_u8(l); break;
-			case 0xB6: { unsigned data; READ(data, hl()); or_a_u8(data); } break;
+			OPCODE(0xB0): or_a_u8(b); NEXT_OPCODE;
+			OPCODE(0xB1): or_a_u8(c); NEXT_OPCODE;
+			OPCODE(0xB2): or_a_u8(d); NEXT_OPCODE;
+			OPCODE(0xB3): or_a_u8(e); NEXT_OPCODE;
+			OPCODE(0xB4): or_a_u8(h); NEXT_OPCODE;
+			OPCODE(0xB5): or_a_u8(l); NEXT_OPCODE;
+			OPCODE(0xB6): { unsigned data; READ(data, hl()); or_a_u8(data); } NEXT_OPCODE;
 
 				// A|A will always be A:
-			case 0xB7:
+			OPCODE(0xB7):
 				zf = a;
 				hf2 = cf = 0;
-				break;
+				NEXT_OPCODE;
 
-			case 0xB8: cp_a_u8(b); break;
-			case 0xB9: cp_a_u8(c); break;
-			case 0xBA: cp_a_u8(d); break;
-			case 0xBB: cp_a_u8(e); break;
-			case 0xBC: cp_a_u8(h); break;
-			case 0xBD: cp_a_u8(l); break;
-			case 0xBE: { unsigned data; READ(data, hl()); cp_a_u8(data); } break;
+			OPCODE(0xB8): cp_a_u8(b); NEXT_OPCODE;
+			OPCODE(0xB9): cp_a_u8(c); NEXT_OPCODE;
+			OPCODE(0xBA): cp_a_u8(d); NEXT_OPCODE;
+			OPCODE(0xBB): cp_a_u8(e); NEXT_OPCODE;
+			OPCODE(0xBC): cp_a_u8(h); NEXT_OPCODE;
+			OPCODE(0xBD): cp_a_u8(l); NEXT_OPCODE;
+			OPCODE(0xBE): { unsigned data; READ(data, hl()); cp_a_u8(data); } NEXT_OPCODE;
 
 				// A always equals A:
-			case 0xBF:
+			OPCODE(0xBF):
 				cf = zf = 0;
 				hf2 = hf2_subf;
-				break;
+				NEXT_OPCODE;
 
 				// ret nz (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if ZF is unset:
-			case 0xC0:
+			OPCODE(0xC0):
 				cycleCounter += 4;
 
 				if (zf & 0xFF)
 					ret();
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xC1:
+			OPCODE(0xC1):
 				pop_rr(b, c);
-				break;
+				NEXT_OPCODE;
 
 				// jp nz,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if ZF is unset:
-			case 0xC2:
+			OPCODE(0xC2):
 				if (zf & 0xFF) {
 					jp_nn();
 				} else {
@@ -1147,16 +1376,16 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xC3:
+			OPCODE(0xC3):
 				jp_nn();
-				break;
+				NEXT_OPCODE;
 
 				// call nz,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if ZF is unset:
-			case 0xC4:
+			OPCODE(0xC4):
 				if (zf & 0xFF) {
 					call_nn();
 				} else {
@@ -1164,43 +1393,43 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xC5:
+			OPCODE(0xC5):
 				push_rr(b, c);
-				break;
-			case 0xC6:
+				NEXT_OPCODE;
+			OPCODE(0xC6):
 				{
 					unsigned data;
 					PC_READ(data);
 					add_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xC7:
+			OPCODE(0xC7):
 				rst_n(0x00);
-				break;
+				NEXT_OPCODE;
 
 				// ret z (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if ZF is set:
-			case 0xC8:
+			OPCODE(0xC8):
 				cycleCounter += 4;
 
 				if (!(zf & 0xFF))
 					ret();
 
-				break;
+				NEXT_OPCODE;
 
 				// ret (16 cycles):
 				// Pop two bytes from the stack and jump to that address:
-			case 0xC9:
+			OPCODE(0xC9):
 				ret();
-				break;
+				NEXT_OPCODE;
 
 				// jp z,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if ZF is set:
-			case 0xCA:
+			OPCODE(0xCA):
 				if (zf & 0xFF) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1208,25 +1437,25 @@ void CPU::process(unsigned long const cycles) {
 					jp_nn();
 				}
 
-				break;
+				NEXT_OPCODE;
 
 
 				// CB OPCODES (Shifts, rotates and bits):
-			case 0xCB:
+			OPCODE(0xCB):
 				PC_READ(opcode);
 
-				switch (opcode) {
-				case 0x00: rlc_r(b); break;
-				case 0x01: rlc_r(c); break;
-				case 0x02: rlc_r(d); break;
-				case 0x03: rlc_r(e); break;
-				case 0x04: rlc_r(h); break;
-				case 0x05: rlc_r(l); break;
+				DISPATCH_CB_OPCODE(opcode) {
+				CB_OPCODE(0x00): rlc_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x01): rlc_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x02): rlc_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x03): rlc_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x04): rlc_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x05): rlc_r(l); NEXT_CB_OPCODE;
 
 					// rlc (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL left, store old bit7 in CF.
 					// Reset SF and HCF. Check ZF:
-				case 0x06:
+				CB_OPCODE(0x06):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1236,21 +1465,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_CB_OPCODE;
 
-				case 0x07: rlc_r(a); break;
+				CB_OPCODE(0x07): rlc_r(a); NEXT_CB_OPCODE;
 
-				case 0x08: rrc_r(b); break;
-				case 0x09: rrc_r(c); break;
-				case 0x0A: rrc_r(d); break;
-				case 0x0B: rrc_r(e); break;
-				case 0x0C: rrc_r(h); break;
-				case 0x0D: rrc_r(l); break;
+				CB_OPCODE(0x08): rrc_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x09): rrc_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x0A): rrc_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x0B): rrc_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x0C): rrc_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x0D): rrc_r(l); NEXT_CB_OPCODE;
 
 					// rrc (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL right, store old bit0 in CF.
 					// Reset SF and HCF. Check ZF:
-				case 0x0E:
+				CB_OPCODE(0x0E):
 					{
 						unsigned const addr = hl();
 						READ(zf, addr);
@@ -1259,21 +1488,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_CB_OPCODE;
 
-				case 0x0F: rrc_r(a); break;
+				CB_OPCODE(0x0F): rrc_r(a); NEXT_CB_OPCODE;
 
-				case 0x10: rl_r(b); break;
-				case 0x11: rl_r(c); break;
-				case 0x12: rl_r(d); break;
-				case 0x13: rl_r(e); break;
-				case 0x14: rl_r(h); break;
-				case 0x15: rl_r(l); break;
+				CB_OPCODE(0x10): rl_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x11): rl_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x12): rl_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x13): rl_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x14): rl_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x15): rl_r(l); NEXT_CB_OPCODE;
 
 					// rl (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL left thorugh CF,
 					// store old bit7 in CF, old CF value becoms bit0. Reset SF and HCF. Check ZF:
-				case 0x16:
+				CB_OPCODE(0x16):
 					{
 						unsigned const addr = hl();
 						unsigned const oldcf = cf >> 8 & 1;
@@ -1283,21 +1512,21 @@ void CPU::process(unsigned long const cycles) {
 						WRITE(addr, zf & 0xFF);
 						hf2 = 0;
 					}
-					break;
+					NEXT_CB_OPCODE;
 
-				case 0x17: rl_r(a); break;
+				CB_OPCODE(0x17): rl_r(a); NEXT_CB_OPCODE;
 
-				case 0x18: rr_r(b); break;
-				case 0x19: rr_r(c); break;
-				case 0x1A: rr_r(d); break;
-				case 0x1B: rr_r(e); break;
-				case 0x1C: rr_r(h); break;
-				case 0x1D: rr_r(l); break;
+				CB_OPCODE(0x18): rr_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x19): rr_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x1A): rr_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x1B): rr_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x1C): rr_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x1D): rr_r(l); NEXT_CB_OPCODE;
 
 					// rr (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL right thorugh CF,
 					// store old bit0 in CF, old CF value becoms bit7. Reset SF and HCF. Check ZF:
-				case 0x1E:
+				CB_OPCODE(0x1E):
 					{
 						unsigned const addr = hl();
 						READ(zf, addr);
@@ -1309,21 +1538,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_CB_OPCODE;
 
-				case 0x1F: rr_r(a); break;
+				CB_OPCODE(0x1F): rr_r(a); NEXT_CB_OPCODE;
 
-				case 0x20: sla_r(b); break;
-				case 0x21: sla_r(c); break;
-				case 0x22: sla_r(d); break;
-				case 0x23: sla_r(e); break;
-				case 0x24: sla_r(h); break;
-				case 0x25: sla_r(l); break;
+				CB_OPCODE(0x20): sla_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x21): sla_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x22): sla_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x23): sla_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x24): sla_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x25): sla_r(l); NEXT_CB_OPCODE;
 
 					// sla (hl) (16 cycles):
 					// Shift 8-bit value stored at address in HL left, store old bit7 in CF.
 					// Reset SF and HCF. Check ZF:
-				case 0x26:
+				CB_OPCODE(0x26):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1333,21 +1562,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_CB_OPCODE;
 
-				case 0x27: sla_r(a); break;
+				CB_OPCODE(0x27): sla_r(a); NEXT_CB_OPCODE;
 
-				case 0x28: sra_r(b); break;
-				case 0x29: sra_r(c); break;
-				case 0x2A: sra_r(d); break;
-				case 0x2B: sra_r(e); break;
-				case 0x2C: sra_r(h); break;
-				case 0x2D: sra_r(l); break;
+				CB_OPCODE(0x28): sra_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x29): sra_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x2A): sra_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x2B): sra_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x2C): sra_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x2D): sra_r(l); NEXT_CB_OPCODE;
 
 					// sra (hl) (16 cycles):
 					// Shift 8-bit value stored at address in HL right, store old bit0 in CF,
 					// bit7=old bit7. Reset SF and HCF. Check ZF:
-				case 0x2E:
+				CB_OPCODE(0x2E):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1357,21 +1586,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_CB_OPCODE;
 
-				case 0x2F: sra_r(a); break;
+				CB_OPCODE(0x2F): sra_r(a); NEXT_CB_OPCODE;
 
-				case 0x30: swap_r(b); break;
-				case 0x31: swap_r(c); break;
-				case 0x32: swap_r(d); break;
-				case 0x33: swap_r(e); break;
-				case 0x34: swap_r(h); break;
-				case 0x35: swap_r(l); break;
+				CB_OPCODE(0x30): swap_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x31): swap_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x32): swap_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x33): swap_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x34): swap_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x35): swap_r(l); NEXT_CB_OPCODE;
 
 					// swap (hl) (16 cycles):
 					// Swap upper and lower nibbles of 8-bit value stored at address in HL,
 					// reset flags, check zero flag:
-				case 0x36:
+				CB_OPCODE(0x36):
 					{
 						unsigned const addr = hl();
 						READ(zf, addr);
@@ -1379,21 +1608,21 @@ void CPU::process(unsigned long const cycles) {
 						cf = hf2 = 0;
 					}
 
-					break;
+					NEXT_CB_OPCODE;
 
-				case 0x37: swap_r(a); break;
+				CB_OPCODE(0x37): swap_r(a); NEXT_CB_OPCODE;
 
-				case 0x38: srl_r(b); break;
-				case 0x39: srl_r(c); break;
-				case 0x3A: srl_r(d); break;
-				case 0x3B: srl_r(e); break;
-				case 0x3C: srl_r(h); break;
-				case 0x3D: srl_r(l); break;
+				CB_OPCODE(0x38): srl_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x39): srl_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x3A): srl_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x3B): srl_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x3C): srl_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x3D): srl_r(l); NEXT_CB_OPCODE;
 
 					// srl (hl) (16 cycles):
 					// Shift 8-bit value stored at address in HL right,
 					// store old bit0 in CF. Reset SF and HCF. Check ZF:
-				case 0x3E:
+				CB_OPCODE(0x3E):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1403,234 +1632,234 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
-
-				case 0x3F: srl_r(a); break;
-
-				case 0x40: bit0_u8(b); break;
-				case 0x41: bit0_u8(c); break;
-				case 0x42: bit0_u8(d); break;
-				case 0x43: bit0_u8(e); break;
-				case 0x44: bit0_u8(h); break;
-				case 0x45: bit0_u8(l); break;
-				case 0x46: { unsigned data; READ(data, hl()); bit0_u8(data); } break;
-				case 0x47: bit0_u8(a); break;
-
-				case 0x48: bit1_u8(b); break;
-				case 0x49: bit1_u8(c); break;
-				case 0x4A: bit1_u8(d); break;
-				case 0x4B: bit1_u8(e); break;
-				case 0x4C: bit1_u8(h); break;
-				case 0x4D: bit1_u8(l); break;
-				case 0x4E: { unsigned data; READ(data, hl()); bit1_u8(data); } break;
-				case 0x4F: bit1_u8(a); break;
-
-				case 0x50: bit2_u8(b); break;
-				case 0x51: bit2_u8(c); break;
-				case 0x52: bit2_u8(d); break;
-				case 0x53: bit2_u8(e); break;
-				case 0x54: bit2_u8(h); break;
-				case 0x55: bit2_u8(l); break;
-				case 0x56: { unsigned data; READ(data, hl()); bit2_u8(data); } break;
-				case 0x57: bit2_u8(a); break;
-
-				case 0x58: bit3_u8(b); break;
-				case 0x59: bit3_u8(c); break;
-				case 0x5A: bit3_u8(d); break;
-				case 0x5B: bit3_u8(e); break;
-				case 0x5C: bit3_u8(h); break;
-				case 0x5D: bit3_u8(l); break;
-				case 0x5E: { unsigned data; READ(data, hl()); bit3_u8(data); } break;
-				case 0x5F: bit3_u8(a); break;
-
-				case 0x60: bit4_u8(b); break;
-				case 0x61: bit4_u8(c); break;
-				case 0x62: bit4_u8(d); break;
-				case 0x63: bit4_u8(e); break;
-				case 0x64: bit4_u8(h); break;
-				case 0x65: bit4_u8(l); break;
-				case 0x66: { unsigned data; READ(data, hl()); bit4_u8(data); } break;
-				case 0x67: bit4_u8(a); break;
-
-				case 0x68: bit5_u8(b); break;
-				case 0x69: bit5_u8(c); break;
-				case 0x6A: bit5_u8(d); break;
-				case 0x6B: bit5_u8(e); break;
-				case 0x6C: bit5_u8(h); break;
-				case 0x6D: bit5_u8(l); break;
-				case 0x6E: { unsigned data; READ(data, hl()); bit5_u8(data); } break;
-				case 0x6F: bit5_u8(a); break;
-
-				case 0x70: bit6_u8(b); break;
-				case 0x71: bit6_u8(c); break;
-				case 0x72: bit6_u8(d); break;
-				case 0x73: bit6_u8(e); break;
-				case 0x74: bit6_u8(h); break;
-				case 0x75: bit6_u8(l); break;
-				case 0x76: { unsigned data; READ(data, hl()); bit6_u8(data); } break;
-				case 0x77: bit6_u8(a); break;
-
-				case 0x78: bit7_u8(b); break;
-				case 0x79: bit7_u8(c); break;
-				case 0x7A: bit7_u8(d); break;
-				case 0x7B: bit7_u8(e); break;
-				case 0x7C: bit7_u8(h); break;
-				case 0x7D: bit7_u8(l); break;
-				case 0x7E: { unsigned data; READ(data, hl()); bit7_u8(data); } break;
-				case 0x7F: bit7_u8(a); break;
-
-				case 0x80: res0_r(b); break;
-				case 0x81: res0_r(c); break;
-				case 0x82: res0_r(d); break;
-				case 0x83: res0_r(e); break;
-				case 0x84: res0_r(h); break;
-				case 0x85: res0_r(l); break;
-				case 0x86: resn_mem_hl(0); break;
-				case 0x87: res0_r(a); break;
-
-				case 0x88: res1_r(b); break;
-				case 0x89: res1_r(c); break;
-				case 0x8A: res1_r(d); break;
-				case 0x8B: res1_r(e); break;
-				case 0x8C: res1_r(h); break;
-				case 0x8D: res1_r(l); break;
-				case 0x8E: resn_mem_hl(1); break;
-				case 0x8F: res1_r(a); break;
-
-				case 0x90: res2_r(b); break;
-				case 0x91: res2_r(c); break;
-				case 0x92: res2_r(d); break;
-				case 0x93: res2_r(e); break;
-				case 0x94: res2_r(h); break;
-				case 0x95: res2_r(l); break;
-				case 0x96: resn_mem_hl(2); break;
-				case 0x97: res2_r(a); break;
-
-				case 0x98: res3_r(b); break;
-				case 0x99: res3_r(c); break;
-				case 0x9A: res3_r(d); break;
-				case 0x9B: res3_r(e); break;
-				case 0x9C: res3_r(h); break;
-				case 0x9D: res3_r(l); break;
-				case 0x9E: resn_mem_hl(3); break;
-				case 0x9F: res3_r(a); break;
-
-				case 0xA0: res4_r(b); break;
-				case 0xA1: res4_r(c); break;
-				case 0xA2: res4_r(d); break;
-				case 0xA3: res4_r(e); break;
-				case 0xA4: res4_r(h); break;
-				case 0xA5: res4_r(l); break;
-				case 0xA6: resn_mem_hl(4); break;
-				case 0xA7: res4_r(a); break;
-
-				case 0xA8: res5_r(b); break;
-				case 0xA9: res5_r(c); break;
-				case 0xAA: res5_r(d); break;
-				case 0xAB: res5_r(e); break;
-				case 0xAC: res5_r(h); break;
-				case 0xAD: res5_r(l); break;
-				case 0xAE: resn_mem_hl(5); break;
-				case 0xAF: res5_r(a); break;
-
-				case 0xB0: res6_r(b); break;
-				case 0xB1: res6_r(c); break;
-				case 0xB2: res6_r(d); break;
-				case 0xB3: res6_r(e); break;
-				case 0xB4: res6_r(h); break;
-				case 0xB5: res6_r(l); break;
-				case 0xB6: resn_mem_hl(6); break;
-				case 0xB7: res6_r(a); break;
-
-				case 0xB8: res7_r(b); break;
-				case 0xB9: res7_r(c); break;
-				case 0xBA: res7_r(d); break;
-				case 0xBB: res7_r(e); break;
-				case 0xBC: res7_r(h); break;
-				case 0xBD: res7_r(l); break;
-				case 0xBE: resn_mem_hl(7); break;
-				case 0xBF: res7_r(a); break;
-
-				case 0xC0: set0_r(b); break;
-				case 0xC1: set0_r(c); break;
-				case 0xC2: set0_r(d); break;
-				case 0xC3: set0_r(e); break;
-				case 0xC4: set0_r(h); break;
-				case 0xC5: set0_r(l); break;
-				case 0xC6: setn_mem_hl(0); break;
-				case 0xC7: set0_r(a); break;
-
-				case 0xC8: set1_r(b); break;
-				case 0xC9: set1_r(c); break;
-				case 0xCA: set1_r(d); break;
-				case 0xCB: set1_r(e); break;
-				case 0xCC: set1_r(h); break;
-				case 0xCD: set1_r(l); break;
-				case 0xCE: setn_mem_hl(1); break;
-				case 0xCF: set1_r(a); break;
-
-				case 0xD0: set2_r(b); break;
-				case 0xD1: set2_r(c); break;
-				case 0xD2: set2_r(d); break;
-				case 0xD3: set2_r(e); break;
-				case 0xD4: set2_r(h); break;
-				case 0xD5: set2_r(l); break;
-				case 0xD6: setn_mem_hl(2); break;
-				case 0xD7: set2_r(a); break;
-
-				case 0xD8: set3_r(b); break;
-				case 0xD9: set3_r(c); break;
-				case 0xDA: set3_r(d); break;
-				case 0xDB: set3_r(e); break;
-				case 0xDC: set3_r(h); break;
-				case 0xDD: set3_r(l); break;
-				case 0xDE: setn_mem_hl(3); break;
-				case 0xDF: set3_r(a); break;
-
-				case 0xE0: set4_r(b); break;
-				case 0xE1: set4_r(c); break;
-				case 0xE2: set4_r(d); break;
-				case 0xE3: set4_r(e); break;
-				case 0xE4: set4_r(h); break;
-				case 0xE5: set4_r(l); break;
-				case 0xE6: setn_mem_hl(4); break;
-				case 0xE7: set4_r(a); break;
-
-				case 0xE8: set5_r(b); break;
-				case 0xE9: set5_r(c); break;
-				case 0xEA: set5_r(d); break;
-				case 0xEB: set5_r(e); break;
-				case 0xEC: set5_r(h); break;
-				case 0xED: set5_r(l); break;
-				case 0xEE: setn_mem_hl(5); break;
-				case 0xEF: set5_r(a); break;
-
-				case 0xF0: set6_r(b); break;
-				case 0xF1: set6_r(c); break;
-				case 0xF2: set6_r(d); break;
-				case 0xF3: set6_r(e); break;
-				case 0xF4: set6_r(h); break;
-				case 0xF5: set6_r(l); break;
-				case 0xF6: setn_mem_hl(6); break;
-				case 0xF7: set6_r(a); break;
-
-				case 0xF8: set7_r(b); break;
-				case 0xF9: set7_r(c); break;
-				case 0xFA: set7_r(d); break;
-				case 0xFB: set7_r(e); break;
-				case 0xFC: set7_r(h); break;
-				case 0xFD: set7_r(l); break;
-				case 0xFE: setn_mem_hl(7); break;
-				case 0xFF: set7_r(a); break;
+					NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x3F): srl_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x40): bit0_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x41): bit0_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x42): bit0_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x43): bit0_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x44): bit0_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x45): bit0_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x46): { unsigned data; READ(data, hl()); bit0_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x47): bit0_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x48): bit1_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x49): bit1_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x4A): bit1_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x4B): bit1_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x4C): bit1_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x4D): bit1_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x4E): { unsigned data; READ(data, hl()); bit1_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x4F): bit1_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x50): bit2_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x51): bit2_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x52): bit2_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x53): bit2_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x54): bit2_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x55): bit2_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x56): { unsigned data; READ(data, hl()); bit2_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x57): bit2_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x58): bit3_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x59): bit3_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x5A): bit3_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x5B): bit3_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x5C): bit3_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x5D): bit3_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x5E): { unsigned data; READ(data, hl()); bit3_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x5F): bit3_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x60): bit4_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x61): bit4_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x62): bit4_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x63): bit4_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x64): bit4_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x65): bit4_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x66): { unsigned data; READ(data, hl()); bit4_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x67): bit4_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x68): bit5_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x69): bit5_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x6A): bit5_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x6B): bit5_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x6C): bit5_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x6D): bit5_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x6E): { unsigned data; READ(data, hl()); bit5_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x6F): bit5_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x70): bit6_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x71): bit6_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x72): bit6_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x73): bit6_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x74): bit6_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x75): bit6_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x76): { unsigned data; READ(data, hl()); bit6_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x77): bit6_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x78): bit7_u8(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x79): bit7_u8(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x7A): bit7_u8(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x7B): bit7_u8(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x7C): bit7_u8(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x7D): bit7_u8(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x7E): { unsigned data; READ(data, hl()); bit7_u8(data); } NEXT_CB_OPCODE;
+				CB_OPCODE(0x7F): bit7_u8(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x80): res0_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x81): res0_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x82): res0_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x83): res0_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x84): res0_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x85): res0_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x86): resn_mem_hl(0); NEXT_CB_OPCODE;
+				CB_OPCODE(0x87): res0_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x88): res1_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x89): res1_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x8A): res1_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x8B): res1_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x8C): res1_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x8D): res1_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x8E): resn_mem_hl(1); NEXT_CB_OPCODE;
+				CB_OPCODE(0x8F): res1_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x90): res2_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x91): res2_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x92): res2_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x93): res2_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x94): res2_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x95): res2_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x96): resn_mem_hl(2); NEXT_CB_OPCODE;
+				CB_OPCODE(0x97): res2_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0x98): res3_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0x99): res3_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0x9A): res3_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0x9B): res3_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0x9C): res3_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0x9D): res3_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0x9E): resn_mem_hl(3); NEXT_CB_OPCODE;
+				CB_OPCODE(0x9F): res3_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xA0): res4_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA1): res4_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA2): res4_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA3): res4_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA4): res4_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA5): res4_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA6): resn_mem_hl(4); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA7): res4_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xA8): res5_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xA9): res5_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xAA): res5_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xAB): res5_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xAC): res5_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xAD): res5_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xAE): resn_mem_hl(5); NEXT_CB_OPCODE;
+				CB_OPCODE(0xAF): res5_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xB0): res6_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB1): res6_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB2): res6_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB3): res6_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB4): res6_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB5): res6_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB6): resn_mem_hl(6); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB7): res6_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xB8): res7_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xB9): res7_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xBA): res7_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xBB): res7_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xBC): res7_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xBD): res7_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xBE): resn_mem_hl(7); NEXT_CB_OPCODE;
+				CB_OPCODE(0xBF): res7_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xC0): set0_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC1): set0_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC2): set0_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC3): set0_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC4): set0_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC5): set0_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC6): setn_mem_hl(0); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC7): set0_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xC8): set1_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xC9): set1_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xCA): set1_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xCB): set1_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xCC): set1_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xCD): set1_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xCE): setn_mem_hl(1); NEXT_CB_OPCODE;
+				CB_OPCODE(0xCF): set1_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xD0): set2_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD1): set2_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD2): set2_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD3): set2_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD4): set2_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD5): set2_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD6): setn_mem_hl(2); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD7): set2_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xD8): set3_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xD9): set3_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xDA): set3_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xDB): set3_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xDC): set3_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xDD): set3_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xDE): setn_mem_hl(3); NEXT_CB_OPCODE;
+				CB_OPCODE(0xDF): set3_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xE0): set4_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE1): set4_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE2): set4_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE3): set4_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE4): set4_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE5): set4_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE6): setn_mem_hl(4); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE7): set4_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xE8): set5_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xE9): set5_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xEA): set5_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xEB): set5_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xEC): set5_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xED): set5_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xEE): setn_mem_hl(5); NEXT_CB_OPCODE;
+				CB_OPCODE(0xEF): set5_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xF0): set6_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF1): set6_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF2): set6_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF3): set6_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF4): set6_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF5): set6_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF6): setn_mem_hl(6); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF7): set6_r(a); NEXT_CB_OPCODE;
+
+				CB_OPCODE(0xF8): set7_r(b); NEXT_CB_OPCODE;
+				CB_OPCODE(0xF9): set7_r(c); NEXT_CB_OPCODE;
+				CB_OPCODE(0xFA): set7_r(d); NEXT_CB_OPCODE;
+				CB_OPCODE(0xFB): set7_r(e); NEXT_CB_OPCODE;
+				CB_OPCODE(0xFC): set7_r(h); NEXT_CB_OPCODE;
+				CB_OPCODE(0xFD): set7_r(l); NEXT_CB_OPCODE;
+				CB_OPCODE(0xFE): setn_mem_hl(7); NEXT_CB_OPCODE;
+				CB_OPCODE(0xFF): set7_r(a); NEXT_CB_OPCODE;
 				}
 
-				break;
+				NEXT_OPCODE;
 
 
 				// call z,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if ZF is set:
-			case 0xCC:
+			OPCODE(0xCC):
 				if (zf & 0xFF) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1638,42 +1867,42 @@ void CPU::process(unsigned long const cycles) {
 					call_nn();
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xCD:
+			OPCODE(0xCD):
 				call_nn();
-				break;
+				NEXT_OPCODE;
 
-			case 0xCE:
+			OPCODE(0xCE):
 				{
 					unsigned data;
 					PC_READ(data);
 					adc_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xCF:
+			OPCODE(0xCF):
 				rst_n(0x08);
-				break;
+				NEXT_OPCODE;
 
 				// ret nc (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if CF is unset:
-			case 0xD0:
+			OPCODE(0xD0):
 				cycleCounter += 4;
 
 				if (!(cf & 0x100))
 					ret();
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xD1:
+			OPCODE(0xD1):
 				pop_rr(d, e);
-				break;
+				NEXT_OPCODE;
 
 				// jp nc,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if CF is unset:
-			case 0xD2:
+			OPCODE(0xD2):
 				if (cf & 0x100) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1681,15 +1910,15 @@ void CPU::process(unsigned long const cycles) {
 					jp_nn();
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xD3: // not specified. should freeze.
-				break;
+			OPCODE(0xD3): // not specified. should freeze.
+				NEXT_OPCODE;
 
 				// call nc,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if CF is unset:
-			case 0xD4:
+			OPCODE(0xD4):
 				if (cf & 0x100) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1697,38 +1926,38 @@ void CPU::process(unsigned long const cycles) {
 					call_nn();
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xD5:
+			OPCODE(0xD5):
 				push_rr(d, e);
-				break;
+				NEXT_OPCODE;
 
-			case 0xD6:
+			OPCODE(0xD6):
 				{
 					unsigned data;
 					PC_READ(data);
 					sub_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xD7:
+			OPCODE(0xD7):
 				rst_n(0x10);
-				break;
+				NEXT_OPCODE;
 
 				// ret c (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if CF is set:
-			case 0xD8:
+			OPCODE(0xD8):
 				cycleCounter += 4;
 
 				if (cf & 0x100)
 					ret();
 
-				break;
+				NEXT_OPCODE;
 
 				// reti (16 cycles):
 				// Pop two bytes from the stack and jump to that address, then enable interrupts:
-			case 0xD9:
+			OPCODE(0xD9):
 				{
 					unsigned sl, sh;
 					pop_rr(sh, sl);
@@ -1736,11 +1965,11 @@ void CPU::process(unsigned long const cycles) {
 					PC_MOD(sh << 8 | sl);
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// jp c,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if CF is set:
-			case 0xDA:
+			OPCODE(0xDA):
 				if (cf & 0x100) {
 					jp_nn();
 				} else {
@@ -1748,15 +1977,15 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xDB: // not specified. should freeze.
-				break;
+			OPCODE(0xDB): // not specified. should freeze.
+				NEXT_OPCODE;
 
 				// call z,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if CF is set:
-			case 0xDC:
+			OPCODE(0xDC):
 				if (cf & 0x100) {
 					call_nn();
 				} else {
@@ -1764,81 +1993,84 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OPCODE;
+
+			OPCODE(0xDD): // not specified. should freeze.
+				NEXT_OPCODE;
 
-			case 0xDE:
+			OPCODE(0xDE):
 				{
 					unsigned data;
 					PC_READ(data);
 					sbc_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xDF:
+			OPCODE(0xDF):
 				rst_n(0x18);
-				break;
+				NEXT_OPCODE;
 
 				// ld ($FF00+n),a (12 cycles):
 				// Put value in A into address (0xFF00 + next byte in memory):
-			case 0xE0:
+			OPCODE(0xE0):
 				{
 					unsigned imm;
 					PC_READ(imm);
 					FF_WRITE(imm, a);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xE1:
+			OPCODE(0xE1):
 				pop_rr(h, l);
-				break;
+				NEXT_OPCODE;
 
 				// ld ($FF00+C),a (8 ycles):
 				// Put A into address (0xFF00 + register C):
-			case 0xE2:
+			OPCODE(0xE2):
 				FF_WRITE(c, a);
-				break;
+				NEXT_OPCODE;
 
-			case 0xE3: // not specified. should freeze.
-				break;
-			case 0xE4: // not specified. should freeze.
-				break;
+			OPCODE(0xE3): // not specified. should freeze.
+				NEXT_OPCODE;
+			OPCODE(0xE4): // not specified. should freeze.
+				NEXT_OPCODE;
 
-			case 0xE5:
+			OPCODE(0xE5):
 				push_rr(h, l);
-				break;
+				NEXT_OPCODE;
 
-			case 0xE6:
+			OPCODE(0xE6):
 				{
 					unsigned data;
 					PC_READ(data);
 					and_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xE7:
+			OPCODE(0xE7):
 				rst_n(0x20);
-				break;
+				NEXT_OPCODE;
 
 				// add sp,n (16 cycles):
 				// Add next (signed) byte in memory to SP, reset ZF and SF, check HCF and CF:
-			case 0xE8:
+			OPCODE(0xE8):
 				sp_plus_n(sp);
 				cycleCounter += 4;
-				break;
+				NEXT_OPCODE;
 
 				// jp hl (4 cycles):
 				// Jump to address in hl:
-			case 0xE9:
+			OPCODE(0xE9):
 				pc = hl();
-				break;
+				NEXT_OPCODE;
 
 				// ld (nn),a (16 cycles):
 				// set memory at address given by the next 2 bytes to value in A:
 				// Incrementing PC before call, because of possible interrupt.
-			case 0xEA:
+			OPCODE(0xEA):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -1846,40 +2078,40 @@ void CPU::process(unsigned long const cycles) {
 					WRITE(immh << 8 | imml, a);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xEB: // not specified. should freeze.
-				break;
-			case 0xEC: // not specified. should freeze.
-				break;
-			case 0xED: // not specified. should freeze.
-				break;
+			OPCODE(0xEB): // not specified. should freeze.
+				NEXT_OPCODE;
+			OPCODE(0xEC): // not specified. should freeze.
+				NEXT_OPCODE;
+			OPCODE(0xED): // not specified. should freeze.
+				NEXT_OPCODE;
 
-			case 0xEE:
+			OPCODE(0xEE):
 				{
 					unsigned data;
 					PC_READ(data);
 					xor_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xEF:
+			OPCODE(0xEF):
 				rst_n(0x28);
-				break;
+				NEXT_OPCODE;
 
 				// ld a,($FF00+n) (12 cycles):
 				// Put value at address (0xFF00 + next byte in memory) into A:
-			case 0xF0:
+			OPCODE(0xF0):
 				{
 					unsigned imm;
 					PC_READ(imm);
 					FF_READ(a, imm);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xF1:
+			OPCODE(0xF1):
 				{
 					unsigned F;
 					pop_rr(a, F);
@@ -1888,23 +2120,23 @@ void CPU::process(unsigned long const cycles) {
 					cf  =  cfFromF(F);
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// ld a,($FF00+C) (8 cycles):
 				// Put value at address (0xFF00 + register C) into A:
-			case 0xF2:
+			OPCODE(0xF2):
 				FF_READ(a, c);
-				break;
+				NEXT_OPCODE;
 
 				// di (4 cycles):
-			case 0xF3:
+			OPCODE(0xF3):
 				mem_.di();
-				break;
+				NEXT_OPCODE;
 
-			case 0xF4: // not specified. should freeze.
-				break;
+			OPCODE(0xF4): // not specified. should freeze.
+				NEXT_OPCODE;
 
-			case 0xF5:
+			OPCODE(0xF5):
 				hf2 = updateHf2FromHf1(hf1, hf2);
 
 				{
@@ -1912,24 +2144,24 @@ void CPU::process(unsigned long const cycles) {
 					push_rr(a, F);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xF6:
+			OPCODE(0xF6):
 				{
 					unsigned data;
 					PC_READ(data);
 					or_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xF7:
+			OPCODE(0xF7):
 				rst_n(0x30);
-				break;
+				NEXT_OPCODE;
 
 				// ldhl sp,n (12 cycles):
 				// Put (sp+next (signed) byte in memory) into hl (unsets ZF and SF, may enable HF and CF):
-			case 0xF8:
+			OPCODE(0xF8):
 				{
 					unsigned sum;
 					sp_plus_n(sum);
@@ -1937,18 +2169,18 @@ void CPU::process(unsigned long const cycles) {
 					h = sum >> 8;
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// ld sp,hl (8 cycles):
 				// Put value in HL into SP
-			case 0xF9:
+			OPCODE(0xF9):
 				sp = hl();
 				cycleCounter += 4;
-				break;
+				NEXT_OPCODE;
 
 				// ld a,(nn) (16 cycles):
 				// set A to value in memory at address given by the 2 next bytes.
-			case 0xFA:
+			OPCODE(0xFA):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -1957,19 +2189,19 @@ void CPU::process(unsigned long const cycles) {
 					READ(a, immh << 8 | imml);
 				}
 
-				break;
+				NEXT_OPCODE;
 
 				// ei (4 cycles):
 				// Enable Interrupts after next instruction:
-			case 0xFB:
+			OPCODE(0xFB):
 				mem_.ei(cycleCounter);
-				break;
+				NEXT_OPCODE;
 
-			case 0xFC: // not specified. should freeze.
-				break;
-			case 0xFD: // not specified. should freeze
-				break;
-			case 0xFE:
+			OPCODE(0xFC): // not specified. should freeze.
+				NEXT_OPCODE;
+			OPCODE(0xFD): // not specified. should freeze
+				NEXT_OPCODE;
+			OPCODE(0xFE):
 				{
 					unsigned data;
 					PC_READ(data);
@@ -1977,15 +2209,16 @@ void CPU::process(unsigned long const cycles) {
 					cp_a_u8(data);
 				}
 
-				break;
+				NEXT_OPCODE;
 
-			case 0xFF:
+			OPCODE(0xFF):
 				rst_n(0x38);
-				break;
+				NEXT_OPCODE;
 			}
 		}
 
 		pc_ = pc;
+		idleLoop_.pc = IdleLoop::none;
 		cycleCounter = mem_.event(cycleCounter);
 	}
 
@@ -48,6 +48,7 @@ public:
    unsigned rtcdata_size() { return mem_.rtcdata_size(); }
    void clearCheats() { mem_.clearCheats(); }
    void *vram_ptr() const { return mem_.vram_ptr(); }
+   void syncVram() { mem_.syncVram(); }
    void *rambank0_ptr() const { return mem_.rambank0_ptr(); }
    void *rambank1_ptr() const { return mem_.rambank1_ptr(); }
    void *rambank2_ptr() const { return mem_.rambank2_ptr(); }
@@ -62,6 +63,10 @@ public:
 		mem_.setVideoBuffer(videoBuf, pitch);
 	}
 
+	void setIndexBuffer(unsigned char *indexBuf, std::ptrdiff_t pitch) {
+		mem_.setIndexBuffer(indexBuf, pitch);
+	}
+
 	void setInputGetter(InputGetter *getInput) {
 		mem_.setInputGetter(getInput);
 	}
@@ -87,6 +92,8 @@ public:
 	bool loaded() const { return mem_.loaded(); }
 #endif
 	void setSoundBuffer(uint_least32_t *buf, std::size_t size) { mem_.setSoundBuffer(buf, size); }
+	void setAudioSink(AudioSink *sink) { mem_.setAudioSink(sink); }
+	void setResampledSoundBuffer(short *buf, std::size_t size) { mem_.setResampledSoundBuffer(buf, size); }
 	std::size_t fillSoundBuffer() { return mem_.fillSoundBuffer(cycleCounter_); }
 	bool isCgb() const { return mem_.isCgb(); }
 
@@ -106,7 +113,22 @@ private:
 	unsigned char a_, b, c, d, e, /*f,*/ h, l;
 	bool skip_;
 
+	// Short backward jr loop currently being watched for idle polling, see skipIdleLoop.
+	struct IdleLoop {
+		enum { max_size = 16, max_reads = 4, none = 0x10000 };
+
+		unsigned long cycle;
+		unsigned pc, rejectedPc, cycles, numReads;
+		unsigned short reads[max_reads];
+		unsigned a, hf1, hf2, zf, cf;
+
+		IdleLoop() : cycle(0), pc(none), rejectedPc(none), cycles(0), numReads(0),
+		             a(0), hf1(0), hf2(0), zf(0), cf(0) {}
+	} idleLoop_;
+
 	void process(unsigned long cycles);
+	bool decodeIdleLoop(unsigned pc, unsigned long cycleCounter);
+	unsigned long skipIdleLoop(unsigned pc, unsigned long cycleCounter, unsigned a);
 };
 
 }
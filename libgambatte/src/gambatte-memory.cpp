@@ -22,6 +22,7 @@
 #include "sound.h"
 #include "video.h"
 #include "bootloader.h"
+#include <algorithm>
 #include <cstring>
 
 namespace gambatte {
@@ -43,10 +44,13 @@ Memory::Memory(Interrupter const &interrupter) :
 , dmaDestination_(0)
 , oamDmaPos_(0xFE)
 , serialCnt_(0)
+, ioamhramDirty_(3)
 , blanklcd_(false)
+, dirtyTracking_(false)
 {
 	intreq_.setEventTime<intevent_blit>(144 * 456ul);
 	intreq_.setEventTime<intevent_end>(0);
+	setIoHandlers(false);
 }
 
 void Memory::setStatePtrs(SaveState &state) {
@@ -66,6 +70,8 @@ unsigned long Memory::saveState(SaveState &state, unsigned long cc) {
 	state.mem.divLastUpdate = divLastUpdate_;
 	state.mem.nextSerialtime = intreq_.eventTime(intevent_serial);
 	state.mem.unhaltTime = intreq_.eventTime(intevent_unhalt);
+	state.mem.blitTime = intreq_.eventTime(intevent_blit);
+	state.mem.blanklcd = blanklcd_;
 	state.mem.lastOamDmaUpdate = lastOamDmaUpdate_;
 	state.mem.dmaSource = dmaSource_;
 	state.mem.dmaDestination = dmaDestination_;
@@ -120,6 +126,8 @@ void Memory::loadState(SaveState const &state) {
 
 	cart_.setVrambank(ioamhram_[0x14F] & isCgb());
 	cart_.setOamDmaSrc(oam_dma_src_off);
+	cart_.setAllDirty();
+	ioamhramDirty_ = 3;
 	cart_.setWrambank(isCgb() && (ioamhram_[0x170] & 0x07) ? ioamhram_[0x170] & 0x07 : 1);
 
 	if (lastOamDmaUpdate_ != disabled_time) {
@@ -130,13 +138,21 @@ void Memory::loadState(SaveState const &state) {
 			lastOamDmaUpdate_ + (oamEventPos - oamDmaPos_) * 4);
 	}
 
-	intreq_.setEventTime<intevent_blit>((ioamhram_[0x140] & lcdc_en)
-	                                 ? lcd_.nextMode1IrqTime()
-	                                 : state.cpu.cycleCounter);
-	blanklcd_ = false;
+	// While the LCD is off, frames are timed from when it was turned off. States
+	// from before that was saved finish the current frame right away instead.
+	if (ioamhram_[0x140] & lcdc_en)
+		intreq_.setEventTime<intevent_blit>(lcd_.nextMode1IrqTime());
+	else if (state.mem.blitTime != disabled_time)
+		intreq_.setEventTime<intevent_blit>(state.mem.blitTime);
+	else
+		intreq_.setEventTime<intevent_blit>(state.cpu.cycleCounter);
+
+	blanklcd_ = state.mem.blanklcd;
 
 	if (!isCgb())
 		std::memset(cart_.vramdata() + 0x2000, 0, 0x2000);
+
+	lcd_.vramDataChange(0, 0x4000);
 }
 
 void Memory::setEndtime(unsigned long cc, unsigned long inc) {
@@ -294,7 +310,17 @@ unsigned long Memory::event(unsigned long cc) {
 			if (!(ioamhram_[0x140] & lcdc_en))
 				dmaLength = 0;
 
-			{
+			unsigned long const dmaEnd = cc + (static_cast<unsigned long>(length) << (1 + doubleSpeed));
+
+			if (lastOamDmaUpdate_ == disabled_time
+					&& isBulkDmaSource(dmaSrc, length)
+					&& dmaEnd < lcd_.vramIdleEnd(cc)) {
+				lcd_.vramChange(dmaEnd);
+				bulkDmaCopy(dmaSrc, dmaDest, length);
+				dmaSrc += length;
+				dmaDest += length;
+				cc = dmaEnd;
+			} else {
 				unsigned long lOamDmaUpdate = lastOamDmaUpdate_;
 				lastOamDmaUpdate_ = disabled_time;
 
@@ -475,8 +501,15 @@ void Memory::updateOamDma(unsigned long const cc) {
 			if (oamDmaPos_ == 0)
 				startOamDma(lastOamDmaUpdate_ - 1);
 
-			if (oamDmaSrc) ioamhram_[oamDmaPos_] = oamDmaSrc[oamDmaPos_];
-			else if (cart_.isHuC3()) ioamhram_[oamDmaPos_] = cart_.HuC3Read(oamDmaPos_, cc);
+			if (oamDmaSrc) {
+				// Nothing can observe OAM between catch-ups, so copy everything up to cc
+				// at once. With the CPU running from HRAM this is the whole transfer.
+				unsigned const n = std::min(cycles, 0x9Fu - oamDmaPos_);
+				std::memcpy(ioamhram_ + oamDmaPos_, oamDmaSrc + oamDmaPos_, n + 1);
+				oamDmaPos_ += n;
+				lastOamDmaUpdate_ += n * 4;
+				cycles -= n;
+			} else if (cart_.isHuC3()) ioamhram_[oamDmaPos_] = cart_.HuC3Read(oamDmaPos_, cc);
 			else ioamhram_[oamDmaPos_] = cart_.rtcRead();
 
 		} else if (oamDmaPos_ == 0xA0) {
@@ -533,70 +566,72 @@ unsigned Memory::nontrivial_ff_read(unsigned const p, unsigned long const cc) {
 	if (lastOamDmaUpdate_ != disabled_time)
 		updateOamDma(cc);
 
-	switch (p) {
-	case 0x00:
-		updateInput();
-		break;
-	case 0x01:
-	case 0x02:
-		updateSerial(cc);
-		break;
-	case 0x04:
-		{
-			unsigned long divcycles = (cc - divLastUpdate_) >> 8;
-			ioamhram_[0x104] = (ioamhram_[0x104] + divcycles) & 0xFF;
-			divLastUpdate_ += divcycles << 8;
-		}
+	return (this->*ioReadHandlers_[p])(p, cc);
+}
 
-		break;
-	case 0x05:
-		ioamhram_[0x105] = tima_.tima(cc);
-		break;
-	case 0x0F:
-		updateIrqs(cc);
-		ioamhram_[0x10F] = intreq_.ifreg();
-		break;
-	case 0x26:
-		if (ioamhram_[0x126] & 0x80) {
-			psg_.generateSamples(cc, isDoubleSpeed());
-			ioamhram_[0x126] = 0xF0 | psg_.getStatus();
-		} else
-			ioamhram_[0x126] = 0x70;
+unsigned Memory::ioRead(unsigned const p, unsigned long) {
+	return ioamhram_[p + 0x100];
+}
 
-		break;
-	case 0x30:
-	case 0x31:
-	case 0x32:
-	case 0x33:
-	case 0x34:
-	case 0x35:
-	case 0x36:
-	case 0x37:
-	case 0x38:
-	case 0x39:
-	case 0x3A:
-	case 0x3B:
-	case 0x3C:
-	case 0x3D:
-	case 0x3E:
-	case 0x3F:
+unsigned Memory::ioReadP1(unsigned const p, unsigned long) {
+	updateInput();
+	return ioamhram_[p + 0x100];
+}
+
+unsigned Memory::ioReadSerial(unsigned const p, unsigned long const cc) {
+	updateSerial(cc);
+	return ioamhram_[p + 0x100];
+}
+
+unsigned Memory::ioReadDiv(unsigned const p, unsigned long const cc) {
+	unsigned long divcycles = (cc - divLastUpdate_) >> 8;
+	ioamhram_[0x104] = (ioamhram_[0x104] + divcycles) & 0xFF;
+	divLastUpdate_ += divcycles << 8;
+	return ioamhram_[p + 0x100];
+}
+
+unsigned Memory::ioReadTima(unsigned const p, unsigned long const cc) {
+	ioamhram_[0x105] = tima_.tima(cc);
+	return ioamhram_[p + 0x100];
+}
+
+unsigned Memory::ioReadIf(unsigned const p, unsigned long const cc) {
+	updateIrqs(cc);
+	ioamhram_[0x10F] = intreq_.ifreg();
+	return ioamhram_[p + 0x100];
+}
+
+unsigned Memory::ioReadNr52(unsigned const p, unsigned long const cc) {
+	if (ioamhram_[0x126] & 0x80) {
 		psg_.generateSamples(cc, isDoubleSpeed());
-		return psg_.waveRamRead(p & 0xF);
-	case 0x41:
-		return ioamhram_[0x141] | lcd_.getStat(ioamhram_[0x145], cc);
-	case 0x44:
-		return lcd_.getLyReg(cc);
-	case 0x69:
-		return lcd_.cgbBgColorRead(ioamhram_[0x168] & 0x3F, cc);
-	case 0x6B:
-		return lcd_.cgbSpColorRead(ioamhram_[0x16A] & 0x3F, cc);
-	default:
-		break;
-	}
+		ioamhram_[0x126] = 0xF0 | psg_.getStatus();
+	} else
+		ioamhram_[0x126] = 0x70;
 
 	return ioamhram_[p + 0x100];
 }
 
+unsigned Memory::ioReadWaveRam(unsigned const p, unsigned long const cc) {
+	psg_.generateSamples(cc, isDoubleSpeed());
+	return psg_.waveRamRead(p & 0xF);
+}
+
+unsigned Memory::ioReadStat(unsigned, unsigned long const cc) {
+	return ioamhram_[0x141] | lcd_.getStat(ioamhram_[0x145], cc);
+}
+
+unsigned Memory::ioReadLy(unsigned, unsigned long const cc) {
+	return lcd_.getLyReg(cc);
+}
+
+unsigned Memory::ioReadBcpd(unsigned, unsigned long const cc) {
+	return lcd_.cgbBgColorRead(ioamhram_[0x168] & 0x3F, cc);
+}
+
+unsigned Memory::ioReadOcpd(unsigned, unsigned long const cc) {
+	return lcd_.cgbSpColorRead(ioamhram_[0x16A] & 0x3F, cc);
+}
+
 static bool isInOamDmaConflictArea(OamDmaSrc const oamDmaSrc, unsigned const p, bool const cgb) {
 	struct Area { unsigned short areaUpper, exceptAreaLower, exceptAreaWidth, pad; };
 
@@ -666,467 +701,439 @@ unsigned Memory::nontrivial_read(unsigned const p, unsigned long const cc) {
 	return ioamhram_[p - 0xFE00];
 }
 
-void Memory::nontrivial_ff_write(unsigned const p, unsigned data, unsigned long const cc) {
+unsigned long Memory::stableReadEnd(unsigned const p, unsigned long const cc) const {
 	if (lastOamDmaUpdate_ != disabled_time)
-		updateOamDma(cc);
+		return cc;
 
-	switch (p & 0xFF) {
-	case 0x00:
-		if ((data ^ ioamhram_[0x100]) & 0x30) {
-			ioamhram_[0x100] = (ioamhram_[0x100] & ~0x30u) | (data & 0x30);
-			updateInput();
-		}
+	// ROM, WRAM, HRAM and IE only change through writes. JOYP only changes with the input
+	// state, which is fixed for the duration of a runFor call, and IF only changes on
+	// interrupt events.
+	if (p < 0x8000 || p - 0xC000u < 0x3E00 || p >= 0xFF80)
+		return disabled_time;
 
-		return;
-	case 0x01:
-		updateSerial(cc);
-		break;
-	case 0x02:
-		updateSerial(cc);
-		serialCnt_ = 8;
+	switch (p) {
+	case 0xFF00:
+	case 0xFF0F:
+		return disabled_time;
+	case 0xFF41:
+		return lcd_.statChangeTime(cc);
+	case 0xFF44:
+		return lcd_.lyRegChangeTime(cc);
+	}
 
-#ifdef HAVE_NETWORK
-		if ((data & 0x81) == 0x81)
-      {
-			unsigned char receivedByte = 0xFF;
-			if (serial_io_ != 0)
-				receivedByte = serial_io_->send(ioamhram_[0x101], (data & isCgb() * 2));
-			startSerialTransfer(cc, receivedByte, (data & isCgb() * 2));
-      }
-#else
-		if ((data & 0x81) == 0x81)
-      {
-         intreq_.setEventTime<intevent_serial>((data & isCgb() * 2)
-               ? (cc & ~0x07ul) + 0x010 * 8
-               : (cc & ~0xFFul) + 0x200 * 8);
-      }
-      else
-         intreq_.setEventTime<intevent_serial>(disabled_time);
-#endif
+	return cc;
+}
 
-		data |= 0x7E - isCgb() * 2;
-		break;
-	case 0x04:
-		ioamhram_[0x104] = 0;
-		divLastUpdate_ = cc;
-		return;
-	case 0x05:
-		tima_.setTima(data, cc, TimaInterruptRequester(intreq_));
-		break;
-	case 0x06:
-		tima_.setTma(data, cc, TimaInterruptRequester(intreq_));
-		break;
-	case 0x07:
-		data |= 0xF8;
-		tima_.setTac(data, cc, TimaInterruptRequester(intreq_));
-		break;
-	case 0x0F:
-		updateIrqs(cc);
-		intreq_.setIfreg(0xE0 | data);
-		return;
-	case 0x10:
-		if (!psg_.isEnabled())
-			return;
+// GDMA/HDMA sources that can be copied without going through read(): ROM or WRAM
+// areas that are mapped directly.
+bool Memory::isBulkDmaSource(unsigned const src, unsigned const length) const {
+	unsigned const end = src + length;
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr10(data);
-		data |= 0x80;
-		break;
-	case 0x11:
-		if (!psg_.isEnabled()) {
-			if (isCgb())
-				return;
+	if (end > 0x8000 && (src < 0xC000 || end > 0xE000))
+		return false;
 
-			data &= 0x3F;
-		}
+	for (unsigned area = src >> 12; area <= (end - 1) >> 12; ++area) {
+		if (!cart_.rmem(area))
+			return false;
+	}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr11(data);
-		data |= 0x3F;
-		break;
-	case 0x12:
-		if (!psg_.isEnabled())
-			return;
+	return true;
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr12(data);
-		break;
-	case 0x13:
-		if (!psg_.isEnabled())
-			return;
+void Memory::bulkDmaCopy(unsigned src, unsigned dest, unsigned length) {
+	while (length) {
+		unsigned const n = std::min(length,
+			std::min(0x1000 - (src & 0xFFF), 0x2000 - (dest & 0x1FFF)));
+		std::memcpy(cart_.vrambankptr() + (0x8000 | (dest & 0x1FFF)),
+		            cart_.rmem(src >> 12) + src, n);
+		if (dirtyTracking_)
+			cart_.setDirty(cart_.vrambankptr() + (0x8000 | (dest & 0x1FFF)), n);
+		lcd_.vramDataChange(cart_.vrambankptr() + (0x8000 | (dest & 0x1FFF)) - cart_.vramdata(), n);
+		src += n;
+		dest += n;
+		length -= n;
+	}
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr13(data);
-		return;
-	case 0x14:
-		if (!psg_.isEnabled())
-			return;
+void Memory::nontrivial_ff_write(unsigned const p, unsigned const data, unsigned long const cc) {
+	if (lastOamDmaUpdate_ != disabled_time)
+		updateOamDma(cc);
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr14(data);
-		data |= 0xBF;
-		break;
-	case 0x16:
-		if (!psg_.isEnabled()) {
-			if (isCgb())
-				return;
+	if (p < 0x80) {
+		(this->*ioWriteHandlers_[p])(p, data, cc);
+	} else {
+		intreq_.setIereg(data);
+		ioamhram_[0x1FF] = data;
+	}
+}
 
-			data &= 0x3F;
-		}
+void Memory::ioWriteIgnore(unsigned, unsigned, unsigned long) {
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr21(data);
-		data |= 0x3F;
-		break;
-	case 0x17:
-		if (!psg_.isEnabled())
-			return;
+template<unsigned orMask>
+void Memory::ioWrite(unsigned const p, unsigned const data, unsigned long) {
+	ioamhram_[p + 0x100] = data | orMask;
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr22(data);
-		break;
-	case 0x18:
-		if (!psg_.isEnabled())
-			return;
+void Memory::ioWriteP1(unsigned, unsigned const data, unsigned long) {
+	if ((data ^ ioamhram_[0x100]) & 0x30) {
+		ioamhram_[0x100] = (ioamhram_[0x100] & ~0x30u) | (data & 0x30);
+		updateInput();
+	}
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr23(data);
-		return;
-	case 0x19:
-		if (!psg_.isEnabled())
-			return;
+void Memory::ioWriteSb(unsigned, unsigned const data, unsigned long const cc) {
+	updateSerial(cc);
+	ioamhram_[0x101] = data;
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr24(data);
-		data |= 0xBF;
-		break;
-	case 0x1A:
-		if (!psg_.isEnabled())
-			return;
+template<bool cgb>
+void Memory::ioWriteSc(unsigned, unsigned const data, unsigned long const cc) {
+	updateSerial(cc);
+	serialCnt_ = 8;
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr30(data);
-		data |= 0x7F;
-		break;
-	case 0x1B:
-		if (!psg_.isEnabled() && isCgb())
-			return;
+#ifdef HAVE_NETWORK
+	if ((data & 0x81) == 0x81) {
+		unsigned char receivedByte = 0xFF;
+		if (serial_io_ != 0)
+			receivedByte = serial_io_->send(ioamhram_[0x101], (data & cgb * 2));
+		startSerialTransfer(cc, receivedByte, (data & cgb * 2));
+	}
+#else
+	if ((data & 0x81) == 0x81) {
+		intreq_.setEventTime<intevent_serial>((data & cgb * 2)
+			? (cc & ~0x07ul) + 0x010 * 8
+			: (cc & ~0xFFul) + 0x200 * 8);
+	} else
+		intreq_.setEventTime<intevent_serial>(disabled_time);
+#endif
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr31(data);
-		return;
-	case 0x1C:
-		if (!psg_.isEnabled())
-			return;
+	ioamhram_[0x102] = data | (0x7E - cgb * 2);
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr32(data);
-		data |= 0x9F;
-		break;
-	case 0x1D:
-		if (!psg_.isEnabled())
-			return;
+void Memory::ioWriteDiv(unsigned, unsigned, unsigned long const cc) {
+	ioamhram_[0x104] = 0;
+	divLastUpdate_ = cc;
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr33(data);
-		return;
-	case 0x1E:
-		if (!psg_.isEnabled())
-			return;
+void Memory::ioWriteTima(unsigned, unsigned const data, unsigned long const cc) {
+	tima_.setTima(data, cc, TimaInterruptRequester(intreq_));
+	ioamhram_[0x105] = data;
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr34(data);
-		data |= 0xBF;
-		break;
-	case 0x20:
-		if (!psg_.isEnabled() && isCgb())
-			return;
+void Memory::ioWriteTma(unsigned, unsigned const data, unsigned long const cc) {
+	tima_.setTma(data, cc, TimaInterruptRequester(intreq_));
+	ioamhram_[0x106] = data;
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr41(data);
+void Memory::ioWriteTac(unsigned, unsigned const data, unsigned long const cc) {
+	tima_.setTac(data | 0xF8, cc, TimaInterruptRequester(intreq_));
+	ioamhram_[0x107] = data | 0xF8;
+}
+
+void Memory::ioWriteIf(unsigned, unsigned const data, unsigned long const cc) {
+	updateIrqs(cc);
+	intreq_.setIfreg(0xE0 | data);
+}
+
+// Sound registers other than NR52 ignore writes while the APU is off. Write-only
+// registers are not stored in ioamhram_, the others read back with orMask set.
+template<void (PSG::*setNr)(unsigned), bool readable, unsigned orMask>
+void Memory::ioWriteSound(unsigned const p, unsigned const data, unsigned long const cc) {
+	if (!psg_.isEnabled())
 		return;
-	case 0x21:
-		if (!psg_.isEnabled())
-			return;
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr42(data);
-		break;
-	case 0x22:
-		if (!psg_.isEnabled())
-			return;
+	psg_.generateSamples(cc, isDoubleSpeed());
+	(psg_.*setNr)(data);
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr43(data);
-		break;
-	case 0x23:
-		if (!psg_.isEnabled())
-			return;
+	if (readable)
+		ioamhram_[p + 0x100] = data | orMask;
+}
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setNr44(data);
-		data |= 0xBF;
-		break;
-	case 0x24:
-		if (!psg_.isEnabled())
-			return;
+// On DMG the length registers stay writable while the APU is off, with the NR11/NR21
+// duty bits cleared through offMask.
+template<void (PSG::*setNr)(unsigned), bool readable, unsigned orMask, unsigned offMask>
+void Memory::ioWriteDmgSoundLength(unsigned const p, unsigned data, unsigned long const cc) {
+	if (!psg_.isEnabled())
+		data &= offMask;
 
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.setSoVolume(data);
-		break;
-	case 0x25:
-		if (!psg_.isEnabled())
-			return;
+	psg_.generateSamples(cc, isDoubleSpeed());
+	(psg_.*setNr)(data);
+
+	if (readable)
+		ioamhram_[p + 0x100] = data | orMask;
+}
 
+void Memory::ioWriteNr52(unsigned, unsigned const data, unsigned long const cc) {
+	if ((ioamhram_[0x126] ^ data) & 0x80) {
 		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.mapSo(data);
-		break;
-	case 0x26:
-		if ((ioamhram_[0x126] ^ data) & 0x80) {
-			psg_.generateSamples(cc, isDoubleSpeed());
 
-			if (!(data & 0x80)) {
-				for (unsigned i = 0x10; i < 0x26; ++i)
-					ff_write(i, 0, cc);
+		if (!(data & 0x80)) {
+			for (unsigned i = 0x10; i < 0x26; ++i)
+				ff_write(i, 0, cc);
 
-				psg_.setEnabled(false);
-			} else {
-				psg_.reset();
-				psg_.setEnabled(true);
-			}
+			psg_.setEnabled(false);
+		} else {
+			psg_.reset();
+			psg_.setEnabled(true);
 		}
+	}
 
-		data = (data & 0x80) | (ioamhram_[0x126] & 0x7F);
-		break;
-	case 0x30:
-	case 0x31:
-	case 0x32:
-	case 0x33:
-	case 0x34:
-	case 0x35:
-	case 0x36:
-	case 0x37:
-	case 0x38:
-	case 0x39:
-	case 0x3A:
-	case 0x3B:
-	case 0x3C:
-	case 0x3D:
-	case 0x3E:
-	case 0x3F:
-		psg_.generateSamples(cc, isDoubleSpeed());
-		psg_.waveRamWrite(p & 0xF, data);
-		break;
-	case 0x40:
-		if (ioamhram_[0x140] != data)
+	ioamhram_[0x126] = (data & 0x80) | (ioamhram_[0x126] & 0x7F);
+}
+
+void Memory::ioWriteWaveRam(unsigned const p, unsigned const data, unsigned long const cc) {
+	psg_.generateSamples(cc, isDoubleSpeed());
+	psg_.waveRamWrite(p & 0xF, data);
+	ioamhram_[p + 0x100] = data;
+}
+
+void Memory::ioWriteLcdc(unsigned, unsigned const data, unsigned long const cc) {
+	if (ioamhram_[0x140] != data)
+   {
+      unsigned is_doublespeed = (unsigned)isDoubleSpeed();
+		if ((ioamhram_[0x140] ^ data) & lcdc_en)
       {
-         unsigned is_doublespeed = (unsigned)isDoubleSpeed();
-			if ((ioamhram_[0x140] ^ data) & lcdc_en)
+			unsigned const lyc = lcd_.getStat(ioamhram_[0x145], cc)
+			                     & lcdstat_lycflag;
+			bool const hdmaEnabled = lcd_.hdmaIsEnabled();
+
+			lcd_.lcdcChange(data, cc);
+			ioamhram_[0x144] = 0;
+			ioamhram_[0x141] &= 0xF8;
+
+			if (data & lcdc_en)
          {
-				unsigned const lyc = lcd_.getStat(ioamhram_[0x145], cc)
-				                     & lcdstat_lycflag;
-				bool const hdmaEnabled = lcd_.hdmaIsEnabled();
-
-				lcd_.lcdcChange(data, cc);
-				ioamhram_[0x144] = 0;
-				ioamhram_[0x141] &= 0xF8;
-
-				if (data & lcdc_en)
-            {
-					intreq_.setEventTime<intevent_blit>(blanklcd_
-						? lcd_.nextMode1IrqTime()
-						: lcd_.nextMode1IrqTime()
-						  + (70224 << is_doublespeed));
-				}
-            else
-            {
-					ioamhram_[0x141]        |= lyc;
-					intreq_.setEventTime<intevent_blit>(
-						cc + (456 * 4 << is_doublespeed));
-
-					if (hdmaEnabled)
-						flagHdmaReq(intreq_);
-				}
+				intreq_.setEventTime<intevent_blit>(blanklcd_
+					? lcd_.nextMode1IrqTime()
+					: lcd_.nextMode1IrqTime()
+					  + (70224 << is_doublespeed));
 			}
          else
-				lcd_.lcdcChange(data, cc);
+         {
+				ioamhram_[0x141]        |= lyc;
+				intreq_.setEventTime<intevent_blit>(
+					cc + (456 * 4 << is_doublespeed));
 
-			ioamhram_[0x140] = data;
+				if (hdmaEnabled)
+					flagHdmaReq(intreq_);
+			}
 		}
-		return;
-	case 0x41:
-		lcd_.lcdstatChange(data, cc);
-		data = (ioamhram_[0x141] & 0x87) | (data & 0x78);
-		break;
-	case 0x42:
-		lcd_.scyChange(data, cc);
-		break;
-	case 0x43:
-		lcd_.scxChange(data, cc);
-		break;
-	case 0x45:
-		lcd_.lycRegChange(data, cc);
-		break;
-	case 0x46:
-		if (lastOamDmaUpdate_ != disabled_time)
-			endOamDma(cc);
+      else
+			lcd_.lcdcChange(data, cc);
 
-		lastOamDmaUpdate_ = cc;
-		intreq_.setEventTime<intevent_oam>(cc + 8);
-		ioamhram_[0x146] = data;
-		oamDmaInitSetup();
-		return;
-	case 0x47:
-         
-		if (!isCgb() || (ioamhram_[0x14C] == 0x04))//allow in gbc gb mode
-			lcd_.dmgBgPaletteChange(data, cc);
+		ioamhram_[0x140] = data;
+	}
+}
 
-		break;
-	case 0x48:
-         
-		if (!isCgb() || (ioamhram_[0x14C] == 0x04))//allow in gbc gb mode
-			lcd_.dmgSpPalette1Change(data, cc);
-         
-		break;
-	case 0x49:
-         
-		if (!isCgb() || (ioamhram_[0x14C] == 0x04))//allow in gbc gb mode
-			lcd_.dmgSpPalette2Change(data, cc);
-         
-		break;
-	case 0x4A:
-		lcd_.wyChange(data, cc);
-		break;
-	case 0x4B:
-		lcd_.wxChange(data, cc);
-		break;
-   case 0x4C://switch to classic gb mode from gbc mode or lock system to gbc mode
-      if ((ioamhram_[0x14C] != 0x04)/*gb mode*/ && (ioamhram_[0x14C] != 0x80)/*gbc mode*/) {
-         //mode has not been set yet, set the mode if data is valid
-         if (data == 0x04) {
-            ioamhram_[0x14C] = 0x04;//0x04 is gbc gb mode, lock register and switch mode to gb emulation mode
-            lcd_.swapToDMG();
-         }
-         else if (data == 0x80)
-            ioamhram_[0x14C] = 0x80;//0x80 is gbc mode, no special operations needed, just lock this register
-         
-         //any other write to this register is invalid and will just be ignored
+void Memory::ioWriteStat(unsigned, unsigned const data, unsigned long const cc) {
+	lcd_.lcdstatChange(data, cc);
+	ioamhram_[0x141] = (ioamhram_[0x141] & 0x87) | (data & 0x78);
+}
+
+template<void (LCD::*change)(unsigned, unsigned long)>
+void Memory::ioWriteLcd(unsigned const p, unsigned const data, unsigned long const cc) {
+	(lcd_.*change)(data, cc);
+	ioamhram_[p + 0x100] = data;
+}
+
+void Memory::ioWriteDma(unsigned, unsigned const data, unsigned long const cc) {
+	if (lastOamDmaUpdate_ != disabled_time)
+		endOamDma(cc);
+
+	lastOamDmaUpdate_ = cc;
+	intreq_.setEventTime<intevent_oam>(cc + 8);
+	ioamhram_[0x146] = data;
+	ioamhramDirty_ |= 1;
+	oamDmaInitSetup();
+}
+
+// BGP/OBP0/OBP1. On CGB they only affect the output after the boot ROM has locked
+// the console into DMG compatibility mode through KEY0.
+template<void (LCD::*change)(unsigned, unsigned long), bool cgb>
+void Memory::ioWriteDmgPalette(unsigned const p, unsigned const data, unsigned long const cc) {
+	if (!cgb || ioamhram_[0x14C] == 0x04)
+		(lcd_.*change)(data, cc);
+
+	ioamhram_[p + 0x100] = data;
+}
+
+void Memory::ioWriteKey0(unsigned, unsigned const data, unsigned long) {
+   //switch to classic gb mode from gbc mode or lock system to gbc mode
+   if ((ioamhram_[0x14C] != 0x04)/*gb mode*/ && (ioamhram_[0x14C] != 0x80)/*gbc mode*/) {
+      //mode has not been set yet, set the mode if data is valid
+      if (data == 0x04) {
+         ioamhram_[0x14C] = 0x04;//0x04 is gbc gb mode, lock register and switch mode to gb emulation mode
+         lcd_.swapToDMG();
       }
-      return;
-	case 0x4D:
-		if (isCgb())
-			ioamhram_[0x14D] = (ioamhram_[0x14D] & ~1u) | (data & 1);
+      else if (data == 0x80)
+         ioamhram_[0x14C] = 0x80;//0x80 is gbc mode, no special operations needed, just lock this register
 
-		return;
-	case 0x4F:
-		if (isCgb()) {
-			cart_.setVrambank(data & 1);
-			ioamhram_[0x14F] = 0xFE | data;
-		}
+      //any other write to this register is invalid and will just be ignored
+   }
+}
 
-		return;
-   case 0x50://for bootloader, swap bootloader with rom
-      bootloader.call_FF50();
-      ioamhram_[0x150] = 0xFF;
-      return;
-	case 0x51:
-		dmaSource_ = data << 8 | (dmaSource_ & 0xFF);
-		return;
-	case 0x52:
-		dmaSource_ = (dmaSource_ & 0xFF00) | (data & 0xF0);
-		return;
-	case 0x53:
-		dmaDestination_ = data << 8 | (dmaDestination_ & 0xFF);
-		return;
-	case 0x54:
-		dmaDestination_ = (dmaDestination_ & 0xFF00) | (data & 0xF0);
-		return;
-	case 0x55:
-		if (isCgb()) {
-			ioamhram_[0x155] = data & 0x7F;
-
-			if (lcd_.hdmaIsEnabled()) {
-				if (!(data & 0x80)) {
-					ioamhram_[0x155] |= 0x80;
-					lcd_.disableHdma(cc);
-				}
-			} else {
-				if (data & 0x80) {
-					if (ioamhram_[0x140] & lcdc_en) {
-						lcd_.enableHdma(cc);
-					} else
-						flagHdmaReq(intreq_);
-				} else
-					flagGdmaReq(intreq_);
-			}
-		}
+void Memory::ioWriteKey1(unsigned, unsigned const data, unsigned long) {
+	ioamhram_[0x14D] = (ioamhram_[0x14D] & ~1u) | (data & 1);
+}
 
-		return;
-	case 0x56:
-		if (isCgb())
-			ioamhram_[0x156] = data | 0x3E;
+void Memory::ioWriteVbk(unsigned, unsigned const data, unsigned long) {
+	cart_.setVrambank(data & 1);
+	ioamhram_[0x14F] = 0xFE | data;
+}
 
-		return;
-	case 0x68:
-		if (isCgb())
-			ioamhram_[0x168] = data | 0x40;
+void Memory::ioWriteBoot(unsigned, unsigned, unsigned long) {
+   //for bootloader, swap bootloader with rom
+   bootloader.call_FF50();
+   ioamhram_[0x150] = 0xFF;
+}
 
-		return;
-	case 0x69:
-		if (isCgb()) {
-			unsigned index = ioamhram_[0x168] & 0x3F;
-			lcd_.cgbBgColorChange(index, data, cc);
-			ioamhram_[0x168] = (ioamhram_[0x168] & ~0x3F)
-			                 | ((index + (ioamhram_[0x168] >> 7)) & 0x3F);
-		}
+void Memory::ioWriteHdma1(unsigned, unsigned const data, unsigned long) {
+	dmaSource_ = data << 8 | (dmaSource_ & 0xFF);
+}
 
-		return;
-	case 0x6A:
-		if (isCgb())
-			ioamhram_[0x16A] = data | 0x40;
+void Memory::ioWriteHdma2(unsigned, unsigned const data, unsigned long) {
+	dmaSource_ = (dmaSource_ & 0xFF00) | (data & 0xF0);
+}
 
-		return;
-	case 0x6B:
-		if (isCgb()) {
-			unsigned index = ioamhram_[0x16A] & 0x3F;
-			lcd_.cgbSpColorChange(index, data, cc);
-			ioamhram_[0x16A] = (ioamhram_[0x16A] & ~0x3F)
-			                 | ((index + (ioamhram_[0x16A] >> 7)) & 0x3F);
-		}
+void Memory::ioWriteHdma3(unsigned, unsigned const data, unsigned long) {
+	dmaDestination_ = data << 8 | (dmaDestination_ & 0xFF);
+}
 
-		return;
-	case 0x6C:
-		if (isCgb())
-			ioamhram_[0x16C] = data | 0xFE;
+void Memory::ioWriteHdma4(unsigned, unsigned const data, unsigned long) {
+	dmaDestination_ = (dmaDestination_ & 0xFF00) | (data & 0xF0);
+}
 
-		return;
-	case 0x70:
-		if (isCgb()) {
-			cart_.setWrambank((data & 0x07) ? data & 0x07 : 1);
-			ioamhram_[0x170] = data | 0xF8;
+void Memory::ioWriteHdma5(unsigned, unsigned const data, unsigned long const cc) {
+	ioamhram_[0x155] = data & 0x7F;
+
+	if (lcd_.hdmaIsEnabled()) {
+		if (!(data & 0x80)) {
+			ioamhram_[0x155] |= 0x80;
+			lcd_.disableHdma(cc);
 		}
+	} else {
+		if (data & 0x80) {
+			if (ioamhram_[0x140] & lcdc_en) {
+				lcd_.enableHdma(cc);
+			} else
+				flagHdmaReq(intreq_);
+		} else
+			flagGdmaReq(intreq_);
+	}
+}
 
-		return;
-	case 0x72:
-	case 0x73:
-	case 0x74:
-		if (isCgb())
-			break;
+void Memory::ioWriteBcpd(unsigned, unsigned const data, unsigned long const cc) {
+	unsigned index = ioamhram_[0x168] & 0x3F;
+	lcd_.cgbBgColorChange(index, data, cc);
+	ioamhram_[0x168] = (ioamhram_[0x168] & ~0x3F)
+	                 | ((index + (ioamhram_[0x168] >> 7)) & 0x3F);
+}
 
-		return;
-	case 0x75:
-		if (isCgb())
-			ioamhram_[0x175] = data | 0x8F;
+void Memory::ioWriteOcpd(unsigned, unsigned const data, unsigned long const cc) {
+	unsigned index = ioamhram_[0x16A] & 0x3F;
+	lcd_.cgbSpColorChange(index, data, cc);
+	ioamhram_[0x16A] = (ioamhram_[0x16A] & ~0x3F)
+	                 | ((index + (ioamhram_[0x16A] >> 7)) & 0x3F);
+}
 
-		return;
-	case 0xFF:
-		intreq_.setIereg(data);
-		break;
-	default:
-		return;
-	}
+void Memory::ioWriteSvbk(unsigned, unsigned const data, unsigned long) {
+	cart_.setWrambank((data & 0x07) ? data & 0x07 : 1);
+	ioamhram_[0x170] = data | 0xF8;
+}
 
-	ioamhram_[p + 0x100] = data;
+// Fills the IO register handler tables for the model of the loaded ROM. Registers
+// without a handler read back ioamhram_ and ignore writes.
+void Memory::setIoHandlers(bool const cgb) {
+	std::fill(ioReadHandlers_, ioReadHandlers_ + 0x80, &Memory::ioRead);
+	ioReadHandlers_[0x00] = &Memory::ioReadP1;
+	ioReadHandlers_[0x01] = &Memory::ioReadSerial;
+	ioReadHandlers_[0x02] = &Memory::ioReadSerial;
+	ioReadHandlers_[0x04] = &Memory::ioReadDiv;
+	ioReadHandlers_[0x05] = &Memory::ioReadTima;
+	ioReadHandlers_[0x0F] = &Memory::ioReadIf;
+	ioReadHandlers_[0x26] = &Memory::ioReadNr52;
+	std::fill(ioReadHandlers_ + 0x30, ioReadHandlers_ + 0x40, &Memory::ioReadWaveRam);
+	ioReadHandlers_[0x41] = &Memory::ioReadStat;
+	ioReadHandlers_[0x44] = &Memory::ioReadLy;
+	ioReadHandlers_[0x69] = &Memory::ioReadBcpd;
+	ioReadHandlers_[0x6B] = &Memory::ioReadOcpd;
+
+	IoWriteHandler *const w = ioWriteHandlers_;
+	std::fill(w, w + 0x80, &Memory::ioWriteIgnore);
+	w[0x00] = &Memory::ioWriteP1;
+	w[0x01] = &Memory::ioWriteSb;
+	w[0x04] = &Memory::ioWriteDiv;
+	w[0x05] = &Memory::ioWriteTima;
+	w[0x06] = &Memory::ioWriteTma;
+	w[0x07] = &Memory::ioWriteTac;
+	w[0x0F] = &Memory::ioWriteIf;
+	w[0x10] = &Memory::ioWriteSound<&PSG::setNr10, true, 0x80>;
+	w[0x12] = &Memory::ioWriteSound<&PSG::setNr12, true, 0x00>;
+	w[0x13] = &Memory::ioWriteSound<&PSG::setNr13, false, 0x00>;
+	w[0x14] = &Memory::ioWriteSound<&PSG::setNr14, true, 0xBF>;
+	w[0x17] = &Memory::ioWriteSound<&PSG::setNr22, true, 0x00>;
+	w[0x18] = &Memory::ioWriteSound<&PSG::setNr23, false, 0x00>;
+	w[0x19] = &Memory::ioWriteSound<&PSG::setNr24, true, 0xBF>;
+	w[0x1A] = &Memory::ioWriteSound<&PSG::setNr30, true, 0x7F>;
+	w[0x1C] = &Memory::ioWriteSound<&PSG::setNr32, true, 0x9F>;
+	w[0x1D] = &Memory::ioWriteSound<&PSG::setNr33, false, 0x00>;
+	w[0x1E] = &Memory::ioWriteSound<&PSG::setNr34, true, 0xBF>;
+	w[0x21] = &Memory::ioWriteSound<&PSG::setNr42, true, 0x00>;
+	w[0x22] = &Memory::ioWriteSound<&PSG::setNr43, true, 0x00>;
+	w[0x23] = &Memory::ioWriteSound<&PSG::setNr44, true, 0xBF>;
+	w[0x24] = &Memory::ioWriteSound<&PSG::setSoVolume, true, 0x00>;
+	w[0x25] = &Memory::ioWriteSound<&PSG::mapSo, true, 0x00>;
+	w[0x26] = &Memory::ioWriteNr52;
+	std::fill(w + 0x30, w + 0x40, &Memory::ioWriteWaveRam);
+	w[0x40] = &Memory::ioWriteLcdc;
+	w[0x41] = &Memory::ioWriteStat;
+	w[0x42] = &Memory::ioWriteLcd<&LCD::scyChange>;
+	w[0x43] = &Memory::ioWriteLcd<&LCD::scxChange>;
+	w[0x45] = &Memory::ioWriteLcd<&LCD::lycRegChange>;
+	w[0x46] = &Memory::ioWriteDma;
+	w[0x4A] = &Memory::ioWriteLcd<&LCD::wyChange>;
+	w[0x4B] = &Memory::ioWriteLcd<&LCD::wxChange>;
+	w[0x4C] = &Memory::ioWriteKey0;
+	w[0x50] = &Memory::ioWriteBoot;
+	w[0x51] = &Memory::ioWriteHdma1;
+	w[0x52] = &Memory::ioWriteHdma2;
+	w[0x53] = &Memory::ioWriteHdma3;
+	w[0x54] = &Memory::ioWriteHdma4;
+
+	if (cgb) {
+		w[0x02] = &Memory::ioWriteSc<true>;
+		w[0x11] = &Memory::ioWriteSound<&PSG::setNr11, true, 0x3F>;
+		w[0x16] = &Memory::ioWriteSound<&PSG::setNr21, true, 0x3F>;
+		w[0x1B] = &Memory::ioWriteSound<&PSG::setNr31, false, 0x00>;
+		w[0x20] = &Memory::ioWriteSound<&PSG::setNr41, false, 0x00>;
+		w[0x47] = &Memory::ioWriteDmgPalette<&LCD::dmgBgPaletteChange, true>;
+		w[0x48] = &Memory::ioWriteDmgPalette<&LCD::dmgSpPalette1Change, true>;
+		w[0x49] = &Memory::ioWriteDmgPalette<&LCD::dmgSpPalette2Change, true>;
+		w[0x4D] = &Memory::ioWriteKey1;
+		w[0x4F] = &Memory::ioWriteVbk;
+		w[0x55] = &Memory::ioWriteHdma5;
+		w[0x56] = &Memory::ioWrite<0x3E>;
+		w[0x68] = &Memory::ioWrite<0x40>;
+		w[0x69] = &Memory::ioWriteBcpd;
+		w[0x6A] = &Memory::ioWrite<0x40>;
+		w[0x6B] = &Memory::ioWriteOcpd;
+		w[0x6C] = &Memory::ioWrite<0xFE>;
+		w[0x70] = &Memory::ioWriteSvbk;
+		w[0x72] = &Memory::ioWrite<0x00>;
+		w[0x73] = &Memory::ioWrite<0x00>;
+		w[0x74] = &Memory::ioWrite<0x00>;
+		w[0x75] = &Memory::ioWrite<0x8F>;
+	} else {
+		w[0x02] = &Memory::ioWriteSc<false>;
+		w[0x11] = &Memory::ioWriteDmgSoundLength<&PSG::setNr11, true, 0x3F, 0x3F>;
+		w[0x16] = &Memory::ioWriteDmgSoundLength<&PSG::setNr21, true, 0x3F, 0x3F>;
+		w[0x1B] = &Memory::ioWriteDmgSoundLength<&PSG::setNr31, false, 0x00, 0xFF>;
+		w[0x20] = &Memory::ioWriteDmgSoundLength<&PSG::setNr41, false, 0x00, 0xFF>;
+		w[0x47] = &Memory::ioWriteDmgPalette<&LCD::dmgBgPaletteChange, false>;
+		w[0x48] = &Memory::ioWriteDmgPalette<&LCD::dmgSpPalette1Change, false>;
+		w[0x49] = &Memory::ioWriteDmgPalette<&LCD::dmgSpPalette2Change, false>;
+	}
 }
 
 void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned long const cc) {
@@ -1146,22 +1153,31 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 			} else if (lcd_.vramAccessible(cc)) {
 				lcd_.vramChange(cc);
 				cart_.vrambankptr()[p] = data;
+				if (dirtyTracking_)
+					cart_.setDirty(cart_.vrambankptr() + p);
+				lcd_.vramDataChange(cart_.vrambankptr() + p - cart_.vramdata(), 1);
 			}
 		} else if (p < 0xC000) {
-			if (cart_.wsrambankptr())
+			if (cart_.wsrambankptr()) {
 				cart_.wsrambankptr()[p] = data;
-			else if (cart_.isHuC3())
+				if (dirtyTracking_)
+					cart_.setDirty(cart_.wsrambankptr() + p);
+			} else if (cart_.isHuC3())
 				cart_.HuC3Write(p, data);
 			else
 				cart_.rtcWrite(data);
-		} else
+		} else {
 			cart_.wramdata(p >> 12 & 1)[p & 0xFFF] = data;
+			if (dirtyTracking_)
+				cart_.setDirty(cart_.wramdata(p >> 12 & 1) + (p & 0xFFF));
+		}
 	} else if (p - 0xFF80u >= 0x7Fu) {
 		long const ffp = long(p) - 0xFF00;
 		if (ffp < 0) {
 			if (lcd_.oamWritable(cc) && oamDmaPos_ >= 0xA0 && (p < 0xFEA0 || isCgb())) {
 				lcd_.oamChange(cc);
 				ioamhram_[p - 0xFE00] = data;
+				ioamhramDirty_ |= 1;
 			}
 		} else
 			nontrivial_ff_write(ffp, data, cc);
@@ -1169,6 +1185,43 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 		ioamhram_[p - 0xFE00] = data;
 }
 
+unsigned char const * Memory::dirtyPages(GB::MemoryArea const area, std::size_t &pages) const {
+	switch (area) {
+	case GB::VRAM_AREA:
+		pages = cart_.isCgb() ? 0x40 : 0x20;
+		return cart_.dirtyPages(cart_.vramdata());
+	case GB::SRAM_AREA:
+		pages = (cart_.rambankdataend() - cart_.rambankdata()) >> 8;
+		return cart_.dirtyPages(cart_.rambankdata());
+	case GB::WRAM_AREA:
+		pages = (cart_.wramdataend() - cart_.wramdata(0)) >> 8;
+		return cart_.dirtyPages(cart_.wramdata(0));
+	case GB::OAM_HRAM_AREA:
+		pages = 2;
+		return &ioamhramDirty_;
+	}
+
+	pages = 0;
+	return 0;
+}
+
+void Memory::clearDirtyPages() {
+	cart_.clearDirty();
+	// The I/O registers share a page with HRAM and change without being written,
+	// and an OAM DMA in progress keeps writing OAM.
+	ioamhramDirty_ = 2 | (lastOamDmaUpdate_ != disabled_time);
+}
+
+void Memory::setDirtyTracking(bool const enable) {
+	// Nothing was recorded while tracking was off.
+	if (enable && !dirtyTracking_) {
+		cart_.setAllDirty();
+		ioamhramDirty_ = 3;
+	}
+
+	dirtyTracking_ = enable;
+}
+
 std::size_t Memory::fillSoundBuffer(unsigned long cc) {
 	psg_.generateSamples(cc, isDoubleSpeed());
 	return psg_.fillBuffer();
@@ -1180,6 +1233,7 @@ int Memory::loadROM(const void *romdata, unsigned int romsize, unsigned int forc
       return fail;
    psg_.init(cart_.isCgb());
    lcd_.reset(ioamhram_, cart_.vramdata(), cart_.isCgb());
+   setIoHandlers(cart_.isCgb());
    interrupter_.clearCheats();
    return 0;
 }
@@ -19,6 +19,7 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include "gambatte.h"
 #include "mem/cartridge.h"
 #include "interrupter.h"
 #include "bootloader.h"
@@ -54,6 +55,7 @@ public:
    video_pixel_t display_gbcToRgb32(const unsigned bgr15) { return lcd_.gbcToRgb32(bgr15); }
    void clearCheats() { cart_.clearCheats(); interrupter_.clearCheats(); }
    void *vram_ptr() const { return cart_.vramdata(); }
+   void syncVram() { lcd_.syncTileRows(); }
    void *rambank0_ptr() const { return cart_.wramdata(0); }
    void *rambank1_ptr() const { return cart_.wramdata(0) + 0x1000; }
    void *rambank2_ptr() const { return cart_.wramdata(0) + 0x2000; }
@@ -96,8 +98,10 @@ public:
 	}
 
 	void write(unsigned p, unsigned data, unsigned long cc) {
-		if (cart_.wmem(p >> 12)) {
-			cart_.wmem(p >> 12)[p] = data;
+		if (unsigned char *const wmem = cart_.wmem(p >> 12)) {
+			wmem[p] = data;
+			if (dirtyTracking_)
+				cart_.setDirty(wmem + p);
 		} else
 			nontrivial_write(p, data, cc);
 	}
@@ -113,6 +117,15 @@ public:
 #endif
 
 	unsigned long event(unsigned long cycleCounter);
+
+	unsigned char const * dirtyPages(GB::MemoryArea area, std::size_t &pages) const;
+	void clearDirtyPages();
+	void setDirtyTracking(bool enable);
+
+	// Returns the time until which reads of p keep returning what they return at
+	// cycleCounter, provided no memory event is processed before then, or cycleCounter
+	// if that cannot be determined. Used for skipping idle polling loops.
+	unsigned long stableReadEnd(unsigned p, unsigned long cycleCounter) const;
 	unsigned long resetCounters(unsigned long cycleCounter);
 	void setSaveDir(std::string const &dir) { cart_.setSaveDir(dir); }
 	void setInputGetter(InputGetter *getInput) { getInput_ = getInput; }
@@ -121,12 +134,29 @@ public:
 #endif
 	void setEndtime(unsigned long cc, unsigned long inc);
 	void setSoundBuffer(uint_least32_t *buf, std::size_t size) { psg_.setBuffer(buf, size); }
+	void setAudioSink(AudioSink *sink) { psg_.setSink(sink); }
+	void setResampledSoundBuffer(short *buf, std::size_t size) { psg_.setResampledBuffer(buf, size); }
+	void setSoundSampleRate(unsigned long rate) { psg_.setSampleRate(rate); }
+	unsigned long soundSampleRate() const { return psg_.sampleRate(); }
+	unsigned long nativeSoundSamplesFor(std::size_t samples) const { return psg_.nativeSamplesFor(samples); }
+	unsigned long resampledSoundSamples(unsigned long samples) const { return psg_.resampledSamples(samples); }
 	std::size_t fillSoundBuffer(unsigned long cc);
 
 	void setVideoBuffer(video_pixel_t *videoBuf, std::ptrdiff_t pitch) {
 		lcd_.setVideoBuffer(videoBuf, pitch);
 	}
 
+	void setIndexBuffer(unsigned char *indexBuf, std::ptrdiff_t pitch) {
+		lcd_.setIndexBuffer(indexBuf, pitch);
+	}
+
+	video_pixel_t const * linePalette(unsigned ly) const { return lcd_.linePalette(ly); }
+
+	void convertIndexedFrame(video_pixel_t *dst, std::ptrdiff_t dstPitch,
+			unsigned char const *src, std::ptrdiff_t srcPitch) const {
+		lcd_.convertIndexedFrame(dst, dstPitch, src, srcPitch);
+	}
+
 	void setDmgPaletteColor(int palNum, int colorNum, unsigned long rgb32) {
 		lcd_.setDmgPaletteColor(palNum, colorNum, rgb32);
 	}
@@ -141,6 +171,12 @@ public:
    int loadROM(const void *romdata, unsigned int romsize, unsigned int forceModel, const bool multicartCompat);
 
 private:
+	typedef unsigned (Memory::*IoReadHandler)(unsigned p, unsigned long cycleCounter);
+	typedef void (Memory::*IoWriteHandler)(unsigned p, unsigned data, unsigned long cycleCounter);
+
+	IoReadHandler ioReadHandlers_[0x80];
+	IoWriteHandler ioWriteHandlers_[0x80];
+
 	Cartridge cart_;
 	unsigned char ioamhram_[0x200];
 #ifdef HAVE_NETWORK
@@ -160,7 +196,9 @@ private:
 	unsigned short dmaDestination_;
 	unsigned char oamDmaPos_;
 	unsigned char serialCnt_;
+	unsigned char ioamhramDirty_;
 	bool blanklcd_;
+	bool dirtyTracking_;
 
 	void decEventCycles(IntEventId eventId, unsigned long dec);
 	void oamDmaInitSetup();
@@ -168,10 +206,62 @@ private:
 	void startOamDma(unsigned long cycleCounter);
 	void endOamDma(unsigned long cycleCounter);
 	unsigned char const * oamDmaSrcPtr() const;
+	bool isBulkDmaSource(unsigned src, unsigned length) const;
+	void bulkDmaCopy(unsigned src, unsigned dest, unsigned length);
 	unsigned nontrivial_ff_read(unsigned p, unsigned long cycleCounter);
-	unsigned nontrivial_read(unsigned p, unsigned long cycleCounter);
 	void nontrivial_ff_write(unsigned p, unsigned data, unsigned long cycleCounter);
+	unsigned nontrivial_read(unsigned p, unsigned long cycleCounter);
 	void nontrivial_write(unsigned p, unsigned data, unsigned long cycleCounter);
+	void setIoHandlers(bool cgb);
+	unsigned ioRead(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadP1(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadSerial(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadDiv(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadTima(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadIf(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadNr52(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadWaveRam(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadStat(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadLy(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadBcpd(unsigned p, unsigned long cycleCounter);
+	unsigned ioReadOcpd(unsigned p, unsigned long cycleCounter);
+	void ioWriteIgnore(unsigned p, unsigned data, unsigned long cycleCounter);
+	template<unsigned orMask>
+	void ioWrite(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteP1(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteSb(unsigned p, unsigned data, unsigned long cycleCounter);
+	template<bool cgb>
+	void ioWriteSc(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteDiv(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteTima(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteTma(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteTac(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteIf(unsigned p, unsigned data, unsigned long cycleCounter);
+	template<void (PSG::*setNr)(unsigned), bool readable, unsigned orMask>
+	void ioWriteSound(unsigned p, unsigned data, unsigned long cycleCounter);
+	template<void (PSG::*setNr)(unsigned), bool readable, unsigned orMask, unsigned offMask>
+	void ioWriteDmgSoundLength(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteNr52(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteWaveRam(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteLcdc(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteStat(unsigned p, unsigned data, unsigned long cycleCounter);
+	template<void (LCD::*change)(unsigned, unsigned long)>
+	void ioWriteLcd(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteDma(unsigned p, unsigned data, unsigned long cycleCounter);
+	template<void (LCD::*change)(unsigned, unsigned long), bool cgb>
+	void ioWriteDmgPalette(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteKey0(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteKey1(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteVbk(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteBoot(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteHdma1(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteHdma2(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteHdma3(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteHdma4(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteHdma5(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteBcpd(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteOcpd(unsigned p, unsigned data, unsigned long cycleCounter);
+	void ioWriteSvbk(unsigned p, unsigned data, unsigned long cycleCounter);
 	void updateSerial(unsigned long cc);
 	void updateTimaIrq(unsigned long cc);
 	void updateIrqs(unsigned long cc);
@@ -22,6 +22,8 @@
 #include "statesaver.h"
 #include "initstate.h"
 #include "bootloader.h"
+#include "rewinder.h"
+#include <algorithm>
 #include <sstream>
 #include <cstring>
 
@@ -30,10 +32,13 @@ struct GB::Priv {
 	CPU cpu;
 	int stateNo;
 	bool gbaCgbMode;
+	std::size_t stateSize;
+	Rewinder rewinder;
 	
-	Priv() : stateNo(1), gbaCgbMode(false) {}
+	Priv() : stateNo(1), gbaCgbMode(false), stateSize(0) {}
 
    void full_init();
+   std::size_t binaryStateSize();
 };
 	
 GB::GB() : p_(new Priv) {}
@@ -52,6 +57,45 @@ long GB::runFor(gambatte::video_pixel_t *const videoBuf, const int pitch,
 	
 	return cyclesSinceBlit < 0 ? cyclesSinceBlit : static_cast<long>(samples) - (cyclesSinceBlit >> 1);
 }
+
+long GB::runFor(gambatte::video_pixel_t *const videoBuf, const int pitch,
+      short *const soundBuf, std::size_t soundBufSize, unsigned &samples) {
+   p_->cpu.setVideoBuffer(videoBuf, pitch);
+   p_->cpu.setResampledSoundBuffer(soundBuf, soundBufSize);
+   const long cyclesSinceBlit = p_->cpu.runFor(
+         p_->cpu.mem_.nativeSoundSamplesFor(std::min<std::size_t>(samples, soundBufSize)) * 2);
+   samples = p_->cpu.fillSoundBuffer();
+
+   return cyclesSinceBlit < 0 ? cyclesSinceBlit : static_cast<long>(samples)
+         - static_cast<long>(p_->cpu.mem_.resampledSoundSamples(cyclesSinceBlit >> 1));
+}
+
+void GB::setSampleRate(unsigned rate) {
+   p_->cpu.mem_.setSoundSampleRate(rate);
+}
+
+unsigned GB::sampleRate() const {
+   return p_->cpu.mem_.soundSampleRate();
+}
+
+long GB::runForIndexed(unsigned char *const indexBuf, const int pitch,
+      gambatte::uint_least32_t *const soundBuf, std::size_t soundBufSize, unsigned &samples) {
+   p_->cpu.setIndexBuffer(indexBuf, pitch);
+   p_->cpu.setSoundBuffer(soundBuf, soundBufSize);
+   const long cyclesSinceBlit = p_->cpu.runFor(samples * 2);
+   samples = p_->cpu.fillSoundBuffer();
+
+   return cyclesSinceBlit < 0 ? cyclesSinceBlit : static_cast<long>(samples) - (cyclesSinceBlit >> 1);
+}
+
+const video_pixel_t * GB::linePalette(unsigned ly) const {
+   return p_->cpu.mem_.linePalette(ly);
+}
+
+void GB::convertIndexedFrame(video_pixel_t *videoBuf, int videoPitch,
+      const unsigned char *indexBuf, int indexPitch) const {
+   p_->cpu.mem_.convertIndexedFrame(videoBuf, videoPitch, indexBuf, indexPitch);
+}
    
 void GB::Priv::full_init() {
    SaveState state;
@@ -87,6 +131,10 @@ void GB::setInputGetter(InputGetter *getInput) {
 	p_->cpu.setInputGetter(getInput);
 }
 
+void GB::setAudioSink(AudioSink *sink) {
+	p_->cpu.setAudioSink(sink);
+}
+
 void GB::setBootloaderGetter(bool (*getter)(void* userdata, bool isgbc, uint8_t* data, uint32_t max_size)) {
    p_->cpu.mem_.bootloader.set_bootloader_getter(getter);
 }
@@ -104,12 +152,17 @@ unsigned GB::rtcdata_size() { return p_->cpu.rtcdata_size(); }
 
 int GB::load(const void *romdata, unsigned romsize, const unsigned flags) {
 	const int failed = p_->cpu.load(romdata, romsize, flags & (FORCE_DMG | FORCE_CGB), flags & MULTICART_COMPAT);
+	p_->stateSize = 0;
 	
    if (!failed) {
       p_->gbaCgbMode = flags & GBA_CGB;
       p_->full_init();
       p_->stateNo = 1;
    }
+
+   // The memory areas, and so the snapshot size, depend on the cartridge.
+   if (p_->rewinder.capacity())
+      p_->rewinder.reset(p_->rewinder.capacity(), p_->binaryStateSize());
 	
 	return failed;
 }
@@ -126,28 +179,88 @@ void GB::setDmgPaletteColor(unsigned palNum, unsigned colorNum, unsigned rgb32)
 	p_->cpu.setDmgPaletteColor(palNum, colorNum, rgb32);
 }
 
-void GB::loadState(const void *data) {
+bool GB::loadState(const void *data, size_t size) {
    SaveState state;
    p_->cpu.setStatePtrs(state);
+   // Left as is by states saved before these were added.
+   state.mem.blitTime = disabled_time;
+   state.mem.blanklcd = false;
    
-   if (StateSaver::loadState(state, data)) {
-      p_->cpu.loadState(state);
-      p_->cpu.mem_.bootloader.choosebank(state.mem.ioamhram.get()[0x150] != 0xFF);
-   }
+   if (!StateSaver::loadBinaryState(state, data, size) && !StateSaver::loadState(state, data, size))
+      return false;
+
+   p_->cpu.loadState(state);
+   p_->cpu.mem_.bootloader.choosebank(state.mem.ioamhram.get()[0x150] != 0xFF);
+   return true;
 }
 
-void GB::saveState(void *data) {
+void GB::saveState(void *data, bool fast) {
    SaveState state;
+   // Not every field is written for every cartridge type.
+   std::memset((void*)&state, 0, sizeof state);
    p_->cpu.setStatePtrs(state);
    p_->cpu.saveState(state);
-   StateSaver::saveState(state, data);
+
+   if (fast)
+      StateSaver::saveBinaryState(state, data);
+   else
+      StateSaver::saveState(state, data);
 }
 
+// The labelled format writes every field at a fixed width, so the size only depends
+// on the memory areas, which are set up by load. The field values are not needed.
 size_t GB::stateSize() const {
+   if (!p_->stateSize) {
+      SaveState state;
+      std::memset((void*)&state, 0, sizeof state);
+      p_->cpu.setStatePtrs(state);
+      p_->stateSize = StateSaver::stateSize(state);
+   }
+
+   return p_->stateSize;
+}
+
+const unsigned char * GB::dirtyPages(MemoryArea area, std::size_t &pages) const {
+   return p_->cpu.mem_.dirtyPages(area, pages);
+}
+
+void GB::clearDirtyPages() {
+   p_->cpu.mem_.clearDirtyPages();
+}
+
+void GB::setDirtyTracking(bool enable) {
+   p_->cpu.mem_.setDirtyTracking(enable);
+}
+
+std::size_t GB::Priv::binaryStateSize() {
    SaveState state;
-   p_->cpu.setStatePtrs(state);
-   p_->cpu.saveState(state);
-   return StateSaver::stateSize(state);
+   std::memset((void*)&state, 0, sizeof state);
+   cpu.setStatePtrs(state);
+   return StateSaver::binaryStateSize(state);
+}
+
+void GB::setRewindBufferSize(std::size_t size) {
+   p_->rewinder.reset(size, size ? p_->binaryStateSize() : 0);
+}
+
+std::size_t GB::rewindBufferSize() const {
+   return p_->rewinder.capacity();
+}
+
+void GB::rewindPush() {
+   if (!p_->rewinder.capacity())
+      return;
+
+   saveState(p_->rewinder.pushBuffer(), true);
+   p_->rewinder.push();
+}
+
+bool GB::rewindPop() {
+   if (const unsigned char *const data = p_->rewinder.pop()) {
+      return loadState(data, p_->binaryStateSize());
+   }
+
+   return false;
 }
 
 void GB::setColorCorrection(bool enable) {
@@ -188,6 +301,10 @@ void *GB::vram_ptr() const {
  return p_->cpu.vram_ptr();
 }
 
+void GB::syncVram() {
+ p_->cpu.syncVram();
+}
+
 void *GB::rambank0_ptr() const {
  return p_->cpu.rambank0_ptr();
 }
@@ -1202,6 +1202,7 @@ void gambatte::setInitState(SaveState &state, bool const cgb, bool const gbaCgbM
 	state.mem.nextSerialtime = disabled_time;
 	state.mem.lastOamDmaUpdate = disabled_time;
 	state.mem.unhaltTime = disabled_time;
+	state.mem.blitTime = disabled_time;
 	state.mem.minIntTime = 0;
 	state.mem.rombank = 1;
 	state.mem.dmaSource = 0;
@@ -1217,6 +1218,7 @@ void gambatte::setInitState(SaveState &state, bool const cgb, bool const gbaCgbM
 	state.mem.enableRam = false;
 	state.mem.rambankMode = false;
 	state.mem.hdmaTransfer = false;
+	state.mem.blanklcd = false;
 
 
 	for (int i = 0x00; i < 0x40; i += 0x02) {
@@ -98,6 +98,16 @@ namespace gambatte
             return memptrs_.oamDmaSrc();
          }
 
+         unsigned char * rambankdata() const { return memptrs_.rambankdata(); }
+         unsigned char * rambankdataend() const { return memptrs_.rambankdataend(); }
+         unsigned char * wramdataend() const { return memptrs_.wramdataend(); }
+
+         const unsigned char * dirtyPages(const unsigned char *area) const { return memptrs_.dirtyPages(area); }
+         void setDirty(const unsigned char *p) { memptrs_.setDirty(p); }
+         void setDirty(const unsigned char *p, std::size_t size) { memptrs_.setDirty(p, size); }
+         void setAllDirty() { memptrs_.setAllDirty(); }
+         void clearDirty() { memptrs_.clearDirty(); }
+
          void setVrambank(unsigned bank)
          {
             memptrs_.setVrambank(bank);
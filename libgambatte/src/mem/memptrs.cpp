@@ -34,6 +34,8 @@ namespace gambatte
       ,memchunk_(0)
       , rambankdata_(0)
       , wramdataend_(0)
+      , dirtyPages_(0)
+      , dirtyPagesSize_(0)
       , oamDmaSrc_(oam_dma_src_off)
    {
    }
@@ -41,6 +43,7 @@ namespace gambatte
    MemPtrs::~MemPtrs()
    {
       delete []memchunk_;
+      delete []dirtyPages_;
    }
 
    void MemPtrs::reset(const unsigned rombanks, const unsigned rambanks, const unsigned wrambanks)
@@ -58,6 +61,11 @@ namespace gambatte
       wramdata_[0]  = rambankdata_ + rambanks * 0x2000ul;
       wramdataend_ = wramdata_[0] + wrambanks * 0x1000ul;
 
+      delete []dirtyPages_;
+      dirtyPagesSize_ = (wdisabledRam() + 0x2000 - vramdata()) >> 11;
+      dirtyPages_     = new unsigned char[dirtyPagesSize_];
+      setAllDirty();
+
       std::memset(rdisabledRamw(), 0xFF, 0x2000);
 
       oamDmaSrc_    = oam_dma_src_off;
@@ -71,6 +79,28 @@ namespace gambatte
       setWrambank(1);
    }
 
+   void MemPtrs::setDirty(const unsigned char *const p, const std::size_t size)
+   {
+      if (!size)
+         return;
+
+      const std::size_t first = (p - vramdata()) >> 8;
+      const std::size_t last  = (p + size - 1 - vramdata()) >> 8;
+
+      for (std::size_t page = first; page <= last; ++page)
+         dirtyPages_[page >> 3] |= 1 << (page & 7);
+   }
+
+   void MemPtrs::setAllDirty()
+   {
+      std::memset(dirtyPages_, 0xFF, dirtyPagesSize_);
+   }
+
+   void MemPtrs::clearDirty()
+   {
+      std::memset(dirtyPages_, 0, dirtyPagesSize_);
+   }
+
    void MemPtrs::setRombank0(const unsigned bank)
    {
       romdata_[0] = romdata() + bank * 0x4000ul;
@@ -19,6 +19,8 @@
 #ifndef MEMPTRS_H
 #define MEMPTRS_H
 
+#include <cstddef>
+
 namespace gambatte
 {
 
@@ -123,6 +125,23 @@ namespace gambatte
             return oamDmaSrc_;
          }
 
+         // One bit per 256-byte page of the writable areas, in memory order from
+         // vramdata() on. Areas start on whole bytes of the bitmap.
+         const unsigned char * dirtyPages(const unsigned char *area) const
+         {
+            return dirtyPages_ + ((area - vramdata()) >> 11);
+         }
+
+         void setDirty(const unsigned char *p)
+         {
+            const std::size_t page = (p - vramdata()) >> 8;
+            dirtyPages_[page >> 3] |= 1 << (page & 7);
+         }
+
+         void setDirty(const unsigned char *p, std::size_t size);
+         void setAllDirty();
+         void clearDirty();
+
          void setRombank0(unsigned bank);
          void setRombank(unsigned bank);
          void setRambank(unsigned ramFlags, unsigned rambank);
@@ -141,6 +160,8 @@ namespace gambatte
          unsigned char *memchunk_;
          unsigned char *rambankdata_;
          unsigned char *wramdataend_;
+         unsigned char *dirtyPages_;
+         std::size_t dirtyPagesSize_;
          OamDmaSrc oamDmaSrc_;
          MemPtrs(const MemPtrs &);
          MemPtrs & operator=(const MemPtrs &);
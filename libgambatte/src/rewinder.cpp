@@ -0,0 +1,227 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+#include "rewinder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// A literal run only ends at this many unchanged bytes, so that isolated matches
+// inside changed data do not cost a token each.
+enum { min_zero_run = 4 };
+
+unsigned char * putLength(unsigned char *out, std::size_t n) {
+	while (n >= 0x80) {
+		*out++ = n | 0x80;
+		n >>= 7;
+	}
+
+	*out++ = n;
+	return out;
+}
+
+unsigned char const * getLength(unsigned char const *in, std::size_t &n) {
+	unsigned shift = 0;
+	n = 0;
+
+	do {
+		n |= static_cast<std::size_t>(*in & 0x7F) << shift;
+		shift += 7;
+	} while (*in++ & 0x80);
+
+	return in;
+}
+
+std::size_t equalRun(unsigned char const *a, unsigned char const *b, std::size_t size) {
+	std::size_t n = 0;
+
+	while (n + sizeof(unsigned long) <= size) {
+		unsigned long wa, wb;
+		std::memcpy(&wa, a + n, sizeof wa);
+		std::memcpy(&wb, b + n, sizeof wb);
+
+		if (wa != wb)
+			break;
+
+		n += sizeof(unsigned long);
+	}
+
+	while (n < size && a[n] == b[n])
+		++n;
+
+	return n;
+}
+
+// Encodes cur ^ prev as a sequence of (unchanged byte count, changed byte count,
+// changed bytes xored) tokens. The output never exceeds 2 * size + 16 bytes.
+std::size_t encodeDelta(unsigned char *const out,
+		unsigned char const *cur, unsigned char const *prev, std::size_t const size) {
+	unsigned char *dst = out;
+	std::size_t pos = 0;
+
+	while (pos < size) {
+		std::size_t const zeros = equalRun(cur + pos, prev + pos, size - pos);
+		std::size_t const litStart = pos + zeros;
+		std::size_t litEnd = litStart;
+
+		while (litEnd < size) {
+			if (cur[litEnd] != prev[litEnd]) {
+				++litEnd;
+				continue;
+			}
+
+			std::size_t const run = equalRun(cur + litEnd, prev + litEnd,
+				std::min<std::size_t>(size - litEnd, min_zero_run));
+
+			if (run == min_zero_run || litEnd + run == size)
+				break;
+
+			litEnd += run;
+		}
+
+		dst = putLength(dst, zeros);
+		dst = putLength(dst, litEnd - litStart);
+
+		for (std::size_t i = litStart; i < litEnd; ++i)
+			*dst++ = cur[i] ^ prev[i];
+
+		pos = litEnd;
+	}
+
+	return dst - out;
+}
+
+void applyDelta(unsigned char *const data, unsigned char const *in, std::size_t const size) {
+	unsigned char const *const end = in + size;
+	unsigned char *dst = data;
+
+	while (in < end) {
+		std::size_t zeros, lits;
+		in = getLength(in, zeros);
+		in = getLength(in, lits);
+		dst += zeros;
+
+		while (lits--)
+			*dst++ ^= *in++;
+	}
+}
+
+}
+
+namespace gambatte {
+
+Rewinder::Rewinder()
+: snapshotSize_(0)
+, snapshots_(0)
+, head_(0)
+, tail_(0)
+, used_(0)
+, top_(false)
+{
+}
+
+void Rewinder::reset(std::size_t const capacity, std::size_t const snapshotSize) {
+	ring_.reset(capacity);
+	snapshot_[0].reset(capacity ? snapshotSize : 0);
+	snapshot_[1].reset(capacity ? snapshotSize : 0);
+	delta_.reset(capacity ? 2 * snapshotSize + 16 : 0);
+	snapshotSize_ = capacity ? snapshotSize : 0;
+	snapshots_ = 0;
+	head_ = 0;
+	tail_ = 0;
+	used_ = 0;
+	top_ = false;
+}
+
+void Rewinder::ringWrite(void const *const data, std::size_t const size) {
+	std::size_t const first = std::min(size, ring_.size() - head_);
+	std::memcpy(ring_ + head_, data, first);
+	std::memcpy(ring_, static_cast<unsigned char const *>(data) + first, size - first);
+	head_ = (head_ + size) % ring_.size();
+	used_ += size;
+}
+
+void Rewinder::ringRead(std::size_t const pos, void *const data, std::size_t const size) const {
+	std::size_t const first = std::min(size, ring_.size() - pos);
+	std::memcpy(data, ring_ + pos, first);
+	std::memcpy(static_cast<unsigned char *>(data) + first, ring_, size - first);
+}
+
+void Rewinder::dropOldest() {
+	std::size_t len;
+	ringRead(tail_, &len, sizeof len);
+
+	std::size_t const entry = len + 2 * sizeof len;
+	tail_ = (tail_ + entry) % ring_.size();
+	used_ -= entry;
+	--snapshots_;
+}
+
+void Rewinder::push() {
+	if (!ring_.size())
+		return;
+
+	if (snapshots_) {
+		// Ring entries are the delta framed by its length on both ends, so that they
+		// can be walked from either end.
+		std::size_t const len = encodeDelta(delta_, snapshot_[!top_], snapshot_[top_], snapshotSize_);
+		std::size_t const entry = len + 2 * sizeof len;
+
+		if (entry > ring_.size()) {
+			head_ = tail_ = used_ = 0;
+			snapshots_ = 0;
+		} else {
+			while (ring_.size() - used_ < entry)
+				dropOldest();
+
+			ringWrite(&len, sizeof len);
+			ringWrite(delta_, len);
+			ringWrite(&len, sizeof len);
+		}
+	}
+
+	top_ = !top_;
+	++snapshots_;
+}
+
+unsigned char const * Rewinder::pop() {
+	if (!snapshots_)
+		return 0;
+
+	unsigned char *const newest = snapshot_[top_];
+
+	if (snapshots_ > 1) {
+		std::size_t len;
+		ringRead((head_ + ring_.size() - sizeof len) % ring_.size(), &len, sizeof len);
+
+		std::size_t const entry = len + 2 * sizeof len;
+		head_ = (head_ + ring_.size() - entry) % ring_.size();
+		used_ -= entry;
+		ringRead((head_ + sizeof len) % ring_.size(), delta_, len);
+
+		std::memcpy(snapshot_[!top_], newest, snapshotSize_);
+		applyDelta(snapshot_[!top_], delta_, len);
+	}
+
+	top_ = !top_;
+	--snapshots_;
+	return newest;
+}
+
+}
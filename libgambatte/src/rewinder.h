@@ -0,0 +1,65 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+#ifndef REWINDER_H
+#define REWINDER_H
+
+#include "gambatte-array.h"
+#include <cstddef>
+
+namespace gambatte {
+
+// History of fixed-size state snapshots kept in a fixed-size ring buffer. Only the
+// newest snapshot is stored in full. Every older one is stored as the zero-run-length
+// encoded XOR against its successor, so popping walks back from the newest end and
+// the oldest deltas can be dropped whenever the ring runs full.
+class Rewinder : Uncopyable {
+public:
+	Rewinder();
+	void reset(std::size_t capacity, std::size_t snapshotSize);
+	std::size_t capacity() const { return ring_.size(); }
+	std::size_t snapshotSize() const { return snapshotSize_; }
+	std::size_t snapshots() const { return snapshots_; }
+
+	// Where the caller writes the snapshot passed to the next push().
+	unsigned char * pushBuffer() { return snapshot_[!top_]; }
+	void push();
+
+	// Returns the newest snapshot, valid until the next push() or pop(), and drops it
+	// from the history. Returns 0 if there is none.
+	unsigned char const * pop();
+
+private:
+	Array<unsigned char> ring_;
+	Array<unsigned char> snapshot_[2];
+	Array<unsigned char> delta_;
+	std::size_t snapshotSize_;
+	std::size_t snapshots_;
+	std::size_t head_;
+	std::size_t tail_;
+	std::size_t used_;
+	bool top_;
+
+	void ringWrite(void const *data, std::size_t size);
+	void ringRead(std::size_t pos, void *data, std::size_t size) const;
+	void dropOldest();
+};
+
+}
+
+#endif
@@ -45,6 +45,8 @@ namespace gambatte
 
    PSG::PSG()
       :  buffer_(0)
+      ,  resampledBuffer_(0)
+      ,  sink_(0)
       ,  bufferSize_(0)
       ,  bufferPos_(0)
       ,  lastUpdate_(0)
@@ -96,12 +98,21 @@ namespace gambatte
 
    void PSG::accumulateChannels(const unsigned long cycles)
    {
-      uint_least32_t *const buf = buffer_ + bufferPos_;
-      std::memset(buf, 0, cycles * sizeof(uint_least32_t));
-      ch1_.update(buf, soVol_, cycles);
-      ch2_.update(buf, soVol_, cycles);
-      ch3_.update(buf, soVol_, cycles);
-      ch4_.update(buf, soVol_, cycles);
+      DeltaOut deltas(buffer_, bufferPos_);
+
+      // A sink takes the deltas as they come, so there is no buffer to clear,
+      // and rsum_ is kept current in place of fillBuffer.
+      if (resampledBuffer_)
+         deltas = DeltaOut(synth_, rsum_, bufferPos_);
+      else if (sink_)
+         deltas = DeltaOut(*sink_, rsum_, bufferPos_);
+      else
+         std::memset(buffer_ + bufferPos_, 0, cycles * sizeof(uint_least32_t));
+
+      ch1_.update(deltas, soVol_, cycles);
+      ch2_.update(deltas, soVol_, cycles);
+      ch3_.update(deltas, soVol_, cycles);
+      ch4_.update(deltas, soVol_, cycles);
    }
 
    void PSG::generateSamples(unsigned long const cycleCounter, bool const doubleSpeed)
@@ -127,6 +138,12 @@ namespace gambatte
 
    size_t PSG::fillBuffer()
    {
+      if (resampledBuffer_)
+         return synth_.read(resampledBuffer_, bufferPos_);
+
+      if (sink_)
+         return bufferPos_;
+
       uint_least32_t sum = rsum_;
       uint_least32_t *b = buffer_;
       unsigned n = bufferPos_;
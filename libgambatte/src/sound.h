@@ -26,6 +26,7 @@
 #include "sound/channel2.h"
 #include "sound/channel3.h"
 #include "sound/channel4.h"
+#include "sound/blip_synth.h"
 
 namespace gambatte {
 
@@ -41,7 +42,30 @@ public:
 	void generateSamples(unsigned long cycleCounter, bool doubleSpeed);
 	void resetCounter(unsigned long newCc, unsigned long oldCc, bool doubleSpeed);
    std::size_t fillBuffer();
-	void setBuffer(uint_least32_t *buf, std::size_t size) { buffer_ = buf; bufferSize_ = size; bufferPos_ = 0; }
+	void setBuffer(uint_least32_t *buf, std::size_t size) {
+		buffer_ = buf;
+		resampledBuffer_ = 0;
+		bufferSize_ = size;
+		bufferPos_ = 0;
+	}
+
+	// Output through synth_ at its rate instead, as up to size stereo samples.
+	// fillBuffer then returns the number of those.
+	void setResampledBuffer(short *buf, std::size_t size) {
+		buffer_ = 0;
+		resampledBuffer_ = buf;
+		bufferSize_ = synth_.maxNativeSamples(size);
+		bufferPos_ = 0;
+	}
+
+	void setSampleRate(unsigned long rate) { synth_.setRate(rate); }
+	unsigned long sampleRate() const { return synth_.rate(); }
+	unsigned long nativeSamplesFor(std::size_t samples) const { return synth_.nativeSamplesFor(samples); }
+	unsigned long resampledSamples(unsigned long samples) const { return synth_.outputSamples(samples); }
+
+	// With a sink, the channels pass their output changes to it instead of the buffer,
+	// which is then never written. Only to be changed between fillBuffer and setBuffer.
+	void setSink(AudioSink *sink) { sink_ = sink; }
 
 	bool isEnabled() const { return enabled_; }
 	void setEnabled(bool value) { enabled_ = value; }
@@ -80,6 +104,9 @@ private:
 	Channel3 ch3_;
 	Channel4 ch4_;
 	uint_least32_t *buffer_;
+	short *resampledBuffer_;
+	AudioSink *sink_;
+	BlipSynth synth_;
 	std::size_t bufferSize_;
 	std::size_t bufferPos_;
 	unsigned long lastUpdate_;
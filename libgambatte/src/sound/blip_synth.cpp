@@ -0,0 +1,125 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+#include "blip_synth.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace gambatte {
+
+// The kernels sum up to 3/8 of the output unit, which keeps the loudest output
+// of all four channels clear of clipping, and matches the level of blipper.
+enum { output_unit_log2 = 15, kernel_sum = 3 << (output_unit_log2 - 3) };
+
+BlipSynth::BlipSynth()
+: rate_(48000)
+, frac_(0)
+{
+	// The kernels do not depend on the rate, only on where between two output
+	// samples a change falls. Each is a sinc cut off at 90% of the output Nyquist
+	// frequency under a Blackman window, centred taps / 2 - 1 samples ahead,
+	// scaled to add up to exactly kernel_sum so that the steps keep to the level.
+	double const pi = 3.14159265358979323846;
+	double const cutoff = 0.9;
+
+	for (unsigned p = 0; p < 1u << phases_log2; ++p) {
+		double h[taps];
+		double sum = 0;
+
+		for (unsigned k = 0; k < taps; ++k) {
+			double const x = k + 1.0 - p / double(1 << phases_log2) - taps / 2;
+			double const w = 0.42 + 0.5 * std::cos(2 * pi * x / taps)
+			               + 0.08 * std::cos(4 * pi * x / taps);
+			double const s = x == 0 ? 1 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+			h[k] = w * s;
+			sum += h[k];
+		}
+
+		long total = 0;
+		for (unsigned k = 0; k < taps; ++k) {
+			kernel_[p][k] = static_cast<short>(std::floor(h[k] / sum * kernel_sum + 0.5));
+			total += kernel_[p][k];
+		}
+
+		kernel_[p][taps / 2 - 1] += kernel_sum - total;
+	}
+
+	clear();
+}
+
+void BlipSynth::setRate(unsigned long rate) {
+	rate_ = std::min(std::max(rate, 8000ul), 192000ul);
+	clear();
+}
+
+void BlipSynth::clear() {
+	frac_ = 0;
+	sum_[0] = sum_[1] = 0;
+	std::memset(buf_, 0, sizeof buf_);
+}
+
+unsigned long BlipSynth::nativeSamplesFor(std::size_t samples) const {
+	samples = std::min<std::size_t>(samples, max_samples);
+	return ((static_cast<unsigned long>(samples) << native_rate_log2) - frac_ + rate_ - 1) / rate_;
+}
+
+unsigned long BlipSynth::maxNativeSamples(std::size_t samples) const {
+	samples = std::min<std::size_t>(samples, max_samples);
+	return ((static_cast<unsigned long>(samples + 1) << native_rate_log2) - 1 - frac_) / rate_;
+}
+
+unsigned long BlipSynth::outputSamples(unsigned long const nativeSamples) const {
+	// split to keep the products within 32 bits
+	return ((nativeSamples >> 10) * rate_ >> (native_rate_log2 - 10))
+	     + ((nativeSamples & 0x3FF) * rate_ >> native_rate_log2);
+}
+
+void BlipSynth::delta(unsigned const time, int const left, int const right) {
+	// time is below maxNativeSamples(max_samples), which bounds pos below 2^32.
+	unsigned long const pos = frac_ + time * rate_;
+	short const *const k = kernel_[pos >> (native_rate_log2 - phases_log2) & ((1 << phases_log2) - 1)];
+	long *const b = buf_ + 2 * (pos >> native_rate_log2);
+
+	for (unsigned i = 0; i < taps; ++i) {
+		b[2 * i    ] += left  * static_cast<long>(k[i]);
+		b[2 * i + 1] += right * static_cast<long>(k[i]);
+	}
+}
+
+std::size_t BlipSynth::read(short *out, unsigned long const nativeSamples) {
+	unsigned long const end = frac_ + nativeSamples * rate_;
+	std::size_t const count = end >> native_rate_log2;
+
+	for (std::size_t i = 0; i < 2 * count; ++i) {
+		// The integrator leaks slightly, to take out the DC offset of the output.
+		long &sum = sum_[i & 1];
+		sum += buf_[i] - (sum >> 9);
+
+		long const s = (sum + (1 << (output_unit_log2 - 1))) >> output_unit_log2;
+		out[i] = static_cast<short>(std::min(std::max(s, -0x8000L), 0x7FFFL));
+	}
+
+	std::memmove(buf_, buf_ + 2 * count, 2 * taps * sizeof *buf_);
+	std::memset(buf_ + 2 * taps, 0, 2 * count * sizeof *buf_);
+	frac_ = end & ((1ul << native_rate_log2) - 1);
+
+	return count;
+}
+
+}
@@ -0,0 +1,65 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+#ifndef BLIP_SYNTH_H
+#define BLIP_SYNTH_H
+
+#include "audiosink.h"
+#include <cstddef>
+
+namespace gambatte {
+
+// Band-limited synthesis of the sound at a lower sample rate. Each change of the
+// native output adds a windowed-sinc impulse to the output, which read sums up
+// into steps. The native rate is 2^21 Hz, so output positions of native samples
+// are exact with 21 bits of fraction.
+class BlipSynth : public AudioSink {
+public:
+	enum { native_rate_log2 = 21 };
+	enum { max_samples = 1024 };
+	enum { taps = 32, phases_log2 = 6 };
+
+	BlipSynth();
+	void setRate(unsigned long rate);
+	unsigned long rate() const { return rate_; }
+	void clear();
+
+	// The fewest native samples that complete samples output samples,
+	// and the most that complete no more than samples (or max_samples).
+	unsigned long nativeSamplesFor(std::size_t samples) const;
+	unsigned long maxNativeSamples(std::size_t samples) const;
+	// Output samples corresponding to nativeSamples, rounded down.
+	unsigned long outputSamples(unsigned long nativeSamples) const;
+
+	virtual void delta(unsigned time, int left, int right);
+
+	// Ends the period of the deltas so far after nativeSamples, writes the output samples
+	// it completes to out as interleaved stereo and returns their number.
+	std::size_t read(short *out, unsigned long nativeSamples);
+
+private:
+	unsigned long rate_;
+	unsigned long frac_;
+	long sum_[2];
+	long buf_[2 * (max_samples + taps)];
+	short kernel_[1 << phases_log2][taps];
+};
+
+}
+
+#endif
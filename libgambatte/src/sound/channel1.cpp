@@ -22,7 +22,7 @@
 
 namespace gambatte {
 
-Channel1::SweepUnit::SweepUnit(MasterDisabler &disabler, DutyUnit &dutyUnit)
+Channel1::SweepUnit::SweepUnit(DutyMasterDisabler &disabler, DutyUnit &dutyUnit)
 : disableMaster_(disabler)
 , dutyUnit_(dutyUnit)
 , shadow_(0)
@@ -108,10 +108,9 @@ void Channel1::SweepUnit::loadState(SaveState const &state) {
 Channel1::Channel1()
 : staticOutputTest_(*this, dutyUnit_)
 , disableMaster_(master_, dutyUnit_)
-, lengthCounter_(disableMaster_, 0x3F)
-, envelopeUnit_(staticOutputTest_)
+, lengthCounter_(0x3F)
 , sweepUnit_(disableMaster_, dutyUnit_)
-, nextEventUnit_(0)
+, nextEventUnit_(unit_sweep)
 , cycleCounter_(0)
 , soMask_(0)
 , prevOut_(0)
@@ -121,12 +120,41 @@ Channel1::Channel1()
 	setEvent();
 }
 
+inline unsigned long Channel1::nextEventCounter() const {
+	switch (nextEventUnit_) {
+	case unit_sweep: return sweepUnit_.counter();
+	case unit_envelope: return envelopeUnit_.counter();
+	}
+
+	return lengthCounter_.counter();
+}
+
+void Channel1::nextEvent() {
+	switch (nextEventUnit_) {
+	case unit_sweep:
+		sweepUnit_.event();
+		break;
+	case unit_envelope:
+		{
+			unsigned long const cc = envelopeUnit_.counter();
+			if (envelopeUnit_.event())
+				staticOutputTest_(cc);
+		}
+
+		break;
+	default:
+		lengthCounter_.event();
+		disableMaster_();
+		break;
+	}
+}
+
 void Channel1::setEvent() {
-	nextEventUnit_ = &sweepUnit_;
-	if (envelopeUnit_.counter() < nextEventUnit_->counter())
-		nextEventUnit_ = &envelopeUnit_;
-	if (lengthCounter_.counter() < nextEventUnit_->counter())
-		nextEventUnit_ = &lengthCounter_;
+	nextEventUnit_ = unit_sweep;
+	if (envelopeUnit_.counter() < nextEventCounter())
+		nextEventUnit_ = unit_envelope;
+	if (lengthCounter_.counter() < nextEventCounter())
+		nextEventUnit_ = unit_length;
 }
 
 void Channel1::setNr0(unsigned data) {
@@ -155,7 +183,9 @@ void Channel1::setNr3(unsigned data) {
 }
 
 void Channel1::setNr4(unsigned const data) {
-	lengthCounter_.nr4Change(nr4_, data, cycleCounter_);
+	if (lengthCounter_.nr4Change(nr4_, data, cycleCounter_))
+		disableMaster_();
+
 	nr4_ = data;
 	dutyUnit_.nr4Change(data, cycleCounter_);
 
@@ -214,7 +244,7 @@ void Channel1::loadState(SaveState const &state) {
 	master_ = state.spu.ch1.master;
 }
 
-void Channel1::update(uint_least32_t *buf, unsigned long const soBaseVol, unsigned long cycles) {
+void Channel1::update(DeltaOut deltas, unsigned long const soBaseVol, unsigned long cycles) {
 	unsigned long const outBase = envelopeUnit_.dacIsOn() ? soBaseVol & soMask_ : 0;
 	unsigned long const outLow = outBase * (0 - 15ul);
 	unsigned long const endCycles = cycleCounter_ + cycles;
@@ -223,13 +253,13 @@ void Channel1::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 		unsigned long const outHigh = master_
 		                            ? outBase * (envelopeUnit_.getVolume() * 2 - 15ul)
 		                            : outLow;
-		unsigned long const nextMajorEvent = std::min(nextEventUnit_->counter(), endCycles);
+		unsigned long const nextMajorEvent = std::min(nextEventCounter(), endCycles);
 		unsigned long out = dutyUnit_.isHighState() ? outHigh : outLow;
 
 		while (dutyUnit_.counter() <= nextMajorEvent) {
-			*buf = out - prevOut_;
+			deltas.add(out - prevOut_);
 			prevOut_ = out;
-			buf += dutyUnit_.counter() - cycleCounter_;
+			deltas.advance(dutyUnit_.counter() - cycleCounter_);
 			cycleCounter_ = dutyUnit_.counter();
 
 			dutyUnit_.event();
@@ -237,14 +267,14 @@ void Channel1::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 		}
 
 		if (cycleCounter_ < nextMajorEvent) {
-			*buf = out - prevOut_;
+			deltas.add(out - prevOut_);
 			prevOut_ = out;
-			buf += nextMajorEvent - cycleCounter_;
+			deltas.advance(nextMajorEvent - cycleCounter_);
 			cycleCounter_ = nextMajorEvent;
 		}
 
-		if (nextEventUnit_->counter() == nextMajorEvent) {
-			nextEventUnit_->event();
+		if (nextEventCounter() == nextMajorEvent) {
+			nextEvent();
 			setEvent();
 		} else
 			break;
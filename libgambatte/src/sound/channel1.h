@@ -19,6 +19,7 @@
 #ifndef SOUND_CHANNEL1_H
 #define SOUND_CHANNEL1_H
 
+#include "delta_out.h"
 #include "duty_unit.h"
 #include "envelope_unit.h"
 #include "gbint.h"
@@ -40,7 +41,7 @@ public:
 	void setNr4(unsigned data);
 	void setSo(unsigned long soMask);
 	bool isActive() const { return master_; }
-	void update(uint_least32_t *buf, unsigned long soBaseVol, unsigned long cycles);
+	void update(DeltaOut deltas, unsigned long soBaseVol, unsigned long cycles);
 	void reset();
 	void init(bool cgb);
 	void saveState(SaveState &state);
@@ -49,8 +50,8 @@ public:
 private:
 	class SweepUnit : public SoundUnit {
 	public:
-		SweepUnit(MasterDisabler &disabler, DutyUnit &dutyUnit);
-		virtual void event();
+		SweepUnit(DutyMasterDisabler &disabler, DutyUnit &dutyUnit);
+		void event();
 		void nr0Change(unsigned newNr0);
 		void nr4Init(unsigned long cycleCounter);
 		void reset();
@@ -59,7 +60,7 @@ private:
 		void loadState(SaveState const &state);
 
 	private:
-		MasterDisabler &disableMaster_;
+		DutyMasterDisabler &disableMaster_;
 		DutyUnit &dutyUnit_;
 		unsigned short shadow_;
 		unsigned char nr0_;
@@ -77,13 +78,17 @@ private:
 	DutyUnit dutyUnit_;
 	EnvelopeUnit envelopeUnit_;
 	SweepUnit sweepUnit_;
-	SoundUnit *nextEventUnit_;
+	unsigned char nextEventUnit_;
 	unsigned long cycleCounter_;
 	unsigned long soMask_;
 	unsigned long prevOut_;
 	unsigned char nr4_;
 	bool master_;
 
+	enum { unit_sweep, unit_envelope, unit_length };
+
+	unsigned long nextEventCounter() const;
+	void nextEvent();
 	void setEvent();
 };
 
@@ -25,8 +25,8 @@ namespace gambatte {
 Channel2::Channel2()
 : staticOutputTest_(*this, dutyUnit_)
 , disableMaster_(master_, dutyUnit_)
-, lengthCounter_(disableMaster_, 0x3F)
-, envelopeUnit_(staticOutputTest_)
+, lengthCounter_(0x3F)
+, nextEventUnit_(unit_envelope)
 , cycleCounter_(0)
 , soMask_(0)
 , prevOut_(0)
@@ -36,10 +36,35 @@ Channel2::Channel2()
 	setEvent();
 }
 
+inline unsigned long Channel2::nextEventCounter() const {
+	switch (nextEventUnit_) {
+	case unit_envelope: return envelopeUnit_.counter();
+	}
+
+	return lengthCounter_.counter();
+}
+
+void Channel2::nextEvent() {
+	switch (nextEventUnit_) {
+	case unit_envelope:
+		{
+			unsigned long const cc = envelopeUnit_.counter();
+			if (envelopeUnit_.event())
+				staticOutputTest_(cc);
+		}
+
+		break;
+	default:
+		lengthCounter_.event();
+		disableMaster_();
+		break;
+	}
+}
+
 void Channel2::setEvent() {
-	nextEventUnit = &envelopeUnit_;
-	if (lengthCounter_.counter() < nextEventUnit->counter())
-		nextEventUnit = &lengthCounter_;
+	nextEventUnit_ = unit_envelope;
+	if (lengthCounter_.counter() < nextEventCounter())
+		nextEventUnit_ = unit_length;
 }
 
 void Channel2::setNr1(unsigned data) {
@@ -63,7 +88,9 @@ void Channel2::setNr3(unsigned data) {
 }
 
 void Channel2::setNr4(unsigned const data) {
-	lengthCounter_.nr4Change(nr4_, data, cycleCounter_);
+	if (lengthCounter_.nr4Change(nr4_, data, cycleCounter_))
+		disableMaster_();
+
 	nr4_ = data;
 
 	if (data & 0x80) { // init-bit
@@ -113,7 +140,7 @@ void Channel2::loadState(SaveState const &state) {
 	master_ = state.spu.ch2.master;
 }
 
-void Channel2::update(uint_least32_t *buf, unsigned long const soBaseVol, unsigned long cycles) {
+void Channel2::update(DeltaOut deltas, unsigned long const soBaseVol, unsigned long cycles) {
 	unsigned long const outBase = envelopeUnit_.dacIsOn() ? soBaseVol & soMask_ : 0;
 	unsigned long const outLow = outBase * (0 - 15ul);
 	unsigned long const endCycles = cycleCounter_ + cycles;
@@ -122,13 +149,13 @@ void Channel2::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 		unsigned long const outHigh = master_
 		                            ? outBase * (envelopeUnit_.getVolume() * 2 - 15ul)
 		                            : outLow;
-		unsigned long const nextMajorEvent = std::min(nextEventUnit->counter(), endCycles);
+		unsigned long const nextMajorEvent = std::min(nextEventCounter(), endCycles);
 		unsigned long out = dutyUnit_.isHighState() ? outHigh : outLow;
 
 		while (dutyUnit_.counter() <= nextMajorEvent) {
-			*buf += out - prevOut_;
+			deltas.add(out - prevOut_);
 			prevOut_ = out;
-			buf += dutyUnit_.counter() - cycleCounter_;
+			deltas.advance(dutyUnit_.counter() - cycleCounter_);
 			cycleCounter_ = dutyUnit_.counter();
 
 			dutyUnit_.event();
@@ -136,14 +163,14 @@ void Channel2::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 		}
 
 		if (cycleCounter_ < nextMajorEvent) {
-			*buf += out - prevOut_;
+			deltas.add(out - prevOut_);
 			prevOut_ = out;
-			buf += nextMajorEvent - cycleCounter_;
+			deltas.advance(nextMajorEvent - cycleCounter_);
 			cycleCounter_ = nextMajorEvent;
 		}
 
-		if (nextEventUnit->counter() == nextMajorEvent) {
-			nextEventUnit->event();
+		if (nextEventCounter() == nextMajorEvent) {
+			nextEvent();
 			setEvent();
 		} else
 			break;
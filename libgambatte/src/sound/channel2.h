@@ -19,6 +19,7 @@
 #ifndef SOUND_CHANNEL2_H
 #define SOUND_CHANNEL2_H
 
+#include "delta_out.h"
 #include "duty_unit.h"
 #include "envelope_unit.h"
 #include "gbint.h"
@@ -38,7 +39,7 @@ public:
 	void setNr4(unsigned data);
 	void setSo(unsigned long soMask);
 	bool isActive() const { return master_; }
-	void update(uint_least32_t *buf, unsigned long soBaseVol, unsigned long cycles);
+	void update(DeltaOut deltas, unsigned long soBaseVol, unsigned long cycles);
 	void reset();
 	void saveState(SaveState &state);
 	void loadState(SaveState const &state);
@@ -51,13 +52,17 @@ private:
 	LengthCounter lengthCounter_;
 	DutyUnit dutyUnit_;
 	EnvelopeUnit envelopeUnit_;
-	SoundUnit *nextEventUnit;
+	unsigned char nextEventUnit_;
 	unsigned long cycleCounter_;
 	unsigned long soMask_;
 	unsigned long prevOut_;
 	unsigned char nr4_;
 	bool master_;
 
+	enum { unit_envelope, unit_length };
+
+	unsigned long nextEventCounter() const;
+	void nextEvent();
 	void setEvent();
 };
 
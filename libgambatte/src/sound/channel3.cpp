@@ -29,7 +29,7 @@ namespace gambatte {
 
 Channel3::Channel3()
 : disableMaster_(master_, waveCounter_)
-, lengthCounter_(disableMaster_, 0xFF)
+, lengthCounter_(0xFF)
 , cycleCounter_(0)
 , soMask_(0)
 , prevOut_(0)
@@ -60,7 +60,9 @@ void Channel3::setNr2(unsigned data) {
 }
 
 void Channel3::setNr4(unsigned const data) {
-	lengthCounter_.nr4Change(nr4_, data, cycleCounter_);
+	if (lengthCounter_.nr4Change(nr4_, data, cycleCounter_))
+		disableMaster_();
+
 	nr4_ = data & 0x7F;
 
 	if (data & nr0_/* & 0x80*/) {
@@ -142,7 +144,7 @@ void Channel3::updateWaveCounter(unsigned long const cc) {
 	}
 }
 
-void Channel3::update(uint_least32_t *buf, unsigned long const soBaseVol, unsigned long cycles) {
+void Channel3::update(DeltaOut deltas, unsigned long const soBaseVol, unsigned long cycles) {
 	unsigned long const outBase = nr0_/* & 0x80*/ ? soBaseVol & soMask_ : 0;
 
 	if (outBase && rshift_ != 4) {
@@ -157,9 +159,9 @@ void Channel3::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 			out *= outBase;
 
 			while (waveCounter_ <= nextMajorEvent) {
-				*buf += out - prevOut_;
+				deltas.add(out - prevOut_);
 				prevOut_ = out;
-				buf += waveCounter_ - cycleCounter_;
+				deltas.advance(waveCounter_ - cycleCounter_);
 				cycleCounter_ = waveCounter_;
 
 				lastReadTime_ = waveCounter_;
@@ -172,26 +174,28 @@ void Channel3::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 			}
 
 			if (cycleCounter_ < nextMajorEvent) {
-				*buf += out - prevOut_;
+				deltas.add(out - prevOut_);
 				prevOut_ = out;
-				buf += nextMajorEvent - cycleCounter_;
+				deltas.advance(nextMajorEvent - cycleCounter_);
 				cycleCounter_ = nextMajorEvent;
 			}
 
 			if (lengthCounter_.counter() == nextMajorEvent) {
 				lengthCounter_.event();
+				disableMaster_();
 			} else
 				break;
 		}
 	} else {
 		unsigned long const out = outBase * (0 - 15ul);
-		*buf += out - prevOut_;
+		deltas.add(out - prevOut_);
 		prevOut_ = out;
 		cycleCounter_ += cycles;
 
 		while (lengthCounter_.counter() <= cycleCounter_) {
 			updateWaveCounter(lengthCounter_.counter());
 			lengthCounter_.event();
+			disableMaster_();
 		}
 
 		updateWaveCounter(cycleCounter_);
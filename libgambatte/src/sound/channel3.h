@@ -19,6 +19,7 @@
 #ifndef SOUND_CHANNEL3_H
 #define SOUND_CHANNEL3_H
 
+#include "delta_out.h"
 #include "gbint.h"
 #include "length_counter.h"
 #include "master_disabler.h"
@@ -42,7 +43,7 @@ public:
 	void setNr3(unsigned data) { nr3_ = data; }
 	void setNr4(unsigned data);
 	void setSo(unsigned long soMask);
-	void update(uint_least32_t *buf, unsigned long soBaseVol, unsigned long cycles);
+	void update(DeltaOut deltas, unsigned long soBaseVol, unsigned long cycles);
 
 	unsigned waveRamRead(unsigned index) const {
 		if (master_) {
@@ -71,7 +72,7 @@ private:
 	public:
 		Ch3MasterDisabler(bool &m, unsigned long &wC) : MasterDisabler(m), waveCounter_(wC) {}
 
-		virtual void operator()() {
+		void operator()() {
 			MasterDisabler::operator()();
 			waveCounter_ = SoundUnit::counter_disabled;
 		}
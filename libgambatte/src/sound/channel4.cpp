@@ -32,6 +32,57 @@ static unsigned long toPeriod(unsigned const nr3) {
 	return r << s;
 }
 
+namespace {
+
+// One cycle of the register at a given width, starting from all ones. A register
+// value is the next outputs of the cycle, so the outputs are stored as packed
+// bits and the value at a position is read back from them. State 0 is not part
+// of the cycle and maps to position length.
+template<unsigned bits>
+struct LfsrCycle {
+	enum { length = (1u << bits) - 1 };
+
+	unsigned short pos[1u << bits];
+	unsigned char run[length];
+	unsigned char out[(length + bits) / 8 + 3];
+
+	LfsrCycle() {
+		std::fill(out, out + sizeof out, 0);
+		pos[0] = length;
+
+		unsigned reg = length;
+		for (unsigned p = 0; p < length + bits; ++p) {
+			if (p < length)
+				pos[reg] = p;
+
+			out[p >> 3] |= (reg & 1) << (p & 7);
+			reg = reg >> 1 | ((reg ^ reg >> 1) & 1) << (bits - 1);
+		}
+
+		for (unsigned p = 0; p < length; ++p) {
+			unsigned k = 1;
+			while (outAt((p + k) % length) == outAt(p))
+				++k;
+
+			run[p] = k;
+		}
+	}
+
+	unsigned outAt(unsigned p) const { return out[p >> 3] >> (p & 7) & 1; }
+
+	unsigned regAt(unsigned p) const {
+		unsigned long const window = out[p >> 3]
+		                           | static_cast<unsigned long>(out[(p >> 3) + 1]) << 8
+		                           | static_cast<unsigned long>(out[(p >> 3) + 2]) << 16;
+		return window >> (p & 7) & length;
+	}
+};
+
+LfsrCycle<15> const cycle15;
+LfsrCycle<7> const cycle7;
+
+}
+
 namespace gambatte {
 
 Channel4::Lfsr::Lfsr()
@@ -75,20 +126,93 @@ void Channel4::Lfsr::reviveCounter(unsigned long cc) {
 	counter_ = backupCounter_;
 }
 
-inline void Channel4::Lfsr::event() {
-	if (nr3_ < 0xE0) {
-		unsigned const shifted = reg_ >> 1;
-		unsigned const xored = (reg_ ^ shifted) & 1;
-		reg_ = shifted | xored << 14;
+inline void Channel4::Lfsr::shift() {
+	unsigned const shifted = reg_ >> 1;
+	unsigned const xored = (reg_ ^ shifted) & 1;
+	reg_ = shifted | xored << 14;
 
-		if (nr3_ & 8)
-			reg_ = (reg_ & ~0x40) | xored << 6;
-	}
+	if (nr3_ & 8)
+		reg_ = (reg_ & ~0x40) | xored << 6;
+}
+
+inline void Channel4::Lfsr::event() {
+	if (nr3_ < 0xE0)
+		shift();
 
 	counter_ += toPeriod(nr3_);
 	backupCounter_ = counter_;
 }
 
+// Emits the output changes due up to limit by walking the runs of equal outputs
+// in the cycle, rather than shifting the register one period at a time. Returns
+// false without doing anything if the register is not in the cycle.
+template<class Cycle>
+bool Channel4::Lfsr::walk(Cycle const &cycle, DeltaOut &deltas, unsigned long &cc,
+		unsigned long &prevOut, unsigned long &out, unsigned long const flip, unsigned long const limit) {
+	unsigned p = cycle.pos[reg_ & Cycle::length];
+	if (p == Cycle::length)
+		return false;
+
+	unsigned long const period = toPeriod(nr3_);
+	unsigned long t = counter_;
+	unsigned shifts = 0;
+
+	for (;;) {
+		unsigned const k = cycle.run[p];
+		unsigned long const change = t + (k - 1) * period;
+		if (change > limit)
+			break;
+
+		deltas.add(out - prevOut);
+		prevOut = out;
+		deltas.advance(change - cc);
+		cc = change;
+		out ^= flip;
+
+		p += k;
+		if (p >= Cycle::length)
+			p -= Cycle::length;
+
+		t = change + period;
+		shifts += k;
+	}
+
+	if (t <= limit) {
+		unsigned const n = (limit - t) / period + 1;
+		p += n;
+		if (p >= Cycle::length)
+			p -= Cycle::length;
+
+		t += n * period;
+		shifts += n;
+	}
+
+	counter_ = backupCounter_ = t;
+
+	if (Cycle::length == 0x7FFF) {
+		reg_ = cycle.regAt(p);
+	} else if (shifts > 7) {
+		// The bits above the low seven have been replaced by outputs by now.
+		unsigned const low = cycle.regAt(p);
+		reg_ = low | cycle.outAt(p ? p - 1 : Cycle::length - 1) << 7 | low << 8;
+	} else {
+		while (shifts--)
+			shift();
+	}
+
+	return true;
+}
+
+bool Channel4::Lfsr::walk(DeltaOut &deltas, unsigned long &cc, unsigned long &prevOut,
+		unsigned long &out, unsigned long flip, unsigned long limit) {
+	if (nr3_ >= 0xE0)
+		return false;
+
+	return nr3_ & 8
+	     ? walk(cycle7, deltas, cc, prevOut, out, flip, limit)
+	     : walk(cycle15, deltas, cc, prevOut, out, flip, limit);
+}
+
 void Channel4::Lfsr::nr3Change(unsigned newNr3, unsigned long cc) {
 	updateBackupCounter(cc);
 	nr3_ = newNr3;
@@ -130,9 +254,8 @@ void Channel4::Lfsr::loadState(SaveState const &state) {
 Channel4::Channel4()
 : staticOutputTest_(*this, lfsr_)
 , disableMaster_(master_, lfsr_)
-, lengthCounter_(disableMaster_, 0x3F)
-, envelopeUnit_(staticOutputTest_)
-, nextEventUnit_(0)
+, lengthCounter_(0x3F)
+, nextEventUnit_(unit_envelope)
 , cycleCounter_(0)
 , soMask_(0)
 , prevOut_(0)
@@ -142,10 +265,35 @@ Channel4::Channel4()
 	setEvent();
 }
 
+inline unsigned long Channel4::nextEventCounter() const {
+	switch (nextEventUnit_) {
+	case unit_envelope: return envelopeUnit_.counter();
+	}
+
+	return lengthCounter_.counter();
+}
+
+void Channel4::nextEvent() {
+	switch (nextEventUnit_) {
+	case unit_envelope:
+		{
+			unsigned long const cc = envelopeUnit_.counter();
+			if (envelopeUnit_.event())
+				staticOutputTest_(cc);
+		}
+
+		break;
+	default:
+		lengthCounter_.event();
+		disableMaster_();
+		break;
+	}
+}
+
 void Channel4::setEvent() {
-	nextEventUnit_ = &envelopeUnit_;
-	if (lengthCounter_.counter() < nextEventUnit_->counter())
-		nextEventUnit_ = &lengthCounter_;
+	nextEventUnit_ = unit_envelope;
+	if (lengthCounter_.counter() < nextEventCounter())
+		nextEventUnit_ = unit_length;
 }
 
 void Channel4::setNr1(unsigned data) {
@@ -163,7 +311,9 @@ void Channel4::setNr2(unsigned data) {
 }
 
 void Channel4::setNr4(unsigned const data) {
-	lengthCounter_.nr4Change(nr4_, data, cycleCounter_);
+	if (lengthCounter_.nr4Change(nr4_, data, cycleCounter_))
+		disableMaster_();
+
 	nr4_ = data;
 
 	if (data & 0x80) { // init-bit
@@ -215,35 +365,38 @@ void Channel4::loadState(SaveState const &state) {
 	master_ = state.spu.ch4.master;
 }
 
-void Channel4::update(uint_least32_t *buf, unsigned long const soBaseVol, unsigned long cycles) {
+void Channel4::update(DeltaOut deltas, unsigned long const soBaseVol, unsigned long cycles) {
 	unsigned long const outBase = envelopeUnit_.dacIsOn() ? soBaseVol & soMask_ : 0;
 	unsigned long const outLow = outBase * (0 - 15ul);
 	unsigned long const endCycles = cycleCounter_ + cycles;
 
 	for (;;) {
 		unsigned long const outHigh = outBase * (envelopeUnit_.getVolume() * 2 - 15ul);
-		unsigned long const nextMajorEvent = std::min(nextEventUnit_->counter(), endCycles);
+		unsigned long const nextMajorEvent = std::min(nextEventCounter(), endCycles);
 		unsigned long out = lfsr_.isHighState() ? outHigh : outLow;
 
-		while (lfsr_.counter() <= nextMajorEvent) {
-			*buf += out - prevOut_;
-			prevOut_ = out;
-			buf += lfsr_.counter() - cycleCounter_;
-			cycleCounter_ = lfsr_.counter();
+		if (lfsr_.counter() > nextMajorEvent
+				|| !lfsr_.walk(deltas, cycleCounter_, prevOut_, out, outHigh ^ outLow, nextMajorEvent)) {
+			while (lfsr_.counter() <= nextMajorEvent) {
+				deltas.add(out - prevOut_);
+				prevOut_ = out;
+				deltas.advance(lfsr_.counter() - cycleCounter_);
+				cycleCounter_ = lfsr_.counter();
 
-			lfsr_.event();
-			out = lfsr_.isHighState() ? outHigh : outLow;
+				lfsr_.event();
+				out = lfsr_.isHighState() ? outHigh : outLow;
+			}
 		}
 
 		if (cycleCounter_ < nextMajorEvent) {
-			*buf += out - prevOut_;
+			deltas.add(out - prevOut_);
 			prevOut_ = out;
-			buf += nextMajorEvent - cycleCounter_;
+			deltas.advance(nextMajorEvent - cycleCounter_);
 			cycleCounter_ = nextMajorEvent;
 		}
 
-		if (nextEventUnit_->counter() == nextMajorEvent) {
-			nextEventUnit_->event();
+		if (nextEventCounter() == nextMajorEvent) {
+			nextEvent();
 			setEvent();
 		} else
 			break;
@@ -19,6 +19,7 @@
 #ifndef SOUND_CHANNEL4_H
 #define SOUND_CHANNEL4_H
 
+#include "delta_out.h"
 #include "envelope_unit.h"
 #include "gbint.h"
 #include "length_counter.h"
@@ -38,7 +39,7 @@ public:
 	void setNr4(unsigned data);
 	void setSo(unsigned long soMask);
 	bool isActive() const { return master_; }
-	void update(uint_least32_t *buf, unsigned long soBaseVol, unsigned long cycles);
+	void update(DeltaOut deltas, unsigned long soBaseVol, unsigned long cycles);
 	void reset();
 	void saveState(SaveState &state);
 	void loadState(SaveState const &state);
@@ -47,8 +48,8 @@ private:
 	class Lfsr : public SoundUnit {
 	public:
 		Lfsr();
-		virtual void event();
-		virtual void resetCounters(unsigned long oldCc);
+		void event();
+		void resetCounters(unsigned long oldCc);
 		bool isHighState() const { return ~reg_ & 1; }
 		void nr3Change(unsigned newNr3, unsigned long cc);
 		void nr4Init(unsigned long cc);
@@ -58,6 +59,8 @@ private:
 		void disableMaster() { killCounter(); master_ = false; reg_ = 0x7FFF; }
 		void killCounter() { counter_ = counter_disabled; }
 		void reviveCounter(unsigned long cc);
+		bool walk(DeltaOut &deltas, unsigned long &cc, unsigned long &prevOut,
+		          unsigned long &out, unsigned long flip, unsigned long limit);
 
 	private:
 		unsigned long backupCounter_;
@@ -65,13 +68,17 @@ private:
 		unsigned char nr3_;
 		bool master_;
 
+		void shift();
 		void updateBackupCounter(unsigned long cc);
+		template<class Cycle>
+		bool walk(Cycle const &cycle, DeltaOut &deltas, unsigned long &cc, unsigned long &prevOut,
+		          unsigned long &out, unsigned long flip, unsigned long limit);
 	};
 
 	class Ch4MasterDisabler : public MasterDisabler {
 	public:
 		Ch4MasterDisabler(bool &m, Lfsr &lfsr) : MasterDisabler(m), lfsr_(lfsr) {}
-		virtual void operator()() { MasterDisabler::operator()(); lfsr_.disableMaster(); }
+		void operator()() { MasterDisabler::operator()(); lfsr_.disableMaster(); }
 
 	private:
 		Lfsr &lfsr_;
@@ -84,13 +91,17 @@ private:
 	LengthCounter lengthCounter_;
 	EnvelopeUnit envelopeUnit_;
 	Lfsr lfsr_;
-	SoundUnit *nextEventUnit_;
+	unsigned char nextEventUnit_;
 	unsigned long cycleCounter_;
 	unsigned long soMask_;
 	unsigned long prevOut_;
 	unsigned char nr4_;
 	bool master_;
 
+	enum { unit_envelope, unit_length };
+
+	unsigned long nextEventCounter() const;
+	void nextEvent();
 	void setEvent();
 };
 
@@ -0,0 +1,75 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+#ifndef DELTA_OUT_H
+#define DELTA_OUT_H
+
+#include "audiosink.h"
+#include "gbint.h"
+
+namespace gambatte {
+
+// Receives the changes of a channel's output during an update, as packed stereo
+// values like the samples of the sound buffer. They are either added to the
+// buffer, which PSG::fillBuffer sums up afterwards, or split into left and right
+// and passed on to an AudioSink, which then also keeps sum up to date.
+class DeltaOut {
+public:
+	DeltaOut(uint_least32_t *buf, unsigned long pos)
+	: buf_(buf), sink_(0), sum_(0), pos_(pos)
+	{
+	}
+
+	DeltaOut(AudioSink &sink, uint_least32_t &sum, unsigned long pos)
+	: buf_(0), sink_(&sink), sum_(&sum), pos_(pos)
+	{
+	}
+
+	void add(unsigned long delta) {
+		if (!sink_)
+			buf_[pos_] += delta;
+		else if (delta & 0xFFFFFFFF)
+			put(delta);
+	}
+
+	void advance(unsigned long samples) { pos_ += samples; }
+
+private:
+	uint_least32_t *buf_;
+	AudioSink *sink_;
+	uint_least32_t *sum_;
+	unsigned long pos_;
+
+	void put(unsigned long delta) {
+		*sum_ += delta;
+
+		// The low half never borrows from the high one in a sum of all deltas,
+		// but a single delta does, whenever its low half is negative.
+		long const low = static_cast<long>((delta & 0xFFFF) ^ 0x8000) - 0x8000;
+		long const high = static_cast<long>(((delta - low) >> 16 & 0xFFFF) ^ 0x8000) - 0x8000;
+#ifdef WORDS_BIGENDIAN
+		sink_->delta(pos_, high, low);
+#else
+		sink_->delta(pos_, low, high);
+#endif
+	}
+};
+
+}
+
+#endif
@@ -76,19 +76,6 @@ void DutyUnit::setFreq(unsigned newFreq, unsigned long cc) {
 	setCounter();
 }
 
-void DutyUnit::event() {
-	static unsigned char const inc[] = {
-		1, 7,
-		2, 6,
-		4, 4,
-		6, 2,
-	};
-
-	high_ ^= true;
-	counter_ += inc_ * period_;
-	inc_ = inc[duty_ * 2 + high_];
-}
-
 void DutyUnit::nr1Change(unsigned newNr1, unsigned long cc) {
 	updatePos(cc);
 	duty_ = newNr1 >> 6;
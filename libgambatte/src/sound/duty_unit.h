@@ -28,8 +28,8 @@ namespace gambatte {
 class DutyUnit : public SoundUnit {
 public:
 	DutyUnit();
-	virtual void event();
-	virtual void resetCounters(unsigned long oldCc);
+	void event();
+	void resetCounters(unsigned long oldCc);
 	bool isHighState() const { return high_; }
 	void nr1Change(unsigned newNr1, unsigned long cc);
 	void nr3Change(unsigned newNr3, unsigned long cc);
@@ -58,10 +58,23 @@ private:
 	void updatePos(unsigned long cc);
 };
 
+inline void DutyUnit::event() {
+	static unsigned char const inc[] = {
+		1, 7,
+		2, 6,
+		4, 4,
+		6, 2,
+	};
+
+	high_ ^= true;
+	counter_ += inc_ * period_;
+	inc_ = inc[duty_ * 2 + high_];
+}
+
 class DutyMasterDisabler : public MasterDisabler {
 public:
 	DutyMasterDisabler(bool &m, DutyUnit &dutyUnit) : MasterDisabler(m), dutyUnit_(dutyUnit) {}
-	virtual void operator()() { MasterDisabler::operator()(); dutyUnit_.killCounter(); }
+	void operator()() { MasterDisabler::operator()(); dutyUnit_.killCounter(); }
 
 private:
 	DutyUnit &dutyUnit_;
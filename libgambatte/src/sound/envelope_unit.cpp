@@ -21,11 +21,8 @@
 
 namespace gambatte {
 
-EnvelopeUnit::VolOnOffEvent EnvelopeUnit::nullEvent_;
-
-EnvelopeUnit::EnvelopeUnit(VolOnOffEvent &volOnOffEvent)
-: volOnOffEvent_(volOnOffEvent)
-, nr2_(0)
+EnvelopeUnit::EnvelopeUnit()
+: nr2_(0)
 , volume_(0)
 {
 }
@@ -45,8 +42,9 @@ void EnvelopeUnit::loadState(SaveState::SPU::Env const &estate, unsigned nr2, un
 	nr2_ = nr2;
 }
 
-void EnvelopeUnit::event() {
+bool EnvelopeUnit::event() {
 	unsigned long const period = nr2_ & 7;
+	bool volOnOff = false;
 
 	if (period) {
 		unsigned newVol = volume_;
@@ -57,14 +55,15 @@ void EnvelopeUnit::event() {
 
 		if (newVol < 0x10U) {
 			volume_ = newVol;
-			if (volume_ < 2)
-				volOnOffEvent_(counter_);
+			volOnOff = volume_ < 2;
 
 			counter_ += period << 15;
 		} else
 			counter_ = counter_disabled;
 	} else
 		counter_ += 8ul << 15;
+
+	return volOnOff;
 }
 
 bool EnvelopeUnit::nr2Change(unsigned const newNr2) {
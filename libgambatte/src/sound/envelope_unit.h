@@ -26,13 +26,10 @@ namespace gambatte {
 
 class EnvelopeUnit : public SoundUnit {
 public:
-	struct VolOnOffEvent {
-		virtual ~VolOnOffEvent() {}
-		virtual void operator()(unsigned long /*cc*/) {}
-	};
-
-	explicit EnvelopeUnit(VolOnOffEvent &volOnOffEvent = nullEvent_);
-	void event();
+	EnvelopeUnit();
+	// Returns true if the volume may have crossed zero, which can turn the
+	// channel's static output on or off.
+	bool event();
 	bool dacIsOn() const { return nr2_ & 0xF8; }
 	unsigned getVolume() const { return volume_; }
 	bool nr2Change(unsigned newNr2);
@@ -42,8 +39,6 @@ public:
 	void loadState(SaveState::SPU::Env const &estate, unsigned nr2, unsigned long cc);
 
 private:
-	static VolOnOffEvent nullEvent_;
-	VolOnOffEvent &volOnOffEvent_;
 	unsigned char nr2_;
 	unsigned char volume_;
 };
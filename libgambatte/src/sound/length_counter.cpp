@@ -17,14 +17,12 @@
 //
 
 #include "length_counter.h"
-#include "master_disabler.h"
 #include <algorithm>
 
 namespace gambatte {
 
-LengthCounter::LengthCounter(MasterDisabler &disabler, unsigned const mask)
-: disableMaster_(disabler)
-, lengthCounter_(0)
+LengthCounter::LengthCounter(unsigned const mask)
+: lengthCounter_(0)
 , lengthMask_(mask)
 {
 	nr1Change(0, 0, 0);
@@ -33,7 +31,6 @@ LengthCounter::LengthCounter(MasterDisabler &disabler, unsigned const mask)
 void LengthCounter::event() {
 	counter_ = counter_disabled;
 	lengthCounter_ = 0;
-	disableMaster_();
 }
 
 void LengthCounter::nr1Change(unsigned const newNr1, unsigned const nr4, unsigned long const cc) {
@@ -43,7 +40,9 @@ void LengthCounter::nr1Change(unsigned const newNr1, unsigned const nr4, unsigne
 	         : static_cast<unsigned long>(counter_disabled);
 }
 
-void LengthCounter::nr4Change(unsigned const oldNr4, unsigned const newNr4, unsigned long const cc) {
+bool LengthCounter::nr4Change(unsigned const oldNr4, unsigned const newNr4, unsigned long const cc) {
+	bool expired = false;
+
 	if (counter_ != counter_disabled)
 		lengthCounter_ = (counter_ >> 13) - (cc >> 13);
 
@@ -55,7 +54,7 @@ void LengthCounter::nr4Change(unsigned const oldNr4, unsigned const newNr4, unsi
 
 			if (!(oldNr4 & 0x40) && lengthCounter_) {
 				if (!(lengthCounter_ -= dec))
-					disableMaster_();
+					expired = true;
 			}
 		}
 
@@ -67,6 +66,8 @@ void LengthCounter::nr4Change(unsigned const oldNr4, unsigned const newNr4, unsi
 		counter_ = ((cc >> 13) + lengthCounter_) << 13;
 	else
 		counter_ = counter_disabled;
+
+	return expired;
 }
 
 void LengthCounter::saveState(SaveState::SPU::LCounter &lstate) const {
@@ -24,19 +24,18 @@
 
 namespace gambatte {
 
-class MasterDisabler;
-
+// The length running out disables the channel. event and nr4Change leave that
+// to the channel, nr4Change returning true when it happens.
 class LengthCounter : public SoundUnit {
 public:
-	LengthCounter(MasterDisabler &disabler, unsigned lengthMask);
-	virtual void event();
+	explicit LengthCounter(unsigned lengthMask);
+	void event();
 	void nr1Change(unsigned newNr1, unsigned nr4, unsigned long cc);
-	void nr4Change(unsigned oldNr4, unsigned newNr4, unsigned long cc);
+	bool nr4Change(unsigned oldNr4, unsigned newNr4, unsigned long cc);
 	void saveState(SaveState::SPU::LCounter &lstate) const;
 	void loadState(SaveState::SPU::LCounter const &lstate, unsigned long cc);
 
 private:
-	MasterDisabler &disableMaster_;
 	unsigned short lengthCounter_;
 	unsigned char const lengthMask_;
 };
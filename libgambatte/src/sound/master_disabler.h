@@ -24,8 +24,7 @@ namespace gambatte {
 class MasterDisabler {
 public:
 	explicit MasterDisabler(bool &master) : master_(master) {}
-	virtual ~MasterDisabler() {}
-	virtual void operator()() { master_ = false; }
+	void operator()() { master_ = false; }
 
 private:
 	bool &master_;
@@ -25,10 +25,7 @@ class SoundUnit {
 public:
 	enum { counter_max = 0x80000000u, counter_disabled = 0xFFFFFFFFu };
 
-	virtual ~SoundUnit() {}
-	virtual void event() = 0;
-
-	virtual void resetCounters(unsigned long /*oldCc*/) {
+	void resetCounters(unsigned long /*oldCc*/) {
 		if (counter_ != counter_disabled)
 			counter_ -= counter_max;
 	}
@@ -24,7 +24,7 @@
 namespace gambatte {
 
 template<class Channel, class Unit>
-class StaticOutputTester : public EnvelopeUnit::VolOnOffEvent {
+class StaticOutputTester {
 public:
 	StaticOutputTester(Channel const &ch, Unit &unit) : ch_(ch), unit_(unit) {}
 	void operator()(unsigned long cc);
@@ -59,17 +59,31 @@ class omemstream
 class imemstream
 {
    public:
-      imemstream(const void *data) : rd_ptr(static_cast<const uint8_t*>(data)), has_read(0) {}
+      imemstream(const void *data, size_t size)
+      : rd_ptr(static_cast<const uint8_t*>(data)), has_read(0), size_(size), failed(false) {}
 
+      // Reads past the end give zeroes, and set fail().
       uint8_t get()
       {
-         uint8_t ret = *rd_ptr++;
+         if (has_read == size_)
+         {
+            failed = true;
+            return 0;
+         }
+
          has_read++;
-         return ret;
+         return *rd_ptr++;
       }
 
       void read(void *data, size_t size)
       {
+         if (size > size_ - has_read)
+         {
+            std::memset(data, 0, size);
+            ignore(size);
+            return;
+         }
+
          std::memcpy(data, rd_ptr, size);
          rd_ptr += size;
          has_read += size;
@@ -77,6 +91,12 @@ class imemstream
 
       void ignore(size_t len = 1)
       {
+         if (len > size_ - has_read)
+         {
+            failed = true;
+            len = size_ - has_read;
+         }
+
          rd_ptr += len;
          has_read += len;
       }
@@ -84,23 +104,25 @@ class imemstream
       void getline(char *data, size_t size, char delim = '\n')
       {
          size_t count = 0;
-         while ((count < size - 1) && (*rd_ptr != delim))
+         while ((count < size - 1) && has_read < size_ && (*rd_ptr != delim))
          {
             *data++ = *rd_ptr++;
             has_read++;
+            count++;
          }
 
-         rd_ptr++;
-         has_read++;
+         ignore();
          *data = '\0';
       }
 
-      bool fail() const { return false; }
-      bool good() const { return true; }
+      bool fail() const { return !size_ || failed; }
+      bool good() const { return !failed && has_read < size_; }
 
    private:
       const uint8_t *rd_ptr;
       size_t has_read;
+      size_t size_;
+      bool failed;
 };
 
 
@@ -331,6 +353,7 @@ SaverList::SaverList() {
 	{ static const char label[] = { l,o,d,m,a,u,p, NUL }; ADD(mem.lastOamDmaUpdate); }
 	{ static const char label[] = { m,i,n,i,n,t,t, NUL }; ADD(mem.minIntTime); }
 	{ static const char label[] = { u,n,h,a,l,t,t, NUL }; ADD(mem.unhaltTime); }
+	{ static const char label[] = { b,l,i,t,t,i,m, NUL }; ADD(mem.blitTime); }
 	{ static const char label[] = { r,o,m,b,a,n,k, NUL }; ADD(mem.rombank); }
 	{ static const char label[] = { d,m,a,s,r,c,   NUL }; ADD(mem.dmaSource); }
 	{ static const char label[] = { d,m,a,d,s,t,   NUL }; ADD(mem.dmaDestination); }
@@ -344,6 +367,7 @@ SaverList::SaverList() {
 	{ static const char label[] = { s,r,a,m,o,n,   NUL }; ADD(mem.enableRam); }
 	{ static const char label[] = { r,a,m,b,m,o,d, NUL }; ADD(mem.rambankMode); }
 	{ static const char label[] = { h,d,m,a,       NUL }; ADD(mem.hdmaTransfer); }
+	{ static const char label[] = { b,l,n,k,l,c,d, NUL }; ADD(mem.blanklcd); }
 	{ static const char label[] = { h,u,c,NO3,r,a,m, NUL }; ADD(mem.HuC3RAMflag); }
 	{ static const char label[] = { b,g,p,         NUL }; ADDPTR(ppu.bgpData); }
 	{ static const char label[] = { o,b,j,p,       NUL }; ADDPTR(ppu.objpData); }
@@ -483,8 +507,8 @@ void StateSaver::saveState(const SaveState &state, void *data) {
 	}
 }
 
-bool StateSaver::loadState(SaveState &state, const void *data) {
-   imemstream file(data);
+bool StateSaver::loadState(SaveState &state, const void *data, size_t size) {
+   imemstream file(data, size);
 
    if (file.fail() || file.get() != 0)
       return false;
@@ -492,9 +516,22 @@ bool StateSaver::loadState(SaveState &state, const void *data) {
    file.ignore();
    file.ignore(get24(file));
 
+   if (file.fail())
+      return false;
+
    const Array<char> labelbuf(list.maxLabelsize());
    const Saver labelbufSaver = { labelbuf, 0, 0, list.maxLabelsize() };
 
+   // The memory areas load straight into the emulated memory, so a
+   // truncated state is rejected before any entry is loaded.
+   for (imemstream check(file); check.good();) {
+      check.getline(labelbuf, list.maxLabelsize(), NUL);
+      check.ignore(get24(check));
+
+      if (check.fail())
+         return false;
+   }
+
    SaverList::const_iterator done = list.begin();
 
    while (file.good() && done != list.end()) {
@@ -515,12 +552,102 @@ bool StateSaver::loadState(SaveState &state, const void *data) {
       (*it->load)(file, state);
    }
 
+   if (file.fail())
+      return false;
+
    state.cpu.cycleCounter &= 0x7FFFFFFF;
    state.spu.cycleCounter &= 0x7FFFFFFF;
 
    return true;
 }
 
+// Fixed-layout binary format for states that only this build reads back, such as
+// run-ahead and rewind snapshots: a header, the SaveState struct as is, and the
+// memory areas its Ptr members point at. The pointers themselves are not stored.
+#define FOR_EACH_STATE_PTR(PTR) \
+	PTR(mem.vram) PTR(mem.sram) PTR(mem.wram) PTR(mem.ioamhram) \
+	PTR(ppu.bgpData) PTR(ppu.objpData) PTR(ppu.oamReaderBuf) PTR(ppu.oamReaderSzbuf) \
+	PTR(spu.ch3.waveRam)
+
+static const char binaryStateMagic[] = { G, B, S, NO1 };
+
+void StateSaver::saveBinaryState(const SaveState &state, void *data) {
+   unsigned char *out = static_cast<unsigned char *>(data);
+   const unsigned long layoutSize = sizeof(SaveState);
+   SaveState layout;
+
+   std::memcpy(&layout, &state, sizeof layout);
+#define PTR(p) layout.p.set(0, layout.p.size());
+   FOR_EACH_STATE_PTR(PTR)
+#undef PTR
+
+   std::memcpy(out, binaryStateMagic, sizeof binaryStateMagic);
+   out += sizeof binaryStateMagic;
+   std::memcpy(out, &layoutSize, sizeof layoutSize);
+   out += sizeof layoutSize;
+   std::memcpy(out, &layout, sizeof layout);
+   out += sizeof layout;
+
+#define PTR(p) \
+   if (state.p.size()) { \
+      std::memcpy(out, state.p.get(), state.p.size() * sizeof *state.p.get()); \
+      out += state.p.size() * sizeof *state.p.get(); \
+   }
+   FOR_EACH_STATE_PTR(PTR)
+#undef PTR
+}
+
+bool StateSaver::loadBinaryState(SaveState &state, const void *data, size_t size) {
+   const unsigned char *in = static_cast<const unsigned char *>(data);
+   unsigned long layoutSize;
+   SaveState layout;
+
+   if (size < binaryStateSize(state)
+         || std::memcmp(in, binaryStateMagic, sizeof binaryStateMagic))
+      return false;
+
+   in += sizeof binaryStateMagic;
+   std::memcpy(&layoutSize, in, sizeof layoutSize);
+   in += sizeof layoutSize;
+
+   if (layoutSize != sizeof layout)
+      return false;
+
+   std::memcpy(&layout, in, sizeof layout);
+   in += sizeof layout;
+
+#define PTR(p) \
+   if (layout.p.size() != state.p.size()) \
+      return false; \
+   layout.p.set(state.p.get(), state.p.size());
+   FOR_EACH_STATE_PTR(PTR)
+#undef PTR
+
+   state = layout;
+
+#define PTR(p) \
+   if (state.p.size()) { \
+      std::memcpy(state.p.get(), in, state.p.size() * sizeof *state.p.get()); \
+      in += state.p.size() * sizeof *state.p.get(); \
+   }
+   FOR_EACH_STATE_PTR(PTR)
+#undef PTR
+
+   return true;
+}
+
+size_t StateSaver::binaryStateSize(const SaveState &state) {
+   size_t size = sizeof binaryStateMagic + sizeof(unsigned long) + sizeof(SaveState);
+
+#define PTR(p) size += state.p.size() * sizeof *state.p.get();
+   FOR_EACH_STATE_PTR(PTR)
+#undef PTR
+
+   return size;
+}
+
+#undef FOR_EACH_STATE_PTR
+
 size_t StateSaver::stateSize(const SaveState &state) {
    omemstream file(0);
 
@@ -37,8 +37,11 @@ public:
 	enum { SS_HEIGHT = 144 >> SS_SHIFT };
 	
    static void saveState(const SaveState &state, void *data);
-   static bool loadState(SaveState &state, const void *data);
+   static bool loadState(SaveState &state, const void *data, size_t size);
    static size_t stateSize(const SaveState &state);
+   static void saveBinaryState(const SaveState &state, void *data);
+   static bool loadBinaryState(SaveState &state, const void *data, size_t size);
+   static size_t binaryStateSize(const SaveState &state);
 };
 
 }
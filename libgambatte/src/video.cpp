@@ -269,6 +269,27 @@ bool LCD::vramAccessible(const unsigned long cc)
       || cc + isDoubleSpeed() - ppu_.cgb() + 2 >= m0TimeOfCurrentLine(cc);
 }
 
+// Time until which VRAM stays writable and is not fetched from by the PPU, as long as
+// no LCD event is processed in between. Only a disabled LCD, vblank and the part of a
+// line after mode 3 are predicted, otherwise cc is returned.
+unsigned long LCD::vramIdleEnd(const unsigned long cc)
+{
+   if (cc >= eventTimes_.nextEventTime())
+      update(cc);
+
+   if (!(ppu_.lcdc() & 0x80))
+      return disabled_time;
+
+   if (ppu_.lyCounter().ly() >= 144)
+      return ppu_.lyCounter().time()
+         + (153 - ppu_.lyCounter().ly()) * ppu_.lyCounter().lineTime();
+
+   if (ppu_.lyCounter().lineCycles(cc) >= 80U && cc >= m0TimeOfCurrentLine(cc))
+      return ppu_.lyCounter().time();
+
+   return cc;
+}
+
 bool LCD::cgbpAccessible(const unsigned long cc)
 {
    if (cc >= eventTimes_.nextEventTime())
@@ -40,16 +40,25 @@ class VideoInterruptRequester
       InterruptRequester &intreq_;
 };
 
+struct ColorTable;
+
 class LCD
 {
    public:
       LCD(const unsigned char *oamram, const unsigned char *vram_in, VideoInterruptRequester memEventRequester);
+      ~LCD();
       void reset(const unsigned char *oamram, unsigned char const *vram, bool cgb);
       void setStatePtrs(SaveState &state);
       void saveState(SaveState &state) const;
       void loadState(const SaveState &state, const unsigned char *oamram);
       void setDmgPaletteColor(unsigned palNum, unsigned colorNum, video_pixel_t rgb32);
       void setVideoBuffer(video_pixel_t *videoBuf, int pitch);
+      void setIndexBuffer(unsigned char *indexBuf, int pitch) { ppu_.setIndexFrameBuf(indexBuf, pitch); }
+      video_pixel_t const * linePalette(unsigned ly) const { return ppu_.linePalette(ly); }
+
+      void convertIndexedFrame(video_pixel_t *dst, int dstPitch, unsigned char const *src, int srcPitch) const {
+         ppu_.convertIndexedFrame(dst, dstPitch, src, srcPitch);
+      }
       void setDmgMode(bool mode) { ppu_.setDmgMode(mode); }
    
       void swapToDMG() {
@@ -103,6 +112,7 @@ class LCD
       void resetCc(unsigned long oldCC, unsigned long newCc);
       void speedChange(unsigned long cycleCounter);
       bool vramAccessible(unsigned long cycleCounter);
+      unsigned long vramIdleEnd(unsigned long cycleCounter);
       bool oamReadable(unsigned long cycleCounter);
       bool oamWritable(unsigned long cycleCounter);
       void wxChange(unsigned newValue, unsigned long cycleCounter);
@@ -113,6 +123,10 @@ class LCD
       void scyChange(unsigned newValue, unsigned long cycleCounter);
 
       void vramChange(const unsigned long cycleCounter) { update(cycleCounter); }
+      /** Call after writing size bytes at offset into VRAM (bank 1 at 0x2000). */
+      void vramDataChange(unsigned offset, unsigned size) { ppu_.vramDataChange(offset, size); }
+      /** Call after VRAM tile data may have been written without vramDataChange. */
+      void syncTileRows() { ppu_.syncTileRows(); }
 
       unsigned getStat(unsigned lycReg, unsigned long cycleCounter);
 
@@ -138,6 +152,41 @@ class LCD
          return lyReg;
       }
 
+      // Time until which getLyReg keeps returning what it returns at cycleCounter,
+      // as long as no LCD event is processed in between.
+      unsigned long lyRegChangeTime(const unsigned long cycleCounter) const {
+         if (!(ppu_.lcdc() & 0x80))
+            return disabled_time;
+
+         const unsigned long time = ppu_.lyCounter().time();
+
+         if (cycleCounter >= time)
+            return cycleCounter;
+
+         if (ppu_.lyCounter().ly() == 153) {
+            if (isDoubleSpeed() && time - cycleCounter > 456 * 2 - 8)
+               return time - (456 * 2 - 8);
+         } else if (time - cycleCounter > 4)
+            return time - 4;
+
+         return time;
+      }
+
+      // Same as lyRegChangeTime for the mode and coincidence bits of getStat. Only a
+      // disabled LCD and vblank lines are predicted, otherwise cycleCounter is returned.
+      unsigned long statChangeTime(const unsigned long cycleCounter) const {
+         if (!(ppu_.lcdc() & 0x80))
+            return disabled_time;
+
+         const unsigned long time = ppu_.lyCounter().time();
+
+         if (ppu_.lyCounter().ly() > 143 && ppu_.lyCounter().ly() < 153
+               && cycleCounter < time && time - cycleCounter > 4)
+            return time - 4;
+
+         return cycleCounter;
+      }
+
       unsigned long nextMode1IrqTime() const { return eventTimes_(MODE1_IRQ); }
 
       void lcdcChange(unsigned data, unsigned long cycleCounter);
@@ -231,10 +280,14 @@ class LCD
       unsigned colorCorrectionMode;
       float colorCorrectionBrightness;
       unsigned darkFilterLevel;
+      ColorTable *colorTable_;
       void doCgbColorChange(unsigned char *const pdata,
             video_pixel_t *const palette, unsigned index, const unsigned data);
 
-      void darkenRgb(float &r, float &g, float &b);
+      void updateColorTable();
+
+      LCD(const LCD &);
+      LCD & operator=(const LCD &);
 
 };
 
@@ -18,6 +18,7 @@
 
 #include "ppu.h"
 #include "savestate.h"
+#include "tile_row.h"
 #include <algorithm>
 #include <cstring>
 #include <cstddef>
@@ -260,10 +261,27 @@ namespace M3Start {
 
 namespace M3Loop {
 
-static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *const dbufline,
+// In the indexed output mode the renderers draw with these as palettes, which gives
+// background palette n colour c as n * 4 + c, and sprite palettes after those.
+static unsigned char const pixel_indices[8 * 4 * 2] = {
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+	32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+	48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63
+};
+
+static video_pixel_t const * bgColors(PPUPriv const &p, video_pixel_t const *) { return p.bgPalette; }
+static video_pixel_t const * spColors(PPUPriv const &p, video_pixel_t const *) { return p.spPalette; }
+static unsigned char const * bgColors(PPUPriv const &, unsigned char const *) { return pixel_indices; }
+static unsigned char const * spColors(PPUPriv const &, unsigned char const *) { return pixel_indices + 32; }
+
+template<typename Pixel>
+static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, Pixel *const dbufline,
 		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
 	unsigned const tileIndexSign = ~p.lcdc << 3 & 0x80;
-	unsigned char const *const tileDataLine = p.vram + tileIndexSign * 32 + tileline * 2;
+	unsigned short const *const tileRowLine = p.tileRows[0] + tileIndexSign * 16 + tileline;
+	Pixel const *const bgPalette  = bgColors(p, dbufline);
+	Pixel const *const spPalettes = spColors(p, dbufline);
 	int xpos = p.xpos;
 
 	do {
@@ -321,33 +339,29 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 			p.cycles -= n;
 
 			unsigned ntileword = p.ntileword;
-			video_pixel_t *      dst    = dbufline + xpos - 8;
-			video_pixel_t *const dstend = dst + n;
+			Pixel *      dst    = dbufline + xpos - 8;
+			Pixel *const dstend = dst + n;
 			xpos += n;
 
 			if (!lcdcBgEn(p)) {
-				do { *dst++ = p.bgPalette[0]; } while (dst != dstend);
+				do { *dst++ = bgPalette[0]; } while (dst != dstend);
 				tileMapXpos += n >> 3;
 
 				unsigned const tno = tileMapLine[(tileMapXpos - 1) & 0x1F];
-				ntileword = expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[0]]
-				          + expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[1]] * 2;
-			} else do {
-				dst[0] = p.bgPalette[ ntileword & 0x0003       ];
-				dst[1] = p.bgPalette[(ntileword & 0x000C) >>  2];
-				dst[2] = p.bgPalette[(ntileword & 0x0030) >>  4];
-				dst[3] = p.bgPalette[(ntileword & 0x00C0) >>  6];
-				dst[4] = p.bgPalette[(ntileword & 0x0300) >>  8];
-				dst[5] = p.bgPalette[(ntileword & 0x0C00) >> 10];
-				dst[6] = p.bgPalette[(ntileword & 0x3000) >> 12];
-				dst[7] = p.bgPalette[ ntileword           >> 14];
-				dst += 8;
+				ntileword = tileRowLine[tno * 8 - (tno & tileIndexSign) * 16];
+			} else {
+				TileRowPalette<Pixel> pal;
+				setTileRowPalette(pal, bgPalette);
 
-				unsigned const tno = tileMapLine[tileMapXpos & 0x1F];
-				tileMapXpos = (tileMapXpos & 0x1F) + 1;
-				ntileword = expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[0]]
-				          + expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[1]] * 2;
-			} while (dst != dstend);
+				do {
+					drawTileRow(dst, ntileword, pal);
+					dst += 8;
+
+					unsigned const tno = tileMapLine[tileMapXpos & 0x1F];
+					tileMapXpos = (tileMapXpos & 0x1F) + 1;
+					ntileword = tileRowLine[tno * 8 - (tno & tileIndexSign) * 16];
+				} while (dst != dstend);
+			}
 
 			p.ntileword = ntileword;
 			continue;
@@ -360,17 +374,11 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 		}
 
 		{
-			video_pixel_t *const dst = dbufline + (xpos - 8);
+			Pixel *const dst = dbufline + (xpos - 8);
 			unsigned const tileword = -(p.lcdc & 1U) & p.ntileword;
-
-			dst[0] = p.bgPalette[ tileword & 0x0003       ];
-			dst[1] = p.bgPalette[(tileword & 0x000C) >>  2];
-			dst[2] = p.bgPalette[(tileword & 0x0030) >>  4];
-			dst[3] = p.bgPalette[(tileword & 0x00C0) >>  6];
-			dst[4] = p.bgPalette[(tileword & 0x0300) >>  8];
-			dst[5] = p.bgPalette[(tileword & 0x0C00) >> 10];
-			dst[6] = p.bgPalette[(tileword & 0x3000) >> 12];
-			dst[7] = p.bgPalette[ tileword           >> 14];
+			TileRowPalette<Pixel> pal;
+			setTileRowPalette(pal, bgPalette);
+			drawTileRow(dst, tileword, pal);
 
 			int i = nextSprite - 1;
 
@@ -392,8 +400,8 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 
 					unsigned const attrib = p.spriteList[i].attrib;
 					unsigned spword       = p.spwordList[i];
-					video_pixel_t const *const spPalette = p.spPalette + (attrib >> 2 & 4);
-					video_pixel_t *d = dst + pos;
+					Pixel const *const spPalette = spPalettes + (attrib >> 2 & 4);
+					Pixel *d = dst + pos;
 
 					if (!(attrib & attr_bgpriority)) {
 						switch (n) {
@@ -426,7 +434,7 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 							if (spword & 3)
                      {
 								d[n] = (tw & 3)
-								     ? p.bgPalette[    tw & 3]
+								     ? bgPalette[    tw & 3]
 								     :   spPalette[spword & 3];
 							}
 
@@ -443,8 +451,7 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 
 		unsigned const tno = tileMapLine[tileMapXpos & 0x1F];
 		tileMapXpos = (tileMapXpos & 0x1F) + 1;
-		p.ntileword = expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[0]]
-		            + expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[1]] * 2;
+		p.ntileword = tileRowLine[tno * 8 - (tno & tileIndexSign) * 16];
 
 		xpos = xpos + 8;
 	} while (xpos < xend);
@@ -452,11 +459,23 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 	p.xpos = xpos;
 }
 
-static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *const dbufline,
+// The expanded row of tile tno at tdoffset (the row byte offset plus the 0x1000 base of
+// unsigned tile numbers), in the bank and orientation that nattrib selects.
+static unsigned cgbTileRow(PPUPriv const &p, unsigned const tno, unsigned const nattrib,
+		unsigned const tdoffset) {
+	unsigned const tdo = tdoffset & ~(tno << 5);
+	return p.tileRows[nattrib >> 5 & 1][(nattrib >> 3 & 1) * 0xC00
+	                                   + (tno * 16 + ((nattrib & attr_yflip) ? tdo ^ 14 : tdo)) / 2];
+}
+
+template<typename Pixel>
+static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, Pixel *const dbufline,
 		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
 	int xpos = p.xpos;
 	unsigned char const *const vram = p.vram;
 	unsigned const tdoffset = tileline * 2 + (~p.lcdc & 0x10) * 0x100;
+	Pixel const *const bgPalettes = bgColors(p, dbufline);
+	Pixel const *const spPalettes = spColors(p, dbufline);
 
 	do {
 		int nextSprite = p.nextSprite;
@@ -504,32 +523,29 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 
 			unsigned ntileword = p.ntileword;
 			unsigned nattrib   = p.nattrib;
-			video_pixel_t *      dst    = dbufline + xpos - 8;
-			video_pixel_t *const dstend = dst + n;
+			Pixel *      dst    = dbufline + xpos - 8;
+			Pixel *const dstend = dst + n;
 			xpos += n;
 
+			// Consecutive tiles mostly share a palette, so it is only set up on changes.
+			unsigned palnum = nattrib & 7;
+			TileRowPalette<Pixel> pal;
+			setTileRowPalette(pal, bgPalettes + palnum * 4);
+
 			do {
-				video_pixel_t const *const bgPalette = p.bgPalette + (nattrib & 7) * 4;
-				dst[0] = bgPalette[ ntileword & 0x0003       ];
-				dst[1] = bgPalette[(ntileword & 0x000C) >>  2];
-				dst[2] = bgPalette[(ntileword & 0x0030) >>  4];
-				dst[3] = bgPalette[(ntileword & 0x00C0) >>  6];
-				dst[4] = bgPalette[(ntileword & 0x0300) >>  8];
-				dst[5] = bgPalette[(ntileword & 0x0C00) >> 10];
-				dst[6] = bgPalette[(ntileword & 0x3000) >> 12];
-				dst[7] = bgPalette[ ntileword           >> 14];
+				if ((nattrib & 7) != palnum) {
+					palnum = nattrib & 7;
+					setTileRowPalette(pal, bgPalettes + palnum * 4);
+				}
+
+				drawTileRow(dst, ntileword, pal);
 				dst += 8;
 
 				unsigned const tno = tileMapLine[ tileMapXpos & 0x1F          ];
 				nattrib            = tileMapLine[(tileMapXpos & 0x1F) + 0x2000];
 				tileMapXpos = (tileMapXpos & 0x1F) + 1;
 
-				unsigned const tdo = (tdoffset & ~(tno << 5));
-				unsigned char const *const td = vram + tno * 16
-				                                     + ((nattrib & attr_yflip) ? tdo ^ 14 : tdo)
-				                                     + (nattrib << 10 & 0x2000);
-				unsigned short const *const explut = expand_lut + (nattrib << 3 & 0x100);
-				ntileword = explut[td[0]] + explut[td[1]] * 2;
+				ntileword = cgbTileRow(p, tno, nattrib, tdoffset);
 			} while (dst != dstend);
 
 			p.ntileword = ntileword;
@@ -545,19 +561,13 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 		}
 
 		{
-			video_pixel_t *const dst = dbufline + (xpos - 8);
+			Pixel *const dst = dbufline + (xpos - 8);
 			unsigned const tileword = p.ntileword;
 			unsigned const attrib   = p.nattrib;
-			video_pixel_t const *const bgPalette = p.bgPalette + (attrib & 7) * 4;
-
-			dst[0] = bgPalette[ tileword & 0x0003       ];
-			dst[1] = bgPalette[(tileword & 0x000C) >>  2];
-			dst[2] = bgPalette[(tileword & 0x0030) >>  4];
-			dst[3] = bgPalette[(tileword & 0x00C0) >>  6];
-			dst[4] = bgPalette[(tileword & 0x0300) >>  8];
-			dst[5] = bgPalette[(tileword & 0x0C00) >> 10];
-			dst[6] = bgPalette[(tileword & 0x3000) >> 12];
-			dst[7] = bgPalette[ tileword           >> 14];
+			Pixel const *const bgPalette = bgPalettes + (attrib & 7) * 4;
+			TileRowPalette<Pixel> pal;
+			setTileRowPalette(pal, bgPalette);
+			drawTileRow(dst, tileword, pal);
 
 			int i = nextSprite - 1;
 
@@ -584,15 +594,15 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 					unsigned char const id = p.spriteList[i].oampos;
 					unsigned const sattrib = p.spriteList[i].attrib;
 					unsigned spword        = p.spwordList[i];
-               video_pixel_t const * spPalette;
+               Pixel const * spPalette;
                if(p.dmgMode)//support gb games in gbc mode
-                  spPalette = p.spPalette + (sattrib >> 2 & 4);
+                  spPalette = spPalettes + (sattrib >> 2 & 4);
                else
-                  spPalette = p.spPalette + (sattrib & 7) * 4;
+                  spPalette = spPalettes + (sattrib & 7) * 4;
 
 					if (!((attrib | sattrib) & bgprioritymask)) {
 						unsigned char  *const idt = idtab + pos;
-						video_pixel_t *const   d =   dst + pos;
+						Pixel *const   d =   dst + pos;
 
 						switch (n) {
 						case 8: if ((spword >> 14    ) && id < idt[7]) {
@@ -668,12 +678,7 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 			unsigned const nattrib = tileMapLine[(tileMapXpos & 0x1F) + 0x2000];
 			tileMapXpos = (tileMapXpos & 0x1F) + 1;
 
-			unsigned const tdo = tdoffset & ~(tno << 5);
-			unsigned char const *const td = vram + tno * 16
-			                                     + ((nattrib & attr_yflip) ? tdo ^ 14 : tdo)
-			                                     + (nattrib << 10 & 0x2000);
-			unsigned short const *const explut = expand_lut + (nattrib << 3 & 0x100);
-			p.ntileword = explut[td[0]] + explut[td[1]] * 2;
+			p.ntileword = cgbTileRow(p, tno, nattrib, tdoffset);
 			p.nattrib   = nattrib;
 		}
 
@@ -683,6 +688,143 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 	p.xpos = xpos;
 }
 
+static void loadNextTileword(PPUPriv &p, unsigned char const *const tileMapLine,
+		unsigned const tileline, unsigned const tileMapXpos) {
+	unsigned const tno = tileMapLine[tileMapXpos & 0x1F];
+
+	if (p.cgb) {
+		unsigned const nattrib = tileMapLine[(tileMapXpos & 0x1F) + 0x2000];
+		p.ntileword = cgbTileRow(p, tno, nattrib, tileline * 2 + (~p.lcdc & 0x10) * 0x100);
+		p.nattrib   = nattrib;
+	} else {
+		unsigned const tileIndexSign = ~p.lcdc << 3 & 0x80;
+		p.ntileword = p.tileRows[0][tileIndexSign * 16 + tileline
+		                            + tno * 8 - (tno & tileIndexSign) * 16];
+	}
+}
+
+// Same as doFullTilesUnrolledDmg/Cgb when there is no video buffer: cycles, sprite
+// loads and the fetch state advance the same way, but only the tile that is left in
+// ntileword is fetched, and nothing is drawn.
+static void doFullTilesSkipped(PPUPriv &p, int const xend,
+		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
+	int xpos = p.xpos;
+
+	do {
+		int nextSprite = p.nextSprite;
+
+		if (int(p.spriteList[nextSprite].spx) < xpos + 8) {
+			int cycles = p.cycles - 8;
+			bool const loadSprites = lcdcObjEn(p) | p.cgb;
+
+			if (loadSprites) {
+				cycles -= std::max(11 - (int(p.spriteList[nextSprite].spx) - xpos), 6);
+
+				for (unsigned i = nextSprite + 1; int(p.spriteList[i].spx) < xpos + 8; ++i)
+					cycles -= 6;
+			}
+
+			if (cycles < 0)
+				break;
+
+			p.cycles = cycles;
+
+			do {
+				if (loadSprites) {
+					unsigned char const *const oam = p.spriteMapper.oamram();
+					unsigned reg0, reg1   = oam[p.spriteList[nextSprite].oampos + 2] * 16;
+					unsigned const attrib = oam[p.spriteList[nextSprite].oampos + 3];
+					unsigned const spline = (  (attrib & attr_yflip)
+					                         ? p.spriteList[nextSprite].line ^ 15
+					                         : p.spriteList[nextSprite].line     ) * 2;
+					unsigned const bank   = attrib << 10 & p.cgb * 0x2000;
+
+					reg0 = p.vram[bank + (lcdcObj2x(p) ? (reg1 & ~16) | spline : reg1 | (spline & ~16))    ];
+					reg1 = p.vram[bank + (lcdcObj2x(p) ? (reg1 & ~16) | spline : reg1 | (spline & ~16)) + 1];
+
+					p.spwordList[nextSprite] = expand_lut[reg0 + (attrib << 3 & 0x100)]
+					                         + expand_lut[reg1 + (attrib << 3 & 0x100)] * 2;
+					p.spriteList[nextSprite].attrib = attrib;
+				}
+
+				++nextSprite;
+			} while (int(p.spriteList[nextSprite].spx) < xpos + 8);
+
+			p.nextSprite = nextSprite;
+		} else if (nextSprite-1 < 0 || int(p.spriteList[nextSprite-1].spx) <= xpos - 8) {
+			if (!(p.cycles & ~7))
+				break;
+
+			int n = ((  xend + 7 < int(p.spriteList[nextSprite].spx)
+			          ? xend + 7 : int(p.spriteList[nextSprite].spx)) - xpos) & ~7;
+			n = (p.cycles & ~7) < n ? p.cycles & ~7 : n;
+			p.cycles -= n;
+			xpos += n;
+			tileMapXpos += n >> 3;
+			loadNextTileword(p, tileMapLine, tileline, tileMapXpos - 1);
+			continue;
+		} else {
+			int cycles = p.cycles - 8;
+			if (cycles < 0)
+				break;
+
+			p.cycles = cycles;
+		}
+
+		int i = nextSprite - 1;
+
+		do {
+			int pos = int(p.spriteList[i].spx) - xpos;
+			p.spwordList[i] >>= pos * 2 >= 0 ? 16 - pos * 2 : 16 + pos * 2;
+			--i;
+		} while (i >= 0 && int(p.spriteList[i].spx) > xpos - 8);
+
+		loadNextTileword(p, tileMapLine, tileline, tileMapXpos);
+		tileMapXpos = (tileMapXpos & 0x1F) + 1;
+		xpos = xpos + 8;
+	} while (xpos < xend);
+
+	p.xpos = xpos;
+}
+
+template<typename Pixel>
+static void doFullTiles(PPUPriv &p, int const xend, Pixel *const dbufline,
+		unsigned char const *const tileMapLine, unsigned const tileline, unsigned const tileMapXpos) {
+	if (!p.framebuf.hasBuf()) {
+		doFullTilesSkipped(p, xend, tileMapLine, tileline, tileMapXpos);
+	} else if (p.cgb) {
+		doFullTilesUnrolledCgb(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
+	} else
+		doFullTilesUnrolledDmg(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
+}
+
+template<typename Pixel>
+static void doFullTilesUnrolled(PPUPriv &p, int const xend, Pixel *const dbufline,
+		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
+	int const xpos = p.xpos;
+
+	if (xpos < 8) {
+		Pixel prebuf[16];
+
+		doFullTiles(p, xend < 8 ? xend : 8, prebuf + (8 - xpos),
+		            tileMapLine, tileline, tileMapXpos);
+
+		int const newxpos = p.xpos;
+
+		if (newxpos > 8 && p.framebuf.hasBuf()) {
+			std::memcpy(dbufline, prebuf + (8 - xpos), (newxpos - 8) * sizeof *dbufline);
+		} else if (newxpos < 8)
+			return;
+
+		if (newxpos >= xend)
+			return;
+
+		tileMapXpos += (newxpos - xpos) >> 3;
+	}
+
+	doFullTiles(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
+}
+
 static void doFullTilesUnrolled(PPUPriv &p) {
 	int xpos = p.xpos;
 	int const xend = static_cast<int>(p.wx) < xpos || p.wx >= 168
@@ -691,7 +833,6 @@ static void doFullTilesUnrolled(PPUPriv &p) {
 	if (xpos >= xend)
 		return;
 
-	video_pixel_t *const dbufline = p.framebuf.fbline();
 	unsigned char const *tileMapLine;
 	unsigned tileline;
 	unsigned tileMapXpos;
@@ -708,40 +849,16 @@ static void doFullTilesUnrolled(PPUPriv &p) {
 		tileline    = (p.scy + p.lyCounter.ly()) & 7;
 	}
 
-	if (xpos < 8) {
-		video_pixel_t prebuf[16];
-
-		if (p.cgb) {
-			doFullTilesUnrolledCgb(p, xend < 8 ? xend : 8, prebuf + (8 - xpos),
-			                       tileMapLine, tileline, tileMapXpos);
-		} else {
-			doFullTilesUnrolledDmg(p, xend < 8 ? xend : 8, prebuf + (8 - xpos),
-			                       tileMapLine, tileline, tileMapXpos);
-		}
-
-		int const newxpos = p.xpos;
-
-		if (newxpos > 8) {
-			std::memcpy(dbufline, prebuf + (8 - xpos), (newxpos - 8) * sizeof *dbufline);
-		} else if (newxpos < 8)
-			return;
-
-		if (newxpos >= xend)
-			return;
-
-		tileMapXpos += (newxpos - xpos) >> 3;
-	}
-
-	if (p.cgb) {
-		doFullTilesUnrolledCgb(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
+	if (p.framebuf.indexFb()) {
+		doFullTilesUnrolled(p, xend, p.framebuf.indexFbline(), tileMapLine, tileline, tileMapXpos);
 	} else
-		doFullTilesUnrolledDmg(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
+		doFullTilesUnrolled(p, xend, p.framebuf.fbline(), tileMapLine, tileline, tileMapXpos);
 }
 
-static void plotPixel(PPUPriv &p) {
+template<typename Pixel>
+static void plotPixel(PPUPriv &p, Pixel *const fbline) {
 	int const xpos = p.xpos;
 	unsigned const tileword = p.tileword;
-	video_pixel_t *const fbline = p.framebuf.fbline();
 
 	if (static_cast<int>(p.wx) == xpos
 			&& (p.weMaster || (p.wy2 == p.lyCounter.ly() && lcdcWinEn(p)))
@@ -753,10 +870,22 @@ static void plotPixel(PPUPriv &p) {
 			p.winDrawState |= win_draw_start;
 	}
 
-	unsigned const twdata = tileword & ((p.lcdc & 1) | p.cgb) * 3;
-	video_pixel_t pixel = p.bgPalette[twdata + (p.attrib & 7) * 4];
 	int i = static_cast<int>(p.nextSprite) - 1;
 
+	if (!p.framebuf.hasBuf()) {
+		while (i >= 0 && int(p.spriteList[i].spx) > xpos - 8) {
+			p.spwordList[i] >>= 2;
+			--i;
+		}
+
+		p.xpos = xpos + 1;
+		p.tileword = tileword >> 2;
+		return;
+	}
+
+	unsigned const twdata = tileword & ((p.lcdc & 1) | p.cgb) * 3;
+	Pixel pixel = bgColors(p, fbline)[twdata + (p.attrib & 7) * 4];
+
 	if (i >= 0 && int(p.spriteList[i].spx) > xpos - 8) {
 		unsigned spdata = 0;
 		unsigned attrib = 0;
@@ -778,9 +907,9 @@ static void plotPixel(PPUPriv &p) {
 			if (spdata && lcdcObjEn(p)
 					&& (!((attrib | p.attrib) & attr_bgpriority) || !twdata || !lcdcBgEn(p))) {
             if(p.dmgMode)//support gb games in gbc mode
-               pixel = p.spPalette[(attrib >> 2 & 4) + spdata];
+               pixel = spColors(p, fbline)[(attrib >> 2 & 4) + spdata];
 				else
-               pixel = p.spPalette[(attrib & 7) * 4 + spdata];
+               pixel = spColors(p, fbline)[(attrib & 7) * 4 + spdata];
 			}
 		} else {
 			do {
@@ -794,7 +923,7 @@ static void plotPixel(PPUPriv &p) {
 			} while (i >= 0 && int(p.spriteList[i].spx) > xpos - 8);
 
 			if (spdata && lcdcObjEn(p) && (!(attrib & attr_bgpriority) || !twdata))
-				pixel = p.spPalette[(attrib >> 2 & 4) + spdata];
+				pixel = spColors(p, fbline)[(attrib >> 2 & 4) + spdata];
 		}
 	}
 
@@ -805,6 +934,13 @@ static void plotPixel(PPUPriv &p) {
 	p.tileword = tileword >> 2;
 }
 
+static void plotPixel(PPUPriv &p) {
+	if (p.framebuf.indexFb()) {
+		plotPixel(p, p.framebuf.indexFbline());
+	} else
+		plotPixel(p, p.framebuf.fbline());
+}
+
 static void plotPixelIfNoSprite(PPUPriv &p) {
 	if (p.spriteList[p.nextSprite].spx == p.xpos) {
 		if (!(lcdcObjEn(p) | p.cgb)) {
@@ -830,7 +966,30 @@ static unsigned long nextM2Time(PPUPriv const &p)
 	return nextm2;
 }
 
+// Records the palettes that the line was drawn with for the indexed output. A copy
+// is only made when they changed since the line before.
+static void saveLinePalette(PPUPriv &p) {
+	unsigned const ly = p.lyCounter.ly();
+
+	if (ly == 0 || p.linePaletteCount == 144 || p.paletteGen != p.linePaletteGen) {
+		unsigned const n = ly == 0 || p.linePaletteCount == 144 ? 0 : p.linePaletteCount;
+		std::memcpy(p.linePalettes[n]     , p.bgPalette, sizeof p.bgPalette);
+		std::memcpy(p.linePalettes[n] + 32, p.spPalette, sizeof p.spPalette);
+
+		// Games often rewrite palette registers with the values they already hold.
+		if (n == 0 || std::memcmp(p.linePalettes[n], p.linePalettes[n - 1], sizeof *p.linePalettes))
+			p.linePaletteCount = n + 1;
+
+		p.linePaletteGen = p.paletteGen;
+	}
+
+	p.linePalette[ly] = p.linePalettes[p.linePaletteCount - 1];
+}
+
 static void xpos168(PPUPriv &p) {
+	if (p.framebuf.indexFb())
+		saveLinePalette(p);
+
    unsigned is_doublespeed    = (unsigned)p.lyCounter.isDoubleSpeed();
 	p.lastM0Time               = p.now - (p.cycles << is_doublespeed);
 
@@ -1472,9 +1631,18 @@ PPUPriv::PPUPriv(NextM0Time &nextM0Time, unsigned char const *const oamram, unsi
 , cgb(false)
 , dmgMode(false)
 , weMaster(false)
+, paletteGen(0)
+, linePaletteGen(0)
+, linePaletteCount(0)
 {
 	std::memset(spriteList, 0, sizeof spriteList);
 	std::memset(spwordList, 0, sizeof spwordList);
+	std::memset(tileRows, 0, sizeof tileRows);
+	std::memset(tileData, 0, sizeof tileData);
+	std::memset(linePalettes, 0, sizeof linePalettes);
+
+	for (unsigned i = 0; i < 144; ++i)
+		linePalette[i] = linePalettes[0];
 }
 
 static void saveSpriteList(PPUPriv const &p, SaveState &ss) {
@@ -1752,4 +1920,57 @@ void PPU::update(unsigned long const cc) {
 	}
 }
 
+void PPU::vramDataChange(unsigned const offset, unsigned const size) {
+	for (unsigned pos = offset & ~1u; pos < offset + size; pos += 2) {
+		if ((pos & 0x1FFF) < 0x1800) {
+			unsigned const row = (pos >> 13) * 0xC00 + (pos & 0x1FFF) / 2;
+			p_.tileData[pos >> 13][pos & 0x1FFF] = p_.vram[pos];
+			p_.tileData[pos >> 13][(pos & 0x1FFF) + 1] = p_.vram[pos + 1];
+			p_.tileRows[0][row] = expand_lut[p_.vram[pos]]
+			                    + expand_lut[p_.vram[pos + 1]] * 2;
+			p_.tileRows[1][row] = expand_lut[p_.vram[pos] + 0x100]
+			                    + expand_lut[p_.vram[pos + 1] + 0x100] * 2;
+		}
+	}
+}
+
+void PPU::syncTileRows() {
+	for (unsigned bank = 0; bank < 2; ++bank) {
+		unsigned char const *const vram = p_.vram + bank * 0x2000;
+		if (std::memcmp(vram, p_.tileData[bank], 0x1800) == 0)
+			continue;
+
+		for (unsigned pos = 0; pos < 0x1800; pos += 16) {
+			if (std::memcmp(vram + pos, p_.tileData[bank] + pos, 16))
+				vramDataChange(bank * 0x2000 + pos, 16);
+		}
+	}
+}
+
+void PPU::blankIndexedFrame(video_pixel_t const color) {
+	for (unsigned ly = 0; ly < 144; ++ly) {
+		std::memset(p_.framebuf.indexFb() + std::ptrdiff_t(ly) * p_.framebuf.pitch(), 0, 160);
+		p_.linePalette[ly] = p_.linePalettes[0];
+	}
+
+	std::fill_n(p_.linePalettes[0], 8 * 4 * 2, color);
+	p_.linePaletteCount = 1;
+}
+
+void PPU::convertIndexedFrame(video_pixel_t *const dst, std::ptrdiff_t const dstPitch,
+		unsigned char const *const src, std::ptrdiff_t const srcPitch) const {
+	video_pixel_t const *colors = p_.linePalette[0];
+	IndexRowPalette pal;
+	setIndexRowPalette(pal, colors);
+
+	for (unsigned ly = 0; ly < 144; ++ly) {
+		if (p_.linePalette[ly] != colors) {
+			colors = p_.linePalette[ly];
+			setIndexRowPalette(pal, colors);
+		}
+
+		convertIndexRow(dst + std::ptrdiff_t(ly) * dstPitch, src + std::ptrdiff_t(ly) * srcPitch, 160, pal);
+	}
+}
+
 }
@@ -30,16 +30,25 @@ namespace gambatte {
 
 class PPUFrameBuf {
 public:
-	PPUFrameBuf() : buf_(0), fbline_(nullfbline()), pitch_(0) {}
+	PPUFrameBuf() : buf_(0), fbline_(nullfbline()), indexBuf_(0), indexFbline_(0), pitch_(0) {}
 	video_pixel_t * fb() const { return buf_; }
 	video_pixel_t * fbline() const { return fbline_; }
+	unsigned char * indexFb() const { return indexBuf_; }
+	unsigned char * indexFbline() const { return indexFbline_; }
+	bool hasBuf() const { return buf_ || indexBuf_; }
 	std::ptrdiff_t pitch() const { return pitch_; }
-	void setBuf(video_pixel_t *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline(); }
-	void setFbline(unsigned ly) { fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline(); }
+	void setBuf(video_pixel_t *buf, std::ptrdiff_t pitch) { buf_ = buf; indexBuf_ = 0; pitch_ = pitch; fbline_ = nullfbline(); }
+	void setIndexBuf(unsigned char *buf, std::ptrdiff_t pitch) { buf_ = 0; indexBuf_ = buf; pitch_ = pitch; fbline_ = nullfbline(); }
+	void setFbline(unsigned ly) {
+		fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline();
+		indexFbline_ = indexBuf_ ? indexBuf_ + std::ptrdiff_t(ly) * pitch_ : 0;
+	}
 
 private:
 	video_pixel_t *buf_;
 	video_pixel_t *fbline_;
+	unsigned char *indexBuf_;
+	unsigned char *indexFbline_;
 	std::ptrdiff_t pitch_;
 
 	static video_pixel_t * nullfbline() { static video_pixel_t nullfbline_[160]; return nullfbline_; }
@@ -62,6 +71,11 @@ struct PPUPriv {
 	unsigned char currentSprite;
 
 	unsigned char const *vram;
+	// Expanded rows of the tile data in both VRAM banks, plain and x-flipped, indexed
+	// by bank * 0xC00 + byte offset / 2. Kept current by PPU::vramDataChange.
+	unsigned short tileRows[2][2 * 0xC00];
+	// The tile data tileRows was expanded from, to find writes made outside the core.
+	unsigned char tileData[2][0x1800];
 	PPUState const *nextCallPtr;
 
 	unsigned long now;
@@ -95,6 +109,14 @@ struct PPUPriv {
    bool dmgMode;
 	bool weMaster;
 
+	// Colours of the lines of the last indexed frame. Lines share a copy in
+	// linePalettes until the palettes change, which paletteGen counts.
+	video_pixel_t linePalettes[144][8 * 4 * 2];
+	video_pixel_t const *linePalette[144];
+	unsigned paletteGen;
+	unsigned linePaletteGen;
+	unsigned char linePaletteCount;
+
 	PPUPriv(NextM0Time &nextM0Time, unsigned char const *oamram, unsigned char const *vram);
 };
 
@@ -105,8 +127,12 @@ public:
 	{
 	}
 
-	video_pixel_t * bgPalette() { return p_.bgPalette; }
+	// The palettes are only written through these, so each call counts as a change.
+	video_pixel_t * bgPalette() { ++p_.paletteGen; return p_.bgPalette; }
+	void blankIndexedFrame(video_pixel_t color);
 	bool cgb() const { return p_.cgb; }
+	void convertIndexedFrame(video_pixel_t *dst, std::ptrdiff_t dstPitch,
+	                         unsigned char const *src, std::ptrdiff_t srcPitch) const;
    void setDmgMode(bool mode) { p_.dmgMode = mode; }
    bool inDmgMode() const { return p_.dmgMode; }
 	void doLyCountEvent() { p_.lyCounter.doEvent(); }
@@ -119,6 +145,7 @@ public:
 
 	unsigned long lastM0Time() const { return p_.lastM0Time; }
 	unsigned lcdc() const { return p_.lcdc; }
+	video_pixel_t const * linePalette(unsigned ly) const { return p_.linePalette[ly]; }
 	void loadState(SaveState const &state, unsigned char const *oamram);
 	LyCounter const & lyCounter() const { return p_.lyCounter; }
 	unsigned long now() const { return p_.now; }
@@ -129,6 +156,7 @@ public:
 	void resetCc(unsigned long oldCc, unsigned long newCc);
 	void saveState(SaveState &ss) const;
 	void setFrameBuf(video_pixel_t *buf, std::ptrdiff_t pitch) { p_.framebuf.setBuf(buf, pitch); }
+	void setIndexFrameBuf(unsigned char *buf, std::ptrdiff_t pitch) { p_.framebuf.setIndexBuf(buf, pitch); }
 	void setLcdc(unsigned lcdc, unsigned long cc);
 	void setScx(unsigned scx) { p_.scx = scx; }
 	void setScy(unsigned scy) { p_.scy = scy; }
@@ -137,8 +165,10 @@ public:
 	void setWy(unsigned wy) { p_.wy = wy; }
 	void updateWy2() { p_.wy2 = p_.wy; }
 	void speedChange(unsigned long cycleCounter);
-	video_pixel_t * spPalette() { return p_.spPalette; }
+	video_pixel_t * spPalette() { ++p_.paletteGen; return p_.spPalette; }
 	void update(unsigned long cc);
+	void vramDataChange(unsigned offset, unsigned size);
+	void syncTileRows();
 
 private:
 	PPUPriv p_;
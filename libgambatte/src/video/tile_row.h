@@ -0,0 +1,260 @@
+//
+//   Copyright (C) 2026 by the gambatte-libretro contributors
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+
+#ifndef TILE_ROW_H
+#define TILE_ROW_H
+
+#include "gambatte.h"
+
+// HAVE_SIMD_TILES picks a vector kernel for the target at build time, and on ARM
+// only with HAVE_SIMD_NEON as well. Otherwise, or on other targets, the scalar loop
+// is used, which is also the reference the vector kernels must match bit for bit.
+// On x86, index conversion needs the byte shuffle of SSSE3, and only beats the
+// scalar loop for 16-bit pixels.
+#if defined(HAVE_SIMD_TILES) && defined(HAVE_SIMD_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define TILE_ROW_NEON
+#include <arm_neon.h>
+#elif defined(HAVE_SIMD_TILES) && (defined(__SSE2__) || defined(_M_X64) \
+		|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TILE_ROW_SSE2
+#include <emmintrin.h>
+#if defined(__SSSE3__) && (defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555))
+#define TILE_ROW_SSSE3
+#include <tmmintrin.h>
+#endif
+#endif
+
+namespace gambatte {
+
+// A 4-colour palette in the form drawTileRow reads it, so that it can be set up once
+// for a run of tiles. Pixel is video_pixel_t, or unsigned char for palette indices.
+template<typename Pixel>
+struct TileRowPalette {
+	Pixel const *colors;
+};
+
+template<typename Pixel>
+static inline void setTileRowPalette(TileRowPalette<Pixel> &pal, Pixel const *const colors) {
+	pal.colors = colors;
+}
+
+// Writes the 8 pixels of a tile row to dst. tileword is the row as expanded by the
+// PPU's expand_lut: 2 bits per pixel with the leftmost pixel in the low bits, so
+// horizontal flipping is already applied.
+template<typename Pixel>
+static inline void drawTileRow(Pixel *const dst, unsigned const tileword,
+		TileRowPalette<Pixel> const &pal) {
+	Pixel const *const palette = pal.colors;
+	dst[0] = palette[ tileword & 0x0003       ];
+	dst[1] = palette[(tileword & 0x000C) >>  2];
+	dst[2] = palette[(tileword & 0x0030) >>  4];
+	dst[3] = palette[(tileword & 0x00C0) >>  6];
+	dst[4] = palette[(tileword & 0x0300) >>  8];
+	dst[5] = palette[(tileword & 0x0C00) >> 10];
+	dst[6] = palette[(tileword & 0x3000) >> 12];
+	dst[7] = palette[ tileword           >> 14];
+}
+
+#if defined(TILE_ROW_NEON) || defined(TILE_ROW_SSE2)
+template<>
+struct TileRowPalette<video_pixel_t> {
+#if defined(TILE_ROW_NEON) && (defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555))
+	uint8x8_t bytes;
+#elif defined(TILE_ROW_NEON)
+	uint8x8x2_t bytes;
+#else
+	// p0, p0 ^ p1, p0 ^ p2 and p0 ^ p1 ^ p2 ^ p3.
+	__m128i p0, d1, d2, d3;
+#endif
+};
+
+static inline void setTileRowPalette(TileRowPalette<video_pixel_t> &pal,
+		video_pixel_t const *const colors) {
+#if defined(TILE_ROW_NEON) && (defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555))
+	pal.bytes = vld1_u8(reinterpret_cast<uint8_t const *>(colors));
+#elif defined(TILE_ROW_NEON)
+	pal.bytes.val[0] = vld1_u8(reinterpret_cast<uint8_t const *>(colors));
+	pal.bytes.val[1] = vld1_u8(reinterpret_cast<uint8_t const *>(colors + 2));
+#elif defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
+	pal.p0 = _mm_set1_epi16(static_cast<short>(colors[0]));
+	pal.d1 = _mm_xor_si128(pal.p0, _mm_set1_epi16(static_cast<short>(colors[1])));
+	pal.d2 = _mm_xor_si128(pal.p0, _mm_set1_epi16(static_cast<short>(colors[2])));
+	pal.d3 = _mm_xor_si128(_mm_xor_si128(pal.d1, pal.d2),
+	                       _mm_xor_si128(pal.p0, _mm_set1_epi16(static_cast<short>(colors[3]))));
+#else
+	pal.p0 = _mm_set1_epi32(static_cast<int>(colors[0]));
+	pal.d1 = _mm_xor_si128(pal.p0, _mm_set1_epi32(static_cast<int>(colors[1])));
+	pal.d2 = _mm_xor_si128(pal.p0, _mm_set1_epi32(static_cast<int>(colors[2])));
+	pal.d3 = _mm_xor_si128(_mm_xor_si128(pal.d1, pal.d2),
+	                       _mm_xor_si128(pal.p0, _mm_set1_epi32(static_cast<int>(colors[3]))));
+#endif
+}
+
+static inline void drawTileRow(video_pixel_t *const dst, unsigned const tileword,
+		TileRowPalette<video_pixel_t> const &pal) {
+#if defined(TILE_ROW_NEON)
+	static int16_t const shifts[8] = { 0, -2, -4, -6, -8, -10, -12, -14 };
+	uint16x8_t const idx = vandq_u16(vshlq_u16(vdupq_n_u16(tileword), vld1q_s16(shifts)),
+	                                 vdupq_n_u16(3));
+#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
+	// Byte n of the palette entry is gathered for byte n of each output pixel.
+	uint8x16_t const bytes = vreinterpretq_u8_u16(
+		vmlaq_n_u16(vdupq_n_u16(0x0100), idx, 0x0202));
+
+	vst1q_u16(reinterpret_cast<uint16_t *>(dst), vreinterpretq_u16_u8(vcombine_u8(
+		vtbl1_u8(pal.bytes, vget_low_u8(bytes)), vtbl1_u8(pal.bytes, vget_high_u8(bytes)))));
+#else
+	uint8x16_t const lo = vreinterpretq_u8_u32(
+		vmlaq_n_u32(vdupq_n_u32(0x03020100), vmovl_u16(vget_low_u16(idx)), 0x04040404));
+	uint8x16_t const hi = vreinterpretq_u8_u32(
+		vmlaq_n_u32(vdupq_n_u32(0x03020100), vmovl_u16(vget_high_u16(idx)), 0x04040404));
+
+	vst1q_u32(reinterpret_cast<uint32_t *>(dst), vreinterpretq_u32_u8(vcombine_u8(
+		vtbl2_u8(pal.bytes, vget_low_u8(lo)), vtbl2_u8(pal.bytes, vget_high_u8(lo)))));
+	vst1q_u32(reinterpret_cast<uint32_t *>(dst + 4), vreinterpretq_u32_u8(vcombine_u8(
+		vtbl2_u8(pal.bytes, vget_low_u8(hi)), vtbl2_u8(pal.bytes, vget_high_u8(hi)))));
+#endif
+#else
+	// Lane n tests the two bits of pixel n. With the colours stored as p0 and
+	// p0 ^ pN, the lo bit, the hi bit and both bits each select one xor term.
+	__m128i const w = _mm_set1_epi16(static_cast<short>(tileword));
+	__m128i const lobits = _mm_setr_epi16(1 << 0, 1 << 2, 1 << 4, 1 << 6,
+	                                      1 << 8, 1 << 10, 1 << 12, 1 << 14);
+	__m128i const hibits = _mm_slli_epi16(lobits, 1);
+	__m128i const lo = _mm_cmpeq_epi16(_mm_and_si128(w, lobits), lobits);
+	__m128i const hi = _mm_cmpeq_epi16(_mm_and_si128(w, hibits), hibits);
+#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
+	__m128i px = _mm_xor_si128(pal.p0, _mm_and_si128(lo, pal.d1));
+	px = _mm_xor_si128(px, _mm_and_si128(hi, pal.d2));
+	px = _mm_xor_si128(px, _mm_and_si128(_mm_and_si128(lo, hi), pal.d3));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), px);
+#else
+	__m128i const los[2] = { _mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo) };
+	__m128i const his[2] = { _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi) };
+
+	for (int i = 0; i < 2; ++i) {
+		__m128i px = _mm_xor_si128(pal.p0, _mm_and_si128(los[i], pal.d1));
+		px = _mm_xor_si128(px, _mm_and_si128(his[i], pal.d2));
+		px = _mm_xor_si128(px, _mm_and_si128(_mm_and_si128(los[i], his[i]), pal.d3));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), px);
+	}
+#endif
+#endif
+}
+#endif
+
+
+// The 64 colours that palette indices refer to, in the form convertIndexRow reads them.
+struct IndexRowPalette {
+#if defined(TILE_ROW_NEON)
+	// Byte b of the colours of indices 0-31 and 32-63.
+	uint8x8x4_t planes[sizeof(video_pixel_t)][2];
+#elif defined(TILE_ROW_SSSE3)
+	// Byte b of the colours of indices 16 * t to 16 * t + 15.
+	__m128i planes[sizeof(video_pixel_t)][4];
+#else
+	video_pixel_t const *colors;
+#endif
+};
+
+static inline void setIndexRowPalette(IndexRowPalette &pal, video_pixel_t const *const colors) {
+#if defined(TILE_ROW_NEON)
+	uint8_t const *const bytes = reinterpret_cast<uint8_t const *>(colors);
+
+	for (unsigned q = 0; q < 4; ++q) {
+		// Loads 16 colours split into their bytes.
+#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
+		uint8x16x2_t const v = vld2q_u8(bytes + q * 32);
+#else
+		uint8x16x4_t const v = vld4q_u8(bytes + q * 64);
+#endif
+		for (unsigned b = 0; b < sizeof(video_pixel_t); ++b) {
+			pal.planes[b][q >> 1].val[(q & 1) * 2    ] = vget_low_u8(v.val[b]);
+			pal.planes[b][q >> 1].val[(q & 1) * 2 + 1] = vget_high_u8(v.val[b]);
+		}
+	}
+#elif defined(TILE_ROW_SSSE3)
+	__m128i const *const src = reinterpret_cast<__m128i const *>(colors);
+
+	for (unsigned t = 0; t < 4; ++t) {
+		// Low bytes to the low half, high bytes to the high half.
+		__m128i const split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+		__m128i const a = _mm_shuffle_epi8(_mm_loadu_si128(src + t * 2    ), split);
+		__m128i const b = _mm_shuffle_epi8(_mm_loadu_si128(src + t * 2 + 1), split);
+		pal.planes[0][t] = _mm_unpacklo_epi64(a, b);
+		pal.planes[1][t] = _mm_unpackhi_epi64(a, b);
+	}
+#else
+	pal.colors = colors;
+#endif
+}
+
+// Writes the colours of the n palette indices at src to dst. n is a multiple of 16.
+static inline void convertIndexRow(video_pixel_t *const dst, unsigned char const *const src,
+		unsigned const n, IndexRowPalette const &pal) {
+#if defined(TILE_ROW_NEON)
+	for (unsigned x = 0; x < n; x += 8) {
+		// vtbx4 leaves the lanes of indices below 32 alone, since those wrap to 224 and up.
+		uint8x8_t const idx   = vld1_u8(src + x);
+		uint8x8_t const idxhi = vsub_u8(idx, vdup_n_u8(32));
+#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
+		uint8x8x2_t px;
+#else
+		uint8x8x4_t px;
+#endif
+		for (unsigned b = 0; b < sizeof(video_pixel_t); ++b)
+			px.val[b] = vtbx4_u8(vtbl4_u8(pal.planes[b][0], idx), pal.planes[b][1], idxhi);
+
+#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
+		vst2_u8(reinterpret_cast<uint8_t *>(dst + x), px);
+#else
+		vst4_u8(reinterpret_cast<uint8_t *>(dst + x), px);
+#endif
+	}
+#elif defined(TILE_ROW_SSSE3)
+	for (unsigned x = 0; x < n; x += 16) {
+		__m128i sel = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + x));
+		__m128i bytes[sizeof(video_pixel_t)];
+
+		for (unsigned b = 0; b < sizeof(video_pixel_t); ++b)
+			bytes[b] = _mm_setzero_si128();
+
+		for (unsigned t = 0; t < 4; ++t) {
+			// Indices outside the 16 entries of this table get bit 7 set, for which
+			// pshufb gives 0. Those below it already have it from the subtraction.
+			__m128i const i = _mm_or_si128(sel, _mm_cmpgt_epi8(sel, _mm_set1_epi8(15)));
+
+			for (unsigned b = 0; b < sizeof(video_pixel_t); ++b)
+				bytes[b] = _mm_or_si128(bytes[b], _mm_shuffle_epi8(pal.planes[b][t], i));
+
+			sel = _mm_sub_epi8(sel, _mm_set1_epi8(16));
+		}
+
+		__m128i *const d = reinterpret_cast<__m128i *>(dst + x);
+		_mm_storeu_si128(d    , _mm_unpacklo_epi8(bytes[0], bytes[1]));
+		_mm_storeu_si128(d + 1, _mm_unpackhi_epi8(bytes[0], bytes[1]));
+	}
+#else
+	for (unsigned x = 0; x < n; ++x)
+		dst[x] = pal.colors[src[x]];
+#endif
+}
+
+}
+
+#endif
@@ -36,6 +36,99 @@
 
 namespace gambatte
 {
+   struct ColorSettings
+   {
+      bool colorCorrection;
+      unsigned colorCorrectionMode;
+      float colorCorrectionBrightness;
+      unsigned darkFilterLevel;
+
+      bool operator==(const ColorSettings &other) const
+      {
+         return colorCorrection == other.colorCorrection
+             && colorCorrectionMode == other.colorCorrectionMode
+             && colorCorrectionBrightness == other.colorCorrectionBrightness
+             && darkFilterLevel == other.darkFilterLevel;
+      }
+   };
+
+   static video_pixel_t correctColor(unsigned bgr15, const ColorSettings &key);
+
+   // Every BGR15 colour converted with one set of colour settings. Tables are
+   // shared by all LCDs using the same settings (e.g. the run-ahead instance),
+   // and freed when the last of them moves on. Not thread safe: LCDs are only
+   // created and configured from the emulation thread.
+   struct ColorTable
+   {
+      ColorSettings key;
+      unsigned refs;
+      ColorTable *next;
+      video_pixel_t colors[0x8000];
+   };
+
+   static ColorTable *colorTables = 0;
+
+   static ColorTable * acquireColorTable(const ColorSettings &key)
+   {
+      for (ColorTable *table = colorTables; table; table = table->next)
+      {
+         if (table->key == key)
+         {
+            ++table->refs;
+            return table;
+         }
+      }
+
+      ColorTable *const table = new ColorTable;
+      table->key = key;
+      table->refs = 1;
+      table->next = colorTables;
+
+      for (unsigned bgr15 = 0; bgr15 < 0x8000; ++bgr15)
+         table->colors[bgr15] = correctColor(bgr15, key);
+
+      colorTables = table;
+      return table;
+   }
+
+   static void releaseColorTable(ColorTable *const table)
+   {
+      if (!table || --table->refs)
+         return;
+
+      ColorTable **link = &colorTables;
+
+      while (*link != table)
+         link = &(*link)->next;
+
+      *link = table->next;
+      delete table;
+   }
+
+   void LCD::updateColorTable()
+   {
+      ColorSettings key;
+      key.colorCorrection = colorCorrection;
+      // Settings that do not affect the output are normalised, so that
+      // they do not split otherwise identical tables.
+      key.colorCorrectionMode = colorCorrection ? colorCorrectionMode : 0;
+      key.colorCorrectionBrightness = colorCorrection && colorCorrectionMode != 1
+                                    ? colorCorrectionBrightness : 0.0f;
+      key.darkFilterLevel = darkFilterLevel;
+
+      if (colorTable_ && colorTable_->key == key)
+         return;
+
+      ColorTable *const table = acquireColorTable(key);
+      releaseColorTable(colorTable_);
+      colorTable_ = table;
+   }
+
+   video_pixel_t LCD::gbcToRgb32(const unsigned bgr15)
+   {
+      return colorTable_->colors[bgr15 & 0x7FFF];
+   }
+
    void LCD::setDmgPaletteColor(const unsigned index, const video_pixel_t rgb32)
    {
       dmgColorsRgb32_[index] = rgb32;
@@ -52,6 +145,7 @@ namespace gambatte
    void LCD::setColorCorrection(bool colorCorrection_)
    {
       colorCorrection = colorCorrection_;
+      updateColorTable();
       refreshPalettes();
    }
    
@@ -62,18 +156,21 @@ namespace gambatte
       // (e.g. a special GBA colour correction mode for when the GBA
       // flag is set in Shantae/Zelda: Oracle/etc.)
       colorCorrectionMode = colorCorrectionMode_;
+      updateColorTable();
       refreshPalettes();
    }
    
    void LCD::setColorCorrectionBrightness(float colorCorrectionBrightness_)
    {
       colorCorrectionBrightness = colorCorrectionBrightness_;
+      updateColorTable();
       refreshPalettes();
    }
    
    void LCD::setDarkFilterLevel(unsigned darkFilterLevel_)
    {
       darkFilterLevel = darkFilterLevel_;
+      updateColorTable();
       refreshPalettes();
    }
 
@@ -82,10 +179,16 @@ namespace gambatte
       eventTimes_(memEventRequester),
       statReg_(0),
       m2IrqStatReg_(0),
-      m1IrqStatReg_(0)
+      m1IrqStatReg_(0),
+      colorCorrection(true),
+      colorCorrectionMode(0),
+      colorCorrectionBrightness(0.0f),
+      darkFilterLevel(0),
+      colorTable_(0)
    {
       std::memset( bgpData_, 0, sizeof  bgpData_);
       std::memset(objpData_, 0, sizeof objpData_);
+      updateColorTable();
 
       for (std::size_t i = 0; i < sizeof(dmgColorsRgb32_) / sizeof(dmgColorsRgb32_[0]); ++i)
       {
@@ -112,6 +215,11 @@ namespace gambatte
       setColorCorrection(true);
    }
 
+   LCD::~LCD()
+   {
+      releaseColorTable(colorTable_);
+   }
+
    void LCD::doCgbColorChange(unsigned char *const pdata,
          video_pixel_t *const palette, unsigned index, const unsigned data)
    {
@@ -149,15 +257,19 @@ namespace gambatte
    {
       update(cycleCounter);
 
-      if (blanklcd && ppu_.frameBuf().fb())
+      if (blanklcd && ppu_.frameBuf().hasBuf())
       {
          const video_pixel_t color = ppu_.cgb() ? gbcToRgb32(0xFFFF) : dmgColorsRgb32_[0];
-         clear(ppu_.frameBuf().fb(), color, ppu_.frameBuf().pitch());
+
+         if (ppu_.frameBuf().indexFb())
+            ppu_.blankIndexedFrame(color);
+         else
+            clear(ppu_.frameBuf().fb(), color, ppu_.frameBuf().pitch());
       }
    }
 
    // RGB range: [0,1]
-   void LCD::darkenRgb(float &r, float &g, float &b)
+   static void darkenRgb(float &r, float &g, float &b, const unsigned darkFilterLevel)
    {
       // Note: This is *very* approximate...
       // - Should be done in linear colour space. It isn't.
@@ -186,7 +298,7 @@ namespace gambatte
       b = b * darkFactor;
    }
 
-   video_pixel_t LCD::gbcToRgb32(const unsigned bgr15)
+   static video_pixel_t correctColor(const unsigned bgr15, const ColorSettings &key)
    {
       const unsigned r = bgr15       & 0x1F;
       const unsigned g = bgr15 >>  5 & 0x1F;
@@ -205,9 +317,9 @@ namespace gambatte
       
       bool isDark = false;
       
-      if (colorCorrection)
+      if (key.colorCorrection)
       {
-         if (colorCorrectionMode == 1)
+         if (key.colorCorrectionMode == 1)
          {
             // Use fast (inaccurate) Gambatte default method
             rFinal = ((r * 13) + (g * 2) + b) >> 4;
@@ -230,7 +342,7 @@ namespace gambatte
             static const float targetGamma = 2.2;
             static const float displayGammaInv = 1.0 / targetGamma;
             // Perform gamma expansion
-            float adjustedGamma = targetGamma - colorCorrectionBrightness;
+            float adjustedGamma = targetGamma - key.colorCorrectionBrightness;
             float rFloat = std::pow(static_cast<float>(r) * rgbMaxInv, adjustedGamma);
             float gFloat = std::pow(static_cast<float>(g) * rgbMaxInv, adjustedGamma);
             float bFloat = std::pow(static_cast<float>(b) * rgbMaxInv, adjustedGamma);
@@ -251,9 +363,9 @@ namespace gambatte
             gCorrect = gCorrect > 1.0f ? 1.0f : gCorrect;
             bCorrect = bCorrect > 1.0f ? 1.0f : bCorrect;
             // Perform image darkening, if required
-            if (darkFilterLevel > 0)
+            if (key.darkFilterLevel > 0)
             {
-               darkenRgb(rCorrect, gCorrect, bCorrect);
+               darkenRgb(rCorrect, gCorrect, bCorrect, key.darkFilterLevel);
                isDark = true;
             }
             // Convert back to 5bit unsigned
@@ -271,14 +383,14 @@ namespace gambatte
       
       // Perform image darkening, if required and we haven't
       // already done it during colour correction
-      if (darkFilterLevel > 0 && !isDark)
+      if (key.darkFilterLevel > 0 && !isDark)
       {
          // Convert colour range from [0,0x1F] to [0,1]
          float rDark = static_cast<float>(rFinal) * rgbMaxInv;
          float gDark = static_cast<float>(gFinal) * rgbMaxInv;
          float bDark = static_cast<float>(bFinal) * rgbMaxInv;
          // Perform image darkening
-         darkenRgb(rDark, gDark, bDark);
+         darkenRgb(rDark, gDark, bDark, key.darkFilterLevel);
          // Convert back to 5bit unsigned
          rFinal = static_cast<unsigned>((rDark * rgbMax) + 0.5) & 0x1F;
          gFinal = static_cast<unsigned>((gDark * rgbMax) + 0.5) & 0x1F;